@@ -114,6 +114,14 @@ void config_read(struct config_phobia *fe)
 
 				fe->regfile = strtol(value, NULL, 10);
 			}
+			else if (strcmp(name, "logrotate") == 0) {
+
+				fe->logrotate = strtol(value, NULL, 10);
+			}
+			else if (strcmp(name, "logcompress") == 0) {
+
+				fe->logcompress = strtol(value, NULL, 10);
+			}
 config_read_SKIP:
 
 		}
@@ -211,6 +219,8 @@ void config_write(struct config_phobia *fe)
 		fprintf(fd, "storage %s\n", fe->storage);
 		fprintf(fd, "fuzzy %s\n", fe->fuzzy);
 		fprintf(fd, "regfile %i\n", fe->regfile);
+		fprintf(fd, "logrotate %i\n", fe->logrotate);
+		fprintf(fd, "logcompress %i\n", fe->logcompress);
 
 		fclose(fd);
 	}
@@ -246,6 +256,9 @@ void config_default(struct config_phobia *fe)
 	strcpy(fe->fuzzy, "setpoint");
 
 	fe->regfile = 500;
+
+	fe->logrotate = 16;
+	fe->logcompress = 1;
 }
 
 void config_storage_path(struct config_phobia *fe, char *lbuf, const char *file)
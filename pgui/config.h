@@ -8,6 +8,7 @@
 
 #define FILE_HOME_CONFIG		"pguirc"
 #define FILE_LINK_LOG			"phobia.log"
+#define FILE_LINK_LOG_SESSION		"phobia%i.log"
 #define FILE_DEBUG_LOG			"debug.log"
 #define FILE_TLM_IMPEDANCE		"tlmscan.csv"
 #define FILE_TLM_DEFAULT		"tlmgrab.csv"
@@ -34,6 +35,9 @@ struct config_phobia {
 	char			storage[PHOBIA_PATH_MAX];
 	char			fuzzy[PHOBIA_NAME_MAX];
 	int			regfile;
+
+	int			logrotate;
+	int			logcompress;
 };
 
 FILE *fopen_from_UTF8(const char *file, const char *mode);
@@ -320,3 +320,191 @@ int async_gets(async_FILE *afd, char *raw, int n)
 	}
 }
 
+
+int async_gets_chunk(async_FILE *afd, char *raw, int n, int *length)
+{
+	int		rp, wp, nr, eof, N;
+
+	eof = SDL_AtomicGet(&afd->flag_eof);
+
+	rp = SDL_AtomicGet(&afd->rp);
+	wp = SDL_AtomicGet(&afd->wp);
+
+	nr = (wp < rp) ? wp + afd->preload - rp : wp - rp;
+
+	if (nr == 0) {
+
+		return (eof != 0) ? ASYNC_END_OF_FILE : ASYNC_NO_DATA_READY;
+	}
+
+	nr = (nr > n) ? n : nr;
+
+	if (rp + nr > afd->preload) {
+
+		N = afd->preload - rp;
+
+		memcpy(raw, afd->stream + rp, N);
+		memcpy(raw + N, afd->stream, nr - N);
+	}
+	else {
+		memcpy(raw, afd->stream + rp, nr);
+	}
+
+	if (eof == 0 || nr == n) {
+
+		/* Cut the chunk at the last line boundary.
+		 * */
+		for (N = nr - 1; N >= 0; --N) {
+
+			if (raw[N] == '\r' || raw[N] == '\n')
+				break;
+		}
+
+		if (N >= 0) {
+
+			nr = N + 1;
+		}
+		else if (n < afd->preload - afd->chunk) {
+
+			/* Line is longer than buffer so we wait for the rest
+			 * of line or ask the caller for more space.
+			 * */
+			return (nr < n) ? ASYNC_NO_DATA_READY : ASYNC_NO_FREE_SPACE;
+		}
+		else if (nr < afd->preload - afd->chunk) {
+
+			return ASYNC_NO_DATA_READY;
+		}
+	}
+
+	rp += nr;
+	rp -= (rp >= afd->preload) ? afd->preload : 0;
+
+	SDL_AtomicSet(&afd->rp, rp);
+
+	*length = nr;
+
+	return ASYNC_OK;
+}
+
+static int
+async_WORKER(async_POOL *pool)
+{
+	async_JOB	job;
+
+	do {
+		SDL_LockMutex(pool->mutex);
+
+		while (pool->rp == pool->wp && pool->flag_break == 0) {
+
+			SDL_CondWait(pool->cond, pool->mutex);
+		}
+
+		if (pool->flag_break != 0) {
+
+			SDL_UnlockMutex(pool->mutex);
+			break;
+		}
+
+		job = pool->job[pool->rp];
+
+		pool->rp = (pool->rp < ASYNC_JOB_MAX - 1) ? pool->rp + 1 : 0;
+
+		SDL_UnlockMutex(pool->mutex);
+
+		job.proc(job.arg);
+	}
+	while (1);
+
+	return 0;
+}
+
+async_POOL *async_pool_open(int thread_N)
+{
+	async_POOL		*pool;
+	int			N;
+
+	if (thread_N < 1) {
+
+		/* Leave one core for the UI thread.
+		 * */
+		thread_N = SDL_GetCPUCount() - 1;
+	}
+
+	thread_N = (thread_N < 1) ? 1
+		: (thread_N > ASYNC_THREAD_MAX) ? ASYNC_THREAD_MAX : thread_N;
+
+	pool = (async_POOL *) calloc(1, sizeof(async_POOL));
+
+	if (pool == NULL) {
+
+		ERROR("No memory allocated for async pool\n");
+		return NULL;
+	}
+
+	pool->mutex = SDL_CreateMutex();
+	pool->cond = SDL_CreateCond();
+
+	for (N = 0; N < thread_N; ++N) {
+
+		pool->thread[N] = SDL_CreateThread((int (*) (void *)) &async_WORKER,
+				"async_WORKER", pool);
+
+		if (pool->thread[N] == NULL) {
+
+			ERROR("Unable to create async_WORKER thread\n");
+			break;
+		}
+
+		pool->thread_N++;
+	}
+
+	return pool;
+}
+
+void async_pool_close(async_POOL *pool)
+{
+	int			N;
+
+	SDL_LockMutex(pool->mutex);
+
+	pool->flag_break = 1;
+
+	SDL_CondBroadcast(pool->cond);
+	SDL_UnlockMutex(pool->mutex);
+
+	for (N = 0; N < pool->thread_N; ++N) {
+
+		SDL_WaitThread(pool->thread[N], NULL);
+	}
+
+	SDL_DestroyCond(pool->cond);
+	SDL_DestroyMutex(pool->mutex);
+
+	free(pool);
+}
+
+int async_pool_submit(async_POOL *pool, void (* proc) (void *), void *arg)
+{
+	int			wp, rc = ASYNC_NO_FREE_SPACE;
+
+	SDL_LockMutex(pool->mutex);
+
+	wp = (pool->wp < ASYNC_JOB_MAX - 1) ? pool->wp + 1 : 0;
+
+	if (wp != pool->rp && pool->thread_N != 0) {
+
+		pool->job[pool->wp].proc = proc;
+		pool->job[pool->wp].arg = arg;
+
+		pool->wp = wp;
+
+		SDL_CondSignal(pool->cond);
+
+		rc = ASYNC_OK;
+	}
+
+	SDL_UnlockMutex(pool->mutex);
+
+	return rc;
+}
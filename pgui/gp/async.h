@@ -24,6 +24,9 @@
 
 #include <SDL2/SDL.h>
 
+#define ASYNC_THREAD_MAX	32
+#define ASYNC_JOB_MAX		256
+
 enum {
 	ASYNC_OK		= 0,
 	ASYNC_NO_FREE_SPACE,
@@ -54,6 +57,30 @@ typedef struct {
 }
 async_FILE;
 
+typedef struct {
+
+	void		(* proc) (void *);
+	void		*arg;
+}
+async_JOB;
+
+typedef struct {
+
+	SDL_Thread	*thread[ASYNC_THREAD_MAX];
+	int		thread_N;
+
+	SDL_mutex	*mutex;
+	SDL_cond	*cond;
+
+	async_JOB	job[ASYNC_JOB_MAX];
+
+	int		rp;
+	int		wp;
+
+	int		flag_break;
+}
+async_POOL;
+
 async_FILE *async_open(FILE *fd, int preload, int chunk, int timeout);
 async_FILE *async_stub(int preload, int chunk, int timeout);
 void async_close(async_FILE *afd);
@@ -61,6 +88,12 @@ void async_close(async_FILE *afd);
 int async_write(async_FILE *afd, const char *raw, int n);
 int async_read(async_FILE *afd, char *raw, int n);
 int async_gets(async_FILE *afd, char *raw, int n);
+int async_gets_chunk(async_FILE *afd, char *raw, int n, int *length);
+
+async_POOL *async_pool_open(int thread_N);
+void async_pool_close(async_POOL *pool);
+
+int async_pool_submit(async_POOL *pool, void (* proc) (void *), void *arg);
 
 #endif /* _H_ASYNC_ */
 
@@ -0,0 +1,527 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+
+typedef unsigned long long	u64_t;
+typedef long long		s64_t;
+
+typedef struct {
+
+	unsigned char		*pack;
+	int			length;
+	int			limit;
+
+	u64_t			acc;
+	int			bits;
+}
+bitw_t;
+
+typedef struct {
+
+	const unsigned char	*pack;
+	int			length;
+	int			rp;
+
+	u64_t			acc;
+	int			bits;
+}
+bitr_t;
+
+typedef struct {
+
+	int	(* encode) (const double *place, int stride, int lN, char *pack, int limit);
+	int	(* decode) (double *place, int stride, int lN, const char *pack, int length);
+}
+codec_t;
+
+/* We always compare floating-point values by their bits since the build
+ * uses -ffinite-math-only.
+ * */
+static u64_t
+codecBits(double x)
+{
+	union {
+		double		f;
+		u64_t		l;
+	}
+	u = { x };
+
+	return u.l;
+}
+
+static double
+codecDouble(u64_t l)
+{
+	union {
+		u64_t		l;
+		double		f;
+	}
+	u = { l };
+
+	return u.f;
+}
+
+static int
+codecPut(bitw_t *bw, u64_t x, int n)
+{
+	/* Put up to 32 bits at once.
+	 * */
+	bw->acc = (bw->acc << n) | (x & ((1ULL << n) - 1ULL));
+	bw->bits += n;
+
+	while (bw->bits >= 8) {
+
+		bw->bits -= 8;
+
+		if (bw->length >= bw->limit)
+			return -1;
+
+		if (bw->pack != NULL) {
+
+			bw->pack[bw->length] = (unsigned char) (bw->acc >> bw->bits);
+		}
+
+		bw->length++;
+	}
+
+	return 0;
+}
+
+static int
+codecPut64(bitw_t *bw, u64_t x, int n)
+{
+	if (n > 32) {
+
+		if (codecPut(bw, x >> 32, n - 32) < 0)
+			return -1;
+
+		n = 32;
+	}
+
+	return codecPut(bw, x, n);
+}
+
+static int
+codecFlush(bitw_t *bw)
+{
+	if (bw->bits > 0) {
+
+		if (codecPut(bw, 0ULL, 8 - bw->bits) < 0)
+			return -1;
+	}
+
+	return bw->length;
+}
+
+static int
+codecGet(bitr_t *br, u64_t *x, int n)
+{
+	while (br->bits < n) {
+
+		if (br->rp >= br->length)
+			return -1;
+
+		br->acc = (br->acc << 8) | br->pack[br->rp++];
+		br->bits += 8;
+	}
+
+	br->bits -= n;
+
+	*x = (br->acc >> br->bits) & ((1ULL << n) - 1ULL);
+
+	return 0;
+}
+
+static int
+codecGet64(bitr_t *br, u64_t *x, int n)
+{
+	u64_t		hi, lo;
+
+	if (n > 32) {
+
+		if (codecGet(br, &hi, n - 32) < 0)
+			return -1;
+
+		if (codecGet(br, &lo, 32) < 0)
+			return -1;
+
+		*x = (hi << 32) | lo;
+
+		return 0;
+	}
+
+	return codecGet(br, x, n);
+}
+
+static int
+codecEncodeFP32(const double *place, int stride, int lN, char *pack, int limit)
+{
+	float		fval;
+	int		N;
+
+	if (lN * (int) sizeof(float) > limit)
+		return -1;
+
+	for (N = 0; N < lN; ++N) {
+
+		fval = (float) *place;
+
+		if (codecBits((double) fval) != codecBits(*place))
+			return -1;
+
+		if (pack != NULL) {
+
+			memcpy(pack + N * sizeof(float), &fval, sizeof(float));
+		}
+
+		place += stride;
+	}
+
+	return lN * (int) sizeof(float);
+}
+
+static int
+codecDecodeFP32(double *place, int stride, int lN, const char *pack, int length)
+{
+	float		fval;
+	int		N;
+
+	if (lN * (int) sizeof(float) > length)
+		return -1;
+
+	for (N = 0; N < lN; ++N) {
+
+		memcpy(&fval, pack + N * sizeof(float), sizeof(float));
+
+		*place = (double) fval;
+		place += stride;
+	}
+
+	return lN * (int) sizeof(float);
+}
+
+static int
+codecEncodeFP64(const double *place, int stride, int lN, char *pack, int limit)
+{
+	int		N;
+
+	if (lN * (int) sizeof(double) > limit)
+		return -1;
+
+	for (N = 0; N < lN; ++N) {
+
+		if (pack != NULL) {
+
+			memcpy(pack + N * sizeof(double), place, sizeof(double));
+		}
+
+		place += stride;
+	}
+
+	return lN * (int) sizeof(double);
+}
+
+static int
+codecDecodeFP64(double *place, int stride, int lN, const char *pack, int length)
+{
+	int		N;
+
+	if (lN * (int) sizeof(double) > length)
+		return -1;
+
+	for (N = 0; N < lN; ++N) {
+
+		memcpy(place, pack + N * sizeof(double), sizeof(double));
+
+		place += stride;
+	}
+
+	return lN * (int) sizeof(double);
+}
+
+static int
+codecEncodeXOR64(const double *place, int stride, int lN, char *pack, int limit)
+{
+	bitw_t		bw = { (unsigned char *) pack, 0, limit, 0ULL, 0 };
+
+	u64_t		prev, xval;
+	int		N, lz, tz, plz, ptz, rc;
+
+	prev = codecBits(*place);
+
+	if (codecPut64(&bw, prev, 64) < 0)
+		return -1;
+
+	plz = 65;
+	ptz = 0;
+
+	for (N = 1; N < lN; ++N) {
+
+		place += stride;
+
+		xval = codecBits(*place) ^ prev;
+		prev ^= xval;
+
+		if (xval == 0ULL) {
+
+			rc = codecPut(&bw, 0ULL, 1);
+		}
+		else {
+			lz = __builtin_clzll(xval);
+			tz = __builtin_ctzll(xval);
+
+			lz = (lz > 31) ? 31 : lz;
+
+			if (lz >= plz && tz >= ptz) {
+
+				/* Meaningful bits fit into the previous window.
+				 * */
+				rc = codecPut(&bw, 2ULL, 2);
+
+				if (rc == 0) {
+
+					rc = codecPut64(&bw, xval >> ptz, 64 - plz - ptz);
+				}
+			}
+			else {
+				rc = codecPut(&bw, (3ULL << 11) | (lz << 6)
+						| (64 - lz - tz - 1), 13);
+
+				if (rc == 0) {
+
+					rc = codecPut64(&bw, xval >> tz, 64 - lz - tz);
+				}
+
+				plz = lz;
+				ptz = tz;
+			}
+		}
+
+		if (rc < 0)
+			return -1;
+	}
+
+	return codecFlush(&bw);
+}
+
+static int
+codecDecodeXOR64(double *place, int stride, int lN, const char *pack, int length)
+{
+	bitr_t		br = { (const unsigned char *) pack, length, 0, 0ULL, 0 };
+
+	u64_t		prev, xval, ctl;
+	int		N, plz, ptz;
+
+	if (codecGet64(&br, &prev, 64) < 0)
+		return -1;
+
+	*place = codecDouble(prev);
+
+	plz = 0;
+	ptz = 0;
+
+	for (N = 1; N < lN; ++N) {
+
+		place += stride;
+
+		if (codecGet(&br, &ctl, 1) < 0)
+			return -1;
+
+		if (ctl != 0ULL) {
+
+			if (codecGet(&br, &ctl, 1) < 0)
+				return -1;
+
+			if (ctl != 0ULL) {
+
+				if (codecGet(&br, &ctl, 11) < 0)
+					return -1;
+
+				plz = (int) (ctl >> 6);
+				ptz = 64 - plz - (int) (ctl & 0x3FU) - 1;
+
+				if (ptz < 0)
+					return -1;
+			}
+
+			if (codecGet64(&br, &xval, 64 - plz - ptz) < 0)
+				return -1;
+
+			prev ^= xval << ptz;
+		}
+
+		*place = codecDouble(prev);
+	}
+
+	return br.rp;
+}
+
+static int
+codecPutVarint(bitw_t *bw, s64_t ival)
+{
+	u64_t		zval;
+
+	zval = ((u64_t) ival << 1) ^ (u64_t) (ival >> 63);
+
+	while (zval >= 0x80ULL) {
+
+		if (codecPut(bw, 0x80ULL | (zval & 0x7FULL), 8) < 0)
+			return -1;
+
+		zval >>= 7;
+	}
+
+	return codecPut(bw, zval, 8);
+}
+
+static int
+codecGetVarint(bitr_t *br, s64_t *ival)
+{
+	u64_t		zval, bval;
+	int		shift = 0;
+
+	zval = 0ULL;
+
+	do {
+		if (shift > 63 || codecGet(br, &bval, 8) < 0)
+			return -1;
+
+		zval |= (bval & 0x7FULL) << shift;
+		shift += 7;
+	}
+	while (bval & 0x80ULL);
+
+	*ival = (s64_t) (zval >> 1) ^ - (s64_t) (zval & 1ULL);
+
+	return 0;
+}
+
+static int
+codecEncodeDeltaInt(const double *place, int stride, int lN, char *pack, int limit)
+{
+	bitw_t		bw = { (unsigned char *) pack, 0, limit, 0ULL, 0 };
+
+	s64_t		ival, prev, delta;
+	int		N;
+
+	prev = 0;
+	delta = 0;
+
+	for (N = 0; N < lN; ++N) {
+
+		/* Integer values below 2^53 are exact in double.
+		 * */
+		if ((0x7FFU & (unsigned) (codecBits(*place) >> 52)) >= 1023U + 53U)
+			return -1;
+
+		ival = (s64_t) *place;
+
+		if (codecBits((double) ival) != codecBits(*place))
+			return -1;
+
+		if (codecPutVarint(&bw, (ival - prev) - delta) < 0)
+			return -1;
+
+		delta = ival - prev;
+		prev = ival;
+
+		place += stride;
+	}
+
+	return codecFlush(&bw);
+}
+
+static int
+codecDecodeDeltaInt(double *place, int stride, int lN, const char *pack, int length)
+{
+	bitr_t		br = { (const unsigned char *) pack, length, 0, 0ULL, 0 };
+
+	s64_t		dval, prev, delta;
+	int		N;
+
+	prev = 0;
+	delta = 0;
+
+	for (N = 0; N < lN; ++N) {
+
+		if (codecGetVarint(&br, &dval) < 0)
+			return -1;
+
+		delta += dval;
+		prev += delta;
+
+		*place = (double) prev;
+		place += stride;
+	}
+
+	return br.rp;
+}
+
+static const codec_t	codec_list[CODEC_MAX] = {
+
+	[CODEC_FP_32]		= { &codecEncodeFP32, &codecDecodeFP32 },
+	[CODEC_FP_64]		= { &codecEncodeFP64, &codecDecodeFP64 },
+	[CODEC_XOR_64]		= { &codecEncodeXOR64, &codecDecodeXOR64 },
+	[CODEC_DELTA_INT]	= { &codecEncodeDeltaInt, &codecDecodeDeltaInt }
+};
+
+int codecEncode(int codec, const double *place, int stride, int lN, char *pack, int limit)
+{
+	if (codec < 0 || codec >= CODEC_MAX || lN < 1)
+		return -1;
+
+	return codec_list[codec].encode(place, stride, lN, pack, limit);
+}
+
+int codecDecode(int codec, double *place, int stride, int lN, const char *pack, int length)
+{
+	if (codec < 0 || codec >= CODEC_MAX || lN < 1)
+		return -1;
+
+	return codec_list[codec].decode(place, stride, lN, pack, length);
+}
+
+int codecEncodeBest(int *codec, const double *place, int stride, int lN, char *pack, int limit)
+{
+	int		N, length, best = -1;
+
+	/* Measure all codecs first then encode by the shortest one.
+	 * */
+	for (N = 0; N < CODEC_MAX; ++N) {
+
+		length = codec_list[N].encode(place, stride, lN, NULL, limit);
+
+		if (length >= 0) {
+
+			best = N;
+			limit = length - 1;
+		}
+	}
+
+	if (best < 0)
+		return -1;
+
+	*codec = best;
+
+	return codec_list[best].encode(place, stride, lN, pack, limit + 1);
+}
+
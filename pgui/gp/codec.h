@@ -0,0 +1,41 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_CODEC_
+#define _H_CODEC_
+
+/* Column codecs are used to pack the dataset chunks before LZ4. Each codec
+ * is lossless, encoder returns -1 if it cannot represent the column exactly
+ * or the result does not fit into the given limit.
+ * */
+
+enum {
+	CODEC_FP_32			= 0,
+	CODEC_FP_64,
+	CODEC_XOR_64,
+	CODEC_DELTA_INT,
+	CODEC_MAX
+};
+
+int codecEncode(int codec, const double *place, int stride, int lN, char *pack, int limit);
+int codecDecode(int codec, double *place, int stride, int lN, const char *pack, int length);
+
+int codecEncodeBest(int *codec, const double *place, int stride, int lN, char *pack, int limit);
+
+#endif /* _H_CODEC_ */
+
@@ -182,11 +182,98 @@ int file_remove(const char *file)
 	return (DeleteFileW(wfile) != 0) ? ENT_OK : ENT_ERROR_UNKNOWN;
 }
 
+int file_rename(const char *file, const char *newfile)
+{
+	wchar_t			wfile[DIRENT_PATH_MAX];
+	wchar_t			wnewfile[DIRENT_PATH_MAX];
+
+	MultiByteToWideChar(CP_UTF8, 0, file, -1, wfile, DIRENT_PATH_MAX);
+	MultiByteToWideChar(CP_UTF8, 0, newfile, -1, wnewfile, DIRENT_PATH_MAX);
+
+	return (MoveFileExW(wfile, wnewfile, MOVEFILE_REPLACE_EXISTING) != 0)
+		? ENT_OK : ENT_ERROR_UNKNOWN;
+}
+
+FILE *file_tmpfile()
+{
+	wchar_t			wpath[DIRENT_PATH_MAX];
+	wchar_t			wfile[DIRENT_PATH_MAX];
+
+	/* MSVCRT tmpfile() creates the file in the root of the drive which
+	 * is not writable without admin rights. We use the user temporary
+	 * directory and let CRT remove the file on close.
+	 * */
+	if (GetTempPathW(DIRENT_PATH_MAX, wpath) == 0)
+		return NULL;
+
+	if (GetTempFileNameW(wpath, L"gp", 0, wfile) == 0)
+		return NULL;
+
+	return _wfopen(wfile, L"w+bTD");
+}
+
+int file_map_open(struct file_map *fm, const char *file)
+{
+	wchar_t			wfile[DIRENT_PATH_MAX];
+	HANDLE			hFile, hMap;
+	LARGE_INTEGER		nSize = { 0 } ;
+	void			*raw = NULL;
+
+	MultiByteToWideChar(CP_UTF8, 0, file, -1, wfile, DIRENT_PATH_MAX);
+
+	hFile = CreateFileW(wfile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE) {
+
+		return ENT_ERROR_UNKNOWN;
+	}
+
+	if (GetFileSizeEx(hFile, &nSize) != 0 && nSize.QuadPart > 0) {
+
+		hMap = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (hMap != NULL) {
+
+			raw = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+
+			/* The view keeps the mapping object alive.
+			 * */
+			CloseHandle(hMap);
+		}
+	}
+
+	CloseHandle(hFile);
+
+	if (raw == NULL) {
+
+		return ENT_ERROR_UNKNOWN;
+	}
+
+	fm->raw = (const void *) raw;
+	fm->nsize = nSize.QuadPart;
+
+	return ENT_OK;
+}
+
+void file_map_close(struct file_map *fm)
+{
+	if (fm->raw != NULL) {
+
+		UnmapViewOfFile(fm->raw);
+	}
+
+	fm->raw = NULL;
+	fm->nsize = 0U;
+}
+
 #else /* _WINDOWS */
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 struct dirent_priv {
@@ -312,5 +399,58 @@ int file_remove(const char *file)
 	return (remove(file) == 0) ? ENT_OK : ENT_ERROR_UNKNOWN;
 }
 
+int file_rename(const char *file, const char *newfile)
+{
+	return (rename(file, newfile) == 0) ? ENT_OK : ENT_ERROR_UNKNOWN;
+}
+
+FILE *file_tmpfile()
+{
+	return tmpfile();
+}
+
+int file_map_open(struct file_map *fm, const char *file)
+{
+	struct stat		sb;
+	void			*raw = MAP_FAILED;
+	int			fd;
+
+	fd = open(file, O_RDONLY);
+
+	if (fd < 0) {
+
+		return ENT_ERROR_UNKNOWN;
+	}
+
+	if (		fstat(fd, &sb) == 0 && sb.st_size > 0
+			&& (unsigned long long) sb.st_size <= (size_t) -1) {
+
+		raw = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+
+	close(fd);
+
+	if (raw == MAP_FAILED) {
+
+		return ENT_ERROR_UNKNOWN;
+	}
+
+	fm->raw = (const void *) raw;
+	fm->nsize = sb.st_size;
+
+	return ENT_OK;
+}
+
+void file_map_close(struct file_map *fm)
+{
+	if (fm->raw != NULL) {
+
+		munmap((void *) fm->raw, (size_t) fm->nsize);
+	}
+
+	fm->raw = NULL;
+	fm->nsize = 0U;
+}
+
 #endif /* _WINDOWS */
 
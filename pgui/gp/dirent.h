@@ -19,6 +19,8 @@
 #ifndef _H_DIRENT_
 #define _H_DIRENT_
 
+#include <stdio.h>
+
 #define DIRENT_PATH_MAX			272
 
 #ifdef _WINDOWS
@@ -52,6 +54,12 @@ struct dirent_stat {
 	struct dirent_priv	*priv;
 };
 
+struct file_map {
+
+	const void		*raw;
+	unsigned long long	nsize;
+};
+
 int dirent_open(struct dirent_stat *sb, const char *path);
 int dirent_rewind(struct dirent_stat *sb);
 int dirent_read(struct dirent_stat *sb);
@@ -59,6 +67,11 @@ void dirent_close(struct dirent_stat *sb);
 
 int file_stat(const char *file, unsigned long long *nsize);
 int file_remove(const char *file);
+int file_rename(const char *file, const char *newfile);
+FILE *file_tmpfile();
+
+int file_map_open(struct file_map *fm, const char *file);
+void file_map_close(struct file_map *fm);
 
 #endif /* _H_DIRENT_ */
 
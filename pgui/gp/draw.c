@@ -17,6 +17,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <SDL2/SDL.h>
@@ -608,6 +609,15 @@ void drawLineCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	if (dw->tile != 0) {
+
+		/* We only draw the rows of our tile but the shape is
+		 * computed in full so that tiles are matched.
+		 * */
+		lcb.min_y = (lcb.min_y < dw->tile_min_y) ? dw->tile_min_y : lcb.min_y;
+		lcb.max_y = (lcb.max_y > dw->tile_max_y) ? dw->tile_max_y : lcb.max_y;
+	}
+
 	l = (xs - xe) * (xs - xe) + (ys - ye) * (ys - ye);
 	d = (int) sqrtf((float) l);
 
@@ -1438,6 +1448,12 @@ void drawDashCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	if (dw->tile != 0) {
+
+		lcb.min_y = (lcb.min_y < dw->tile_min_y) ? dw->tile_min_y : lcb.min_y;
+		lcb.max_y = (lcb.max_y > dw->tile_max_y) ? dw->tile_max_y : lcb.max_y;
+	}
+
 	e = (xs - xe) * (xs - xe) + (ys - ye) * (ys - ye);
 	d = (int) sqrtf((float) e);
 
@@ -2501,6 +2517,12 @@ void drawDotCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	lcb.max_x = (lcb.max_x > cb->max_x) ? cb->max_x : lcb.max_x;
 	lcb.max_y = (lcb.max_y > cb->max_y) ? cb->max_y : lcb.max_y;
 
+	if (dw->tile != 0) {
+
+		lcb.min_y = (lcb.min_y < dw->tile_min_y) ? dw->tile_min_y : lcb.min_y;
+		lcb.max_y = (lcb.max_y > dw->tile_max_y) ? dw->tile_max_y : lcb.max_y;
+	}
+
 	if (round == 0) {
 
 		w1 = lcb.min_x * 16 - xs + 8;
@@ -3315,12 +3337,98 @@ void drawMarkCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs,
 	}
 }
 
+void drawDensityCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb,
+		const Uint32 *count, int yspan, const int *map_X, const int *map_Y,
+		Uint32 count_max, int ncol)
+{
+	Uint32			*pixels = (Uint32 *) surface->pixels;
+	Uint8			*ltgamma = dw->ltgamma;
+	Uint8			*ltcomap = dw->ltcomap;
+
+	const Uint32		*line;
+
+	float			flog;
+	int			pitch, x, y, n, a, blend[3];
+
+	union {
+
+		Uint32          l;
+		Uint8           b[4];
+	}
+	vcol, fcol;
+
+	if (pixels == NULL || count_max == 0)
+		return ;
+
+	/* Single hits are still visible with 1/4 of colour and the rest of
+	 * range is filled in log scale.
+	 * */
+	flog = (count_max > 1) ? 191.f / logf((float) count_max) : 0.f;
+
+	fcol.l = dw->palette[ncol];
+
+	pitch = surface->pitch / 4;
+	pixels += cb->min_y * pitch;
+
+	for (y = cb->min_y; y <= cb->max_y; ++y) {
+
+		if (map_Y[y - cb->min_y] >= 0) {
+
+			line = count + map_Y[y - cb->min_y] * yspan;
+
+			for (x = cb->min_x; x <= cb->max_x; ++x) {
+
+				if (map_X[x - cb->min_x] < 0)
+					continue;
+
+				n = (int) line[map_X[x - cb->min_x]];
+
+				if (n == 0)
+					continue;
+
+				a = 64 + (int) (logf((float) n) * flog);
+				a = (a > 255) ? 255 : a;
+
+				vcol.l = *(pixels + x);
+
+				if (dw->antialiasing != DRAW_SOLID) {
+
+					blend[0] = ltcomap[vcol.b[0]] * (255 - a) + fcol.b[0] * a;
+					blend[1] = ltcomap[vcol.b[1]] * (255 - a) + fcol.b[1] * a;
+					blend[2] = ltcomap[vcol.b[2]] * (255 - a) + fcol.b[2] * a;
+
+					vcol.b[0] = ltgamma[(blend[0] / 255) & 0xFFU];
+					vcol.b[1] = ltgamma[(blend[1] / 255) & 0xFFU];
+					vcol.b[2] = ltgamma[(blend[2] / 255) & 0xFFU];
+				}
+				else {
+					blend[0] = vcol.b[0] * (255 - a) + fcol.b[0] * a;
+					blend[1] = vcol.b[1] * (255 - a) + fcol.b[1] * a;
+					blend[2] = vcol.b[2] * (255 - a) + fcol.b[2] * a;
+
+					vcol.b[0] = (Uint8) (blend[0] / 255);
+					vcol.b[1] = (Uint8) (blend[1] / 255);
+					vcol.b[2] = (Uint8) (blend[2] / 255);
+				}
+
+				vcol.b[3] = 0;
+
+				*(pixels + x) = vcol.l;
+			}
+		}
+
+		pixels += pitch;
+	}
+}
+
 void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
 {
 	Uint32			*pixels = (Uint32 *) surface->pixels;
 	Uint32			*palette = dw->palette;
 	Uint8			*ltgamma = dw->ltgamma;
 
+	Uint64			nw;
+
 	int			pitch, x, y;
 	int			yspan, ncol, blend[3];
 
@@ -3338,6 +3446,19 @@ void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
 
 			for (x = cb->min_x; x <= cb->max_x; ++x) {
 
+				if ((x & 7) == 0 && x + 7 <= cb->max_x) {
+
+					/* Skip the empty word of canvas at once.
+					 * */
+					memcpy(&nw, canvas + x, sizeof(Uint64));
+
+					if (nw == 0) {
+
+						x += 7;
+						continue;
+					}
+				}
+
 				nb = *(canvas + x);
 
 				if (nb != 0) {
@@ -3368,6 +3489,17 @@ void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
 
 			for (x = cb->min_x; x <= cb->max_x; ++x) {
 
+				if ((x & 3) == 0 && x + 3 <= cb->max_x) {
+
+					memcpy(&nw, canvas + x, sizeof(Uint64));
+
+					if (nw == 0) {
+
+						x += 3;
+						continue;
+					}
+				}
+
 				nb = *(canvas + x);
 
 				if (nb != 0) {
@@ -3433,6 +3565,17 @@ void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb)
 
 			for (x = cb->min_x; x <= cb->max_x; ++x) {
 
+				if ((x & 1) == 0 && x + 1 <= cb->max_x) {
+
+					memcpy(&nw, canvas + x * 2, sizeof(Uint64));
+
+					if (nw == 0) {
+
+						x += 1;
+						continue;
+					}
+				}
+
 				nb[0] = *(canvas + x * 2 + 0);
 				nb[1] = *(canvas + x * 2 + 1);
 
@@ -66,6 +66,10 @@ typedef struct {
 
 	int		dash_context;
 
+	int		tile;
+	int		tile_min_y;
+	int		tile_max_y;
+
 	int		cached_x;
 	int		cached_min_y;
 	int		cached_max_y;
@@ -137,6 +141,10 @@ int drawDotTrial(draw_t *dw, clipBox_t *cb, double fxs, double fys,
 void drawMarkCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb, double fxs, double fys,
 		int rsize, int shape, int ncol, int thickness);
 
+void drawDensityCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb,
+		const Uint32 *count, int yspan, const int *map_X, const int *map_Y,
+		Uint32 count_max, int ncol);
+
 void drawFlushCanvas(draw_t *dw, SDL_Surface *surface, clipBox_t *cb);
 
 #endif /* _H_DRAW_ */
@@ -0,0 +1,577 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "expr.h"
+
+enum {
+	EXPR_CONST			= 0,
+	EXPR_COLUMN,
+	EXPR_NEG,
+	EXPR_ABS,
+	EXPR_SQRT,
+	EXPR_EXP,
+	EXPR_LOG,
+	EXPR_SIN,
+	EXPR_COS,
+	EXPR_TAN,
+	EXPR_ADD,
+	EXPR_SUB,
+	EXPR_MUL,
+	EXPR_DIV,
+	EXPR_POW,
+	EXPR_ATAN2,
+	EXPR_HYPOT,
+	EXPR_MIN,
+	EXPR_MAX
+};
+
+typedef struct {
+
+	const char	*name;
+	int		code;
+	int		args;
+}
+expr_func_t;
+
+typedef struct {
+
+	expr_t		*ex;
+
+	const char	*text;
+	int		pos;
+	int		depth;
+
+	int		column_X;
+	int		column_Y;
+	int		column_N;
+
+	int		failed;
+}
+expr_parse_t;
+
+static const expr_func_t	expr_func[] = {
+
+	{ "abs", EXPR_ABS, 1 },
+	{ "sqrt", EXPR_SQRT, 1 },
+	{ "exp", EXPR_EXP, 1 },
+	{ "log", EXPR_LOG, 1 },
+	{ "sin", EXPR_SIN, 1 },
+	{ "cos", EXPR_COS, 1 },
+	{ "tan", EXPR_TAN, 1 },
+	{ "atan2", EXPR_ATAN2, 2 },
+	{ "hypot", EXPR_HYPOT, 2 },
+	{ "min", EXPR_MIN, 2 },
+	{ "max", EXPR_MAX, 2 },
+	{ "pow", EXPR_POW, 2 },
+
+	{ NULL, 0, 0 }
+};
+
+static double
+exprApply(int code, double a, double b)
+{
+	switch (code) {
+
+		case EXPR_NEG:		return - a;
+		case EXPR_ABS:		return fabs(a);
+		case EXPR_SQRT:		return sqrt(a);
+		case EXPR_EXP:		return exp(a);
+		case EXPR_LOG:		return log(a);
+		case EXPR_SIN:		return sin(a);
+		case EXPR_COS:		return cos(a);
+		case EXPR_TAN:		return tan(a);
+		case EXPR_ADD:		return a + b;
+		case EXPR_SUB:		return a - b;
+		case EXPR_MUL:		return a * b;
+		case EXPR_DIV:		return a / b;
+		case EXPR_POW:		return pow(a, b);
+		case EXPR_ATAN2:	return atan2(a, b);
+		case EXPR_HYPOT:	return sqrt(a * a + b * b);
+		case EXPR_MIN:		return (a < b) ? a : b;
+		case EXPR_MAX:		return (a > b) ? a : b;
+
+		default:		return a;
+	}
+}
+
+static void
+exprEmit(expr_parse_t *pa, int code, int column, double value)
+{
+	expr_t		*ex = pa->ex;
+	expr_op_t	*op;
+
+	if (pa->failed != 0)
+		return ;
+
+	if (code >= EXPR_ADD) {
+
+		/* Fold the constant operands.
+		 * */
+		if (		ex->op_N >= 2
+				&& ex->op[ex->op_N - 1].code == EXPR_CONST
+				&& ex->op[ex->op_N - 2].code == EXPR_CONST) {
+
+			op = &ex->op[ex->op_N - 2];
+			op->value = exprApply(code, op->value, ex->op[ex->op_N - 1].value);
+
+			ex->op_N -= 1;
+			pa->depth -= 1;
+
+			return ;
+		}
+
+		pa->depth -= 1;
+	}
+	else if (code >= EXPR_NEG) {
+
+		if (		ex->op_N >= 1
+				&& ex->op[ex->op_N - 1].code == EXPR_CONST) {
+
+			op = &ex->op[ex->op_N - 1];
+			op->value = exprApply(code, op->value, 0.);
+
+			return ;
+		}
+	}
+	else {
+		pa->depth += 1;
+
+		if (pa->depth > EXPR_STACK_MAX) {
+
+			pa->failed = 1;
+			return ;
+		}
+	}
+
+	if (ex->op_N >= EXPR_CODE_MAX) {
+
+		pa->failed = 1;
+		return ;
+	}
+
+	op = &ex->op[ex->op_N++];
+
+	op->code = code;
+	op->column = column;
+	op->value = value;
+}
+
+static int
+exprPeek(expr_parse_t *pa)
+{
+	while (isspace((unsigned char) pa->text[pa->pos]))
+		pa->pos++;
+
+	return (unsigned char) pa->text[pa->pos];
+}
+
+static int
+exprAccept(expr_parse_t *pa, int c)
+{
+	if (exprPeek(pa) == c) {
+
+		pa->pos++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void exprSum(expr_parse_t *pa);
+static void exprUnary(expr_parse_t *pa);
+
+static void
+exprPrimary(expr_parse_t *pa)
+{
+	char		name[EXPR_TEXT_MAX], *end;
+	int		c, N, column, args;
+
+	double		value;
+
+	c = exprPeek(pa);
+
+	if (pa->failed != 0)
+		return ;
+
+	if (c == '(') {
+
+		pa->pos++;
+
+		exprSum(pa);
+
+		if (exprAccept(pa, ')') == 0)
+			pa->failed = 1;
+	}
+	else if (c == '$') {
+
+		pa->pos++;
+
+		column = (int) strtol(pa->text + pa->pos, &end, 10);
+
+		if (		end == pa->text + pa->pos
+				|| column < -1 || column >= pa->column_N) {
+
+			pa->failed = 1;
+			return ;
+		}
+
+		pa->pos = end - pa->text;
+
+		exprEmit(pa, EXPR_COLUMN, column, 0.);
+	}
+	else if (isdigit(c) || c == '.') {
+
+		value = strtod(pa->text + pa->pos, &end);
+
+		if (end == pa->text + pa->pos) {
+
+			pa->failed = 1;
+			return ;
+		}
+
+		pa->pos = end - pa->text;
+
+		exprEmit(pa, EXPR_CONST, 0, value);
+	}
+	else if (isalpha(c) || c == '_') {
+
+		N = 0;
+
+		while (		isalnum((unsigned char) pa->text[pa->pos])
+				|| pa->text[pa->pos] == '_') {
+
+			if (N < EXPR_TEXT_MAX - 1)
+				name[N++] = pa->text[pa->pos];
+
+			pa->pos++;
+		}
+
+		name[N] = 0;
+
+		if (strcmp(name, "x") == 0) {
+
+			exprEmit(pa, EXPR_COLUMN, pa->column_X, 0.);
+		}
+		else if (strcmp(name, "y") == 0) {
+
+			exprEmit(pa, EXPR_COLUMN, pa->column_Y, 0.);
+		}
+		else if (strcmp(name, "pi") == 0) {
+
+			exprEmit(pa, EXPR_CONST, 0, M_PI);
+		}
+		else {
+			for (N = 0; expr_func[N].name != NULL; ++N) {
+
+				if (strcmp(name, expr_func[N].name) == 0)
+					break;
+			}
+
+			if (		expr_func[N].name == NULL
+					|| exprAccept(pa, '(') == 0) {
+
+				pa->failed = 1;
+				return ;
+			}
+
+			for (args = 0; args < expr_func[N].args; ++args) {
+
+				if (args > 0 && exprAccept(pa, ',') == 0) {
+
+					pa->failed = 1;
+					return ;
+				}
+
+				exprSum(pa);
+			}
+
+			if (exprAccept(pa, ')') == 0) {
+
+				pa->failed = 1;
+				return ;
+			}
+
+			exprEmit(pa, expr_func[N].code, 0, 0.);
+		}
+	}
+	else {
+		pa->failed = 1;
+	}
+}
+
+static void
+exprPower(expr_parse_t *pa)
+{
+	exprPrimary(pa);
+
+	if (exprAccept(pa, '^') != 0) {
+
+		exprUnary(pa);
+		exprEmit(pa, EXPR_POW, 0, 0.);
+	}
+}
+
+static void
+exprUnary(expr_parse_t *pa)
+{
+	if (exprAccept(pa, '-') != 0) {
+
+		exprUnary(pa);
+		exprEmit(pa, EXPR_NEG, 0, 0.);
+	}
+	else if (exprAccept(pa, '+') != 0) {
+
+		exprUnary(pa);
+	}
+	else {
+		exprPower(pa);
+	}
+}
+
+static void
+exprProduct(expr_parse_t *pa)
+{
+	exprUnary(pa);
+
+	while (pa->failed == 0) {
+
+		if (exprAccept(pa, '*') != 0) {
+
+			exprUnary(pa);
+			exprEmit(pa, EXPR_MUL, 0, 0.);
+		}
+		else if (exprAccept(pa, '/') != 0) {
+
+			exprUnary(pa);
+			exprEmit(pa, EXPR_DIV, 0, 0.);
+		}
+		else
+			break;
+	}
+}
+
+static void
+exprSum(expr_parse_t *pa)
+{
+	exprProduct(pa);
+
+	while (pa->failed == 0) {
+
+		if (exprAccept(pa, '+') != 0) {
+
+			exprProduct(pa);
+			exprEmit(pa, EXPR_ADD, 0, 0.);
+		}
+		else if (exprAccept(pa, '-') != 0) {
+
+			exprProduct(pa);
+			exprEmit(pa, EXPR_SUB, 0, 0.);
+		}
+		else
+			break;
+	}
+}
+
+int exprParse(expr_t *ex, const char *text, int column_X, int column_Y, int column_N)
+{
+	expr_parse_t	pa;
+
+	if (strlen(text) >= EXPR_TEXT_MAX) {
+
+		ex->error = EXPR_TEXT_MAX;
+		return -1;
+	}
+
+	strcpy(ex->text, text);
+
+	ex->column_N = column_N;
+	ex->error = 0;
+	ex->op_N = 0;
+
+	pa.ex = ex;
+	pa.text = ex->text;
+	pa.pos = 0;
+	pa.depth = 0;
+
+	pa.column_X = column_X;
+	pa.column_Y = column_Y;
+	pa.column_N = column_N;
+
+	pa.failed = 0;
+
+	exprSum(&pa);
+
+	if (pa.failed == 0 && exprPeek(&pa) != 0) {
+
+		pa.failed = 1;
+	}
+
+	if (pa.failed != 0) {
+
+		ex->error = pa.pos;
+		ex->op_N = 0;
+
+		return -1;
+	}
+
+	return 0;
+}
+
+int exprLinked(const expr_t *ex, int cN)
+{
+	int		N, linked = 0;
+
+	for (N = 0; N < ex->op_N; ++N) {
+
+		if (		ex->op[N].code == EXPR_COLUMN
+				&& ex->op[N].column == cN) {
+
+			linked++;
+		}
+	}
+
+	return linked;
+}
+
+void exprEval(expr_t *ex, double *result, const double * const *row, double id, int length)
+{
+	const expr_op_t	*op;
+
+	double		* restrict a, * restrict b;
+	int		N, sp, lN, cN;
+
+	sp = 0;
+
+	for (N = 0; N < ex->op_N; ++N) {
+
+		op = &ex->op[N];
+
+		a = (op->code < EXPR_NEG) ? ex->stack[sp++]
+			: (op->code < EXPR_ADD) ? ex->stack[sp - 1]
+			: ex->stack[--sp - 1];
+
+		b = (op->code < EXPR_ADD) ? a : ex->stack[sp];
+
+		switch (op->code) {
+
+			case EXPR_CONST:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = op->value;
+				break;
+
+			case EXPR_COLUMN:
+
+				cN = op->column;
+
+				if (cN < 0) {
+
+					for (lN = 0; lN < length; ++lN)
+						a[lN] = id + (double) lN;
+				}
+				else {
+					for (lN = 0; lN < length; ++lN)
+						a[lN] = row[lN][cN];
+				}
+				break;
+
+			case EXPR_NEG:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = - a[lN];
+				break;
+
+			case EXPR_ABS:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = fabs(a[lN]);
+				break;
+
+			case EXPR_SQRT:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = sqrt(a[lN]);
+				break;
+
+			case EXPR_ADD:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = a[lN] + b[lN];
+				break;
+
+			case EXPR_SUB:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = a[lN] - b[lN];
+				break;
+
+			case EXPR_MUL:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = a[lN] * b[lN];
+				break;
+
+			case EXPR_DIV:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = a[lN] / b[lN];
+				break;
+
+			case EXPR_HYPOT:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = sqrt(a[lN] * a[lN] + b[lN] * b[lN]);
+				break;
+
+			case EXPR_MIN:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = (a[lN] < b[lN]) ? a[lN] : b[lN];
+				break;
+
+			case EXPR_MAX:
+
+				for (lN = 0; lN < length; ++lN)
+					a[lN] = (a[lN] > b[lN]) ? a[lN] : b[lN];
+				break;
+
+			default:
+
+				/* Transcendental functions are not vectorised.
+				 * */
+				if (op->code < EXPR_ADD) {
+
+					for (lN = 0; lN < length; ++lN)
+						a[lN] = exprApply(op->code, a[lN], 0.);
+				}
+				else {
+					for (lN = 0; lN < length; ++lN)
+						a[lN] = exprApply(op->code, a[lN], b[lN]);
+				}
+				break;
+		}
+	}
+
+	memcpy(result, ex->stack[0], sizeof(double) * length);
+}
+
@@ -0,0 +1,76 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_EXPR_
+#define _H_EXPR_
+
+/* Expression is parsed once into the stack bytecode and then evaluated over
+ * the block of rows at once. Each operation runs a plain loop over vectors
+ * so the compiler is able to use SIMD instructions.
+ *
+ * Syntax is usual arithmetic with (+ - * / ^) operators and parentheses.
+ * Operands are numbers, column references ($N), figure columns (x, y),
+ * constant (pi) and functions (abs, sqrt, exp, log, sin, cos, tan, atan2,
+ * hypot, min, max, pow).
+ * */
+
+#define EXPR_TEXT_MAX			200
+#define EXPR_CODE_MAX			80
+#define EXPR_STACK_MAX			16
+#define EXPR_BLOCK			256
+
+typedef struct {
+
+	int		code;
+	int		column;
+	double		value;
+}
+expr_op_t;
+
+typedef struct {
+
+	char		text[EXPR_TEXT_MAX];
+
+	int		column_N;
+	int		error;
+
+	expr_op_t	op[EXPR_CODE_MAX];
+	int		op_N;
+
+	double		stack[EXPR_STACK_MAX][EXPR_BLOCK];
+}
+expr_t;
+
+/* The function parses the \text and returns zero on success. Columns \x and
+ * \y are substituted by \column_X and \column_Y, any column reference must
+ * be less than \column_N. Column -1 means the row number. On failure the
+ * function returns -1 and \error keeps the position in \text.
+ * */
+int exprParse(expr_t *ex, const char *text, int column_X, int column_Y, int column_N);
+
+/* The function returns the number of references to the column \cN.
+ * */
+int exprLinked(const expr_t *ex, int cN);
+
+/* The function evaluates the expression over \length rows and stores the
+ * result into \result. The row number of the first row is \id.
+ * */
+void exprEval(expr_t *ex, double *result, const double * const *row, double id, int length);
+
+#endif /* _H_EXPR_ */
+
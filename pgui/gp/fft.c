@@ -0,0 +1,213 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "fft.h"
+
+fft_t *fftAlloc(int length)
+{
+	fft_t		*ft;
+
+	double		fw;
+	int		N, M, bN, shift, rN;
+
+	for (shift = FFT_SHIFT_MIN; shift <= FFT_SHIFT_MAX; ++shift) {
+
+		if (length == (1 << shift))
+			break;
+	}
+
+	if (shift > FFT_SHIFT_MAX)
+		return NULL;
+
+	M = length / 2;
+
+	/* We keep all tables in one block so the caller frees it by free().
+	 * */
+	ft = (fft_t *) malloc(sizeof(fft_t) + sizeof(double)
+			+ M * (5 * sizeof(double) + sizeof(int)));
+
+	if (ft == NULL)
+		return NULL;
+
+	ft->length = length;
+
+	ft->twiddle = (double *) (((size_t) (ft + 1) + sizeof(double) - 1)
+			& ~(sizeof(double) - 1));
+
+	ft->rotate = ft->twiddle + M;
+	ft->window = ft->rotate + 2 * M;
+	ft->reverse = (int *) (ft->window + length);
+
+	for (N = 0; N < M / 2; ++N) {
+
+		fw = - 2. * M_PI * (double) N / (double) M;
+
+		ft->twiddle[N * 2 + 0] = cos(fw);
+		ft->twiddle[N * 2 + 1] = sin(fw);
+	}
+
+	for (N = 0; N < M; ++N) {
+
+		fw = - 2. * M_PI * (double) N / (double) length;
+
+		ft->rotate[N * 2 + 0] = cos(fw);
+		ft->rotate[N * 2 + 1] = sin(fw);
+	}
+
+	for (N = 0; N < M; ++N) {
+
+		rN = 0;
+
+		for (bN = 0; bN < shift - 1; ++bN)
+			rN |= ((N >> bN) & 1) << (shift - 2 - bN);
+
+		ft->reverse[N] = rN;
+	}
+
+	ft->wsum = 0.;
+
+	for (N = 0; N < length; ++N) {
+
+		fw = 0.5 - 0.5 * cos(2. * M_PI * (double) N / (double) length);
+
+		ft->window[N] = fw;
+		ft->wsum += fw * fw;
+	}
+
+	return ft;
+}
+
+int fftWorkSize(const fft_t *ft)
+{
+	return ft->length;
+}
+
+static void
+fftComplex(const fft_t *ft, double *z)
+{
+	const double	*tw = ft->twiddle;
+
+	double		wr, wi, ur, ui, tr, ti;
+	int		M, N, rN, bN, jN, half, step;
+
+	M = ft->length / 2;
+
+	for (N = 0; N < M; ++N) {
+
+		rN = ft->reverse[N];
+
+		if (N < rN) {
+
+			tr = z[N * 2 + 0];
+			ti = z[N * 2 + 1];
+
+			z[N * 2 + 0] = z[rN * 2 + 0];
+			z[N * 2 + 1] = z[rN * 2 + 1];
+
+			z[rN * 2 + 0] = tr;
+			z[rN * 2 + 1] = ti;
+		}
+	}
+
+	for (half = 1, step = M / 2; half < M; half *= 2, step /= 2) {
+
+		for (bN = 0; bN < M; bN += 2 * half) {
+
+			for (jN = 0; jN < half; ++jN) {
+
+				wr = tw[jN * step * 2 + 0];
+				wi = tw[jN * step * 2 + 1];
+
+				N = bN + jN;
+				rN = N + half;
+
+				tr = z[rN * 2 + 0] * wr - z[rN * 2 + 1] * wi;
+				ti = z[rN * 2 + 0] * wi + z[rN * 2 + 1] * wr;
+
+				ur = z[N * 2 + 0];
+				ui = z[N * 2 + 1];
+
+				z[N * 2 + 0] = ur + tr;
+				z[N * 2 + 1] = ui + ti;
+
+				z[rN * 2 + 0] = ur - tr;
+				z[rN * 2 + 1] = ui - ti;
+			}
+		}
+	}
+}
+
+void fftPower(const fft_t *ft, double *power, const double *x, double *work)
+{
+	double		mean, ar, ai, br, bi, er, ei, or, oi, cr, ci;
+	int		N, M, kN;
+
+	M = ft->length / 2;
+	mean = 0.;
+
+	for (N = 0; N < ft->length; ++N)
+		mean += x[N];
+
+	mean /= (double) ft->length;
+
+	/* Even samples go to real part and odd samples go to imaginary part
+	 * of the packed sequence.
+	 * */
+	for (N = 0; N < ft->length; ++N)
+		work[N] = (x[N] - mean) * ft->window[N];
+
+	fftComplex(ft, work);
+
+	for (N = 0; N <= M; ++N) {
+
+		kN = (N < M) ? N : 0;
+
+		ar = work[kN * 2 + 0];
+		ai = work[kN * 2 + 1];
+
+		kN = (N > 0) ? M - N : 0;
+
+		br = work[kN * 2 + 0];
+		bi = - work[kN * 2 + 1];
+
+		er = (ar + br) * 0.5;
+		ei = (ai + bi) * 0.5;
+
+		or = (ai - bi) * 0.5;
+		oi = (br - ar) * 0.5;
+
+		if (N < M) {
+
+			cr = ft->rotate[N * 2 + 0];
+			ci = ft->rotate[N * 2 + 1];
+		}
+		else {
+			cr = -1.;
+			ci = 0.;
+		}
+
+		ar = er + or * cr - oi * ci;
+		ai = ei + or * ci + oi * cr;
+
+		power[N] += ar * ar + ai * ai;
+	}
+}
+
@@ -0,0 +1,62 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_FFT_
+#define _H_FFT_
+
+/* Real FFT of power of two length. We do complex FFT of half length over
+ * the packed even and odd samples and then split the result into the
+ * spectrum of real sequence. The plan is read only after allocation so it
+ * can be shared by many threads, each thread has its own work buffer.
+ * */
+
+#define FFT_SHIFT_MIN			4
+#define FFT_SHIFT_MAX			24
+
+typedef struct {
+
+	int		length;
+
+	int		*reverse;
+	double		*twiddle;
+	double		*rotate;
+	double		*window;
+
+	/* Sum of squared window to normalize the power.
+	 * */
+	double		wsum;
+}
+fft_t;
+
+/* The function allocates the plan of \length samples with Hann window. The
+ * \length must be power of two. The caller frees the plan by free().
+ * */
+fft_t *fftAlloc(int length);
+
+/* The function returns the number of work buffer doubles for the plan.
+ * */
+int fftWorkSize(const fft_t *ft);
+
+/* The function removes the mean from \length samples of \x, applies the
+ * window and adds the squared magnitudes of (length / 2 + 1) spectral bins
+ * into \power.
+ * */
+void fftPower(const fft_t *ft, double *power, const double *x, double *work);
+
+#endif /* _H_FFT_ */
+
@@ -0,0 +1,336 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dirent.h"
+#include "frame.h"
+#include "lz4.h"
+
+#define FRAME_MAGIC			0x184D2204U
+#define FRAME_SKIP_MAGIC		0x184D2A50U
+#define FRAME_SKIP_MASK			0xFFFFFFF0U
+
+#define FRAME_FLG_VERSION		0x40U
+#define FRAME_FLG_INDEPENDENT		0x20U
+#define FRAME_FLG_BLOCK_SUM		0x10U
+#define FRAME_FLG_CONTENT_SIZE		0x08U
+#define FRAME_FLG_CONTENT_SUM		0x04U
+#define FRAME_FLG_DICT_ID		0x01U
+
+#define FRAME_BLOCK_RAW			0x80000000U
+
+static unsigned int
+frameGetLE(const unsigned char *b)
+{
+	return	  (unsigned int) b[0]
+		| (unsigned int) b[1] << 8
+		| (unsigned int) b[2] << 16
+		| (unsigned int) b[3] << 24;
+}
+
+static void
+frameSetLE(unsigned char *b, unsigned int x)
+{
+	b[0] = (unsigned char) (x);
+	b[1] = (unsigned char) (x >> 8);
+	b[2] = (unsigned char) (x >> 16);
+	b[3] = (unsigned char) (x >> 24);
+}
+
+static int
+frameReadLE(FILE *fd, unsigned int *x)
+{
+	unsigned char	b[4];
+
+	if (fread(b, 4, 1, fd) != 1)
+		return -1;
+
+	*x = frameGetLE(b);
+
+	return 0;
+}
+
+/* We need XXH32 of the frame descriptor only so the short input path is
+ * enough here.
+ * */
+static unsigned int
+frameHash(const unsigned char *b, int len)
+{
+	const unsigned int	P1 = 2654435761U, P2 = 2246822519U, P3 = 3266489917U,
+				P4 = 668265263U, P5 = 374761393U;
+
+	unsigned int		h;
+
+	h = P5 + (unsigned int) len;
+
+	while (len >= 4) {
+
+		h += frameGetLE(b) * P3;
+		h = ((h << 17) | (h >> 15)) * P4;
+
+		b += 4;
+		len -= 4;
+	}
+
+	while (len > 0) {
+
+		h += (unsigned int) *b * P5;
+		h = ((h << 11) | (h >> 21)) * P1;
+
+		b += 1;
+		len -= 1;
+	}
+
+	h ^= h >> 15;
+	h *= P2;
+	h ^= h >> 13;
+	h *= P3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+int frameIsPacked(FILE *fd)
+{
+	unsigned int	magic;
+	int		packed = 0;
+
+	if (frameReadLE(fd, &magic) == 0) {
+
+		packed = (magic == FRAME_MAGIC) ? 1 : 0;
+	}
+
+	fseek(fd, 0UL, SEEK_SET);
+
+	return packed;
+}
+
+int framePack(FILE *out, FILE *in)
+{
+	unsigned char	head[7];
+	char		*raw, *pack;
+	int		bound, len, rc = -1;
+
+	bound = LZ4_compressBound(FRAME_BLOCK_SIZE);
+
+	raw = (char *) malloc(FRAME_BLOCK_SIZE + 4 + bound);
+
+	if (raw == NULL)
+		return -1;
+
+	pack = raw + FRAME_BLOCK_SIZE;
+
+	frameSetLE(head, FRAME_MAGIC);
+
+	head[4] = FRAME_FLG_VERSION | FRAME_FLG_INDEPENDENT;
+	head[5] = 4U << 4;
+	head[6] = (unsigned char) (frameHash(head + 4, 2) >> 8);
+
+	if (fwrite(head, sizeof(head), 1, out) != 1)
+		goto framePack_END;
+
+	do {
+		len = (int) fread(raw, 1, FRAME_BLOCK_SIZE, in);
+
+		if (len < 1)
+			break;
+
+		bound = LZ4_compress_default(raw, pack + 4, len, LZ4_compressBound(len));
+
+		if (bound > 0 && bound < len) {
+
+			frameSetLE((unsigned char *) pack, (unsigned int) bound);
+		}
+		else {
+			/* Incompressible block is stored as is.
+			 * */
+			frameSetLE((unsigned char *) pack, (unsigned int) len | FRAME_BLOCK_RAW);
+			memcpy(pack + 4, raw, len);
+
+			bound = len;
+		}
+
+		if (fwrite(pack, bound + 4, 1, out) != 1)
+			goto framePack_END;
+	}
+	while (1);
+
+	frameSetLE(head, 0U);
+
+	if (fwrite(head, 4, 1, out) != 1)
+		goto framePack_END;
+
+	rc = ferror(in) ? -1 : 0;
+
+framePack_END:
+
+	free(raw);
+
+	return rc;
+}
+
+static int
+frameUnpackOne(FILE *out, FILE *fd)
+{
+	unsigned char	head[3];
+	unsigned int	size, flag;
+	char		*block, *pack, *dict, *prev, *swap;
+	int		bsize, len, prev_N, rc = -1;
+
+	if (fread(head, 3, 1, fd) != 1)
+		return -1;
+
+	flag = head[0];
+
+	if ((flag & 0xC0U) != FRAME_FLG_VERSION)
+		return -1;
+
+	bsize = 1 << (8 + 2 * ((head[1] >> 4) & 7U));
+
+	if (bsize < FRAME_BLOCK_SIZE)
+		return -1;
+
+	/* Skip the rest of descriptor after the third byte already read.
+	 * */
+	len = ((flag & FRAME_FLG_CONTENT_SIZE) ? 8 : 0)
+		+ ((flag & FRAME_FLG_DICT_ID) ? 4 : 0);
+
+	fseek(fd, (long) len, SEEK_CUR);
+
+	block = (char *) malloc(3 * bsize);
+
+	if (block == NULL)
+		return -1;
+
+	pack = block + 2 * bsize;
+	dict = block;
+	prev = block + bsize;
+	prev_N = 0;
+
+	do {
+		if (frameReadLE(fd, &size) != 0)
+			goto frameUnpackOne_END;
+
+		if (size == 0U)
+			break;
+
+		len = (int) (size & ~FRAME_BLOCK_RAW);
+
+		if (len > bsize)
+			goto frameUnpackOne_END;
+
+		if (fread(pack, len, 1, fd) != 1)
+			goto frameUnpackOne_END;
+
+		if (flag & FRAME_FLG_BLOCK_SUM) {
+
+			fseek(fd, 4L, SEEK_CUR);
+		}
+
+		/* Linked blocks refer to the previous block so we decode into
+		 * two halves of the buffer alternately.
+		 * */
+		if (size & FRAME_BLOCK_RAW) {
+
+			memcpy(dict, pack, len);
+		}
+		else if (flag & FRAME_FLG_INDEPENDENT) {
+
+			len = LZ4_decompress_safe(pack, dict, len, bsize);
+		}
+		else {
+			len = LZ4_decompress_safe_usingDict(pack, dict, len, bsize,
+					prev, prev_N);
+		}
+
+		if (len < 0)
+			goto frameUnpackOne_END;
+
+		if (len > 0 && fwrite(dict, len, 1, out) != 1)
+			goto frameUnpackOne_END;
+
+		prev_N = len;
+
+		swap = prev;
+		prev = dict;
+		dict = swap;
+	}
+	while (1);
+
+	if (flag & FRAME_FLG_CONTENT_SUM) {
+
+		fseek(fd, 4L, SEEK_CUR);
+	}
+
+	rc = 0;
+
+frameUnpackOne_END:
+
+	free(block);
+
+	return rc;
+}
+
+FILE *frameUnpack(FILE *fd)
+{
+	FILE		*out;
+	unsigned int	magic, size;
+	int		rc = 0;
+
+	out = file_tmpfile();
+
+	if (out == NULL) {
+
+		fclose(fd);
+		return NULL;
+	}
+
+	while (rc == 0 && frameReadLE(fd, &magic) == 0) {
+
+		if (magic == FRAME_MAGIC) {
+
+			rc = frameUnpackOne(out, fd);
+		}
+		else if ((magic & FRAME_SKIP_MASK) == FRAME_SKIP_MAGIC) {
+
+			if (frameReadLE(fd, &size) == 0) {
+
+				fseek(fd, (long) size, SEEK_CUR);
+			}
+		}
+		else {
+			rc = -1;
+		}
+	}
+
+	fclose(fd);
+
+	if (rc != 0) {
+
+		fclose(out);
+		return NULL;
+	}
+
+	fseek(out, 0UL, SEEK_SET);
+
+	return out;
+}
+
@@ -0,0 +1,48 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_FRAME_
+#define _H_FRAME_
+
+#include <stdio.h>
+
+/* Files in LZ4 frame format as written by lz4 tool. We write independent
+ * blocks without checksums and read any frame with independent or linked
+ * blocks. Skippable frames are ignored.
+ * */
+
+#define FRAME_BLOCK_SIZE		65536
+
+/* The function returns nonzero if the file begins with LZ4 frame. The file
+ * position is rewound to the start.
+ * */
+int frameIsPacked(FILE *fd);
+
+/* The function compresses the rest of \in file into \out file. It returns
+ * zero on success.
+ * */
+int framePack(FILE *out, FILE *in);
+
+/* The function decompresses the \fd file into temporary file and returns it
+ * rewound to the start. The \fd file is closed in any case. On failure the
+ * function returns NULL.
+ * */
+FILE *frameUnpack(FILE *fd);
+
+#endif /* _H_FRAME_ */
+
@@ -285,6 +285,7 @@ gpDefaultFile(gpcon_t *gp)
 				"preload 8388608\n"
 				"chunk 4096\n"
 				"timeout 5000\n"
+				"threads 0\n"
 				"windowsize 1200 900\n"
 				"language 0\n"
 				"colorscheme 0\n"
@@ -303,7 +304,9 @@ gpDefaultFile(gpcon_t *gp)
 				"fastdraw 200\n"
 				"interpolation 1\n"
 				"defungap 10\n"
-				"lz4_compress 1\n");
+				"lz4_compress 2\n"
+				"cache_budget 256\n"
+				"mmap 0\n");
 
 #ifdef _WINDOWS
 		fprintf(fd,	"legacy_label 1\n"
@@ -340,6 +343,7 @@ gpWriteFile(gpcon_t *gp)
 		fprintf(fd, "preload %i\n", rd->preload);
 		fprintf(fd, "chunk %i\n", rd->chunk);
 		fprintf(fd, "timeout %i\n", rd->timeout);
+		fprintf(fd, "threads %i\n", pl->threads);
 
 		if (gp->window != NULL) {
 
@@ -356,7 +360,8 @@ gpWriteFile(gpcon_t *gp)
 
 		drawing = (pl->default_drawing == FIGURE_DRAWING_LINE) ? "line"
 			: (pl->default_drawing == FIGURE_DRAWING_DASH) ? "dash"
-			: (pl->default_drawing == FIGURE_DRAWING_DOT) ? "dot" : "unknown";
+			: (pl->default_drawing == FIGURE_DRAWING_DOT) ? "dot"
+			: (pl->default_drawing == FIGURE_DRAWING_DENSITY) ? "density" : "unknown";
 
 		fprintf(fd, "drawing %s %i\n", drawing, pl->default_width);
 		fprintf(fd, "marker %i\n", pl->mark_size);
@@ -370,6 +375,8 @@ gpWriteFile(gpcon_t *gp)
 		fprintf(fd, "interpolation %i\n", pl->interpolation);
 		fprintf(fd, "defungap %.5g\n", pl->defungap);
 		fprintf(fd, "lz4_compress %i\n", pl->lz4_compress);
+		fprintf(fd, "cache_budget %i\n", pl->cache_budget);
+		fprintf(fd, "mmap %i\n", rd->mmap);
 
 #ifdef _WINDOWS
 		fprintf(fd, "legacy_label %i\n", rd->legacy_label);
@@ -963,6 +970,10 @@ gpSymDatasetFormat(gpcon_t *gp, int dN)
 			sym = "STUB  ";
 			break;
 
+		case FORMAT_SPECTRUM_DATA:
+			sym = "FFT   ";
+			break;
+
 		case FORMAT_TEXT_STDIN:
 			sym = "STDIN ";
 			break;
@@ -1056,7 +1067,7 @@ gpMakeColumnSelectMenu(gpcon_t *gp, int dN)
 			sN = cN - rd->data[dN].column_N;
 
 			sprintf(gp->sbuf[0], "[%3i] %c ", cN,
-					" TFSEPRAXNHDIBLMU?" [gp->pl->data[dN].sub[sN].busy]);
+					" TFSEPRAXNHDIBLMUQ?" [gp->pl->data[dN].sub[sN].busy]);
 
 			if (gp->pl->data[dN].sub[sN].busy == SUBTRACT_TIME_MEDIAN) {
 
@@ -1140,6 +1151,12 @@ gpMakeColumnSelectMenu(gpcon_t *gp, int dN)
 						gp->pl->data[dN].sub[sN].op.filter.column_Y,
 						(int) gp->pl->data[dN].sub[sN].op.filter.value);
 			}
+			else if (gp->pl->data[dN].sub[sN].busy == SUBTRACT_EXPRESSION) {
+
+				sprintf(gp->sbuf[0] + strlen(gp->sbuf[0]), "(%i, %i)",
+						gp->pl->data[dN].sub[sN].op.expr.column_X,
+						gp->pl->data[dN].sub[sN].op.expr.column_Y);
+			}
 
 			strcpy(la, gp->sbuf[0]);
 			la += strlen(la) + 1;
@@ -2692,6 +2709,20 @@ gpMenuHandle(gpcon_t *gp, int menu_N, int item_N)
 
 				gp->stat = GP_EDIT;
 				break;
+
+			case 13:
+				editRaise(ed, 28, gp->la->expression_edit,
+						"y", mu->box_X, mu->box_Y);
+
+				gp->stat = GP_EDIT;
+				break;
+
+			case 14:
+				editRaise(ed, 29, gp->la->spectrum_edit,
+						"4096", mu->box_X, mu->box_Y);
+
+				gp->stat = GP_EDIT;
+				break;
 		}
 	}
 	else if (menu_N == 303) {
@@ -3606,6 +3637,36 @@ gpEditHandle(gpcon_t *gp, int edit_N, const char *text)
 			plotFigureSubtractClean(pl, gp->fig_N, SUBTRACT_FILTER_DEMULTIPLEX);
 		}
 	}
+	else if (edit_N == 28) {
+
+		if (text[0] != 0) {
+
+			plotFigureSubtractExpression(pl, gp->fig_N, text);
+		}
+	}
+	else if (edit_N == 29) {
+
+		n = sscanf(text, "%d", &len);
+
+		if (n >= 1) {
+
+			N = readGetFreeData(rd);
+
+			if (N < 0) {
+
+				ERROR("Unable to get free dataset\n");
+				return ;
+			}
+
+			if (plotFigureSpectrum(pl, gp->fig_N, N, len) == 0) {
+
+				rd->data[N].format = FORMAT_SPECTRUM_DATA;
+				rd->data[N].column_N = 3;
+				rd->data[N].length_N = plotDataLength(pl, N);
+				rd->data[N].file[0] = 0;
+			}
+		}
+	}
 }
 
 static void
@@ -4962,6 +5023,13 @@ int gp_DataAdd(gpcon_t *gp, int dN, const double *payload)
 	return N;
 }
 
+void gp_DataLabel(gpcon_t *gp, int dN, const char *label)
+{
+	read_t		*rd = gp->rd;
+
+	readSetLabel(rd, dN, label);
+}
+
 void gp_FileReload(gpcon_t *gp)
 {
 	read_t		*rd = gp->rd;
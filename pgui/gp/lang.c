@@ -150,6 +150,7 @@ void langFill(lang_t *la, int lang)
 			"    Dot   2p\0"
 			"    Dot   4p\0"
 			"    Dot   6p\0"
+			"    Density\0"
 
 			"\0";
 
@@ -168,6 +169,8 @@ void langFill(lang_t *la, int lang)
 			"    Add F low pass ...\0"
 			"    Add F median ...\0"
 			"    Add F demultiplex ...\0"
+			"    Add Q expression ...\0"
+			"    Power spectrum ...\0"
 
 			"\0";
 
@@ -235,6 +238,8 @@ void langFill(lang_t *la, int lang)
 		la->time_step_edit = "Time step";
 		la->time_threshold_edit = "Time threshold";
 		la->demultiplex_edit = "Demultiplex number";
+		la->expression_edit = "Expression";
+		la->spectrum_edit = "Segment length";
 	}
 	else if (lang == LANG_RU) {
 
@@ -366,6 +371,7 @@ void langFill(lang_t *la, int lang)
 			"    Точка  2п\0"
 			"    Точка  4п\0"
 			"    Точка  6п\0"
+			"    Плотность\0"
 
 			"\0";
 
@@ -384,6 +390,8 @@ void langFill(lang_t *la, int lang)
 			"    Добавить F фильтр НЧ ...\0"
 			"    Добавить F медиану ...\0"
 			"    Добавить F демультиплекс ...\0"
+			"    Добавить Q выражение ...\0"
+			"    Спектр мощности ...\0"
 
 			"\0";
 
@@ -451,6 +459,8 @@ void langFill(lang_t *la, int lang)
 		la->time_step_edit = "Шаг времени";
 		la->time_threshold_edit = "Порог времени";
 		la->demultiplex_edit = "Номер демультиплекса";
+		la->expression_edit = "Выражение";
+		la->spectrum_edit = "Длина сегмента";
 	}
 
 	la->figure_edit_color_menu =
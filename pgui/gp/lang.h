@@ -61,6 +61,8 @@ typedef struct {
 	const char	*time_step_edit;
 	const char	*time_threshold_edit;
 	const char	*demultiplex_edit;
+	const char	*expression_edit;
+	const char	*spectrum_edit;
 }
 lang_t;
 
@@ -0,0 +1,250 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "median.h"
+
+static int
+medianGreater(median_t *md, int a, int b)
+{
+	return (md->value[a] > md->value[b]
+		|| (md->value[a] == md->value[b] && a < b)) ? 1 : 0;
+}
+
+/* Upper heap keeps the smallest of upper values at the root, lower heap
+ * keeps the greatest of lower values at the root.
+ * */
+static int
+medianBefore(median_t *md, int up, int a, int b)
+{
+	return (up != 0) ? medianGreater(md, b, a) : medianGreater(md, a, b);
+}
+
+static void
+medianSet(median_t *md, int up, int pos, int slot)
+{
+	if (up != 0) {
+
+		md->upper[pos] = slot;
+		md->place[slot] = pos + 1;
+	}
+	else {
+		md->lower[pos] = slot;
+		md->place[slot] = - (pos + 1);
+	}
+}
+
+static void
+medianSiftUp(median_t *md, int up, int pos)
+{
+	int		*heap = (up != 0) ? md->upper : md->lower;
+	int		slot, parent;
+
+	slot = heap[pos];
+
+	while (pos > 0) {
+
+		parent = (pos - 1) / 2;
+
+		if (medianBefore(md, up, slot, heap[parent]) == 0)
+			break;
+
+		medianSet(md, up, pos, heap[parent]);
+		pos = parent;
+	}
+
+	medianSet(md, up, pos, slot);
+}
+
+static void
+medianSiftDown(median_t *md, int up, int pos)
+{
+	int		*heap = (up != 0) ? md->upper : md->lower;
+	int		length = (up != 0) ? md->upper_N : md->lower_N;
+	int		slot, child;
+
+	slot = heap[pos];
+
+	do {
+		child = 2 * pos + 1;
+
+		if (child >= length)
+			break;
+
+		if (		child + 1 < length
+				&& medianBefore(md, up, heap[child + 1], heap[child]) != 0) {
+
+			child++;
+		}
+
+		if (medianBefore(md, up, heap[child], slot) == 0)
+			break;
+
+		medianSet(md, up, pos, heap[child]);
+		pos = child;
+	}
+	while (1);
+
+	medianSet(md, up, pos, slot);
+}
+
+static void
+medianPush(median_t *md, int up, int slot)
+{
+	int		pos;
+
+	pos = (up != 0) ? md->upper_N++ : md->lower_N++;
+
+	medianSet(md, up, pos, slot);
+	medianSiftUp(md, up, pos);
+}
+
+static void
+medianErase(median_t *md, int up, int pos)
+{
+	int		*heap = (up != 0) ? md->upper : md->lower;
+	int		slot, last;
+
+	slot = heap[pos];
+	last = (up != 0) ? --md->upper_N : --md->lower_N;
+
+	md->place[slot] = 0;
+
+	if (pos != last) {
+
+		slot = heap[last];
+
+		medianSet(md, up, pos, slot);
+		medianSiftUp(md, up, pos);
+
+		if (heap[pos] == slot) {
+
+			/* Moved slot did not go up so it may go down.
+			 * */
+			medianSiftDown(md, up, pos);
+		}
+	}
+}
+
+median_t *medianAlloc(int length)
+{
+	median_t	*md;
+
+	/* We keep all arrays in one block so the caller frees it by free().
+	 * */
+	md = (median_t *) malloc(sizeof(median_t) + length * (3 * sizeof(int)
+				+ sizeof(double)) + sizeof(double));
+
+	if (md == NULL)
+		return NULL;
+
+	md->length = length;
+
+	md->value = (double *) (((size_t) (md + 1) + sizeof(double) - 1)
+			& ~(sizeof(double) - 1));
+
+	md->upper = (int *) (md->value + length);
+	md->lower = md->upper + length;
+	md->place = md->lower + length;
+
+	medianClean(md);
+
+	return md;
+}
+
+void medianClean(median_t *md)
+{
+	md->upper_N = 0;
+	md->lower_N = 0;
+
+	memset(md->place, 0, md->length * sizeof(int));
+}
+
+void medianInsert(median_t *md, int slot, double value)
+{
+	if (md->place[slot] != 0) {
+
+		medianRemove(md, slot);
+	}
+
+	md->value[slot] = value;
+
+	/* Any of the heaps may be empty here as we balance them in
+	 * medianGet() only.
+	 * */
+	if (md->lower_N > 0 && medianGreater(md, md->lower[0], slot) != 0) {
+
+		medianPush(md, 0, slot);
+	}
+	else {
+		medianPush(md, 1, slot);
+	}
+}
+
+void medianRemove(median_t *md, int slot)
+{
+	int		place = md->place[slot];
+
+	if (place > 0) {
+
+		medianErase(md, 1, place - 1);
+	}
+	else if (place < 0) {
+
+		medianErase(md, 0, - place - 1);
+	}
+}
+
+int medianGet(median_t *md)
+{
+	int		total, slot;
+
+	total = md->upper_N + md->lower_N;
+
+	if (total == 0)
+		return -1;
+
+	/* Upper heap keeps (total / 2 + 1) greatest values so its root is
+	 * the median in descending order.
+	 * */
+	while (md->upper_N > total / 2 + 1) {
+
+		slot = md->upper[0];
+
+		medianErase(md, 1, 0);
+		medianPush(md, 0, slot);
+	}
+
+	while (md->upper_N < total / 2 + 1) {
+
+		slot = md->lower[0];
+
+		medianErase(md, 0, 0);
+		medianPush(md, 1, slot);
+	}
+
+	return md->upper[0];
+}
+
+int medianTotal(median_t *md)
+{
+	return md->upper_N + md->lower_N;
+}
+
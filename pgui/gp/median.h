@@ -0,0 +1,52 @@
+/*
+   Graph Plotter is a tool to analyse numerical data.
+   Copyright (C) 2025 Roman Belov <romblv@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _H_MEDIAN_
+#define _H_MEDIAN_
+
+/* Sliding median over the window of slots. Values are kept in two indexed
+ * heaps so that both insert and remove of any slot take O(log k). Order of
+ * values is descending, equal values are ordered by slot number.
+ * */
+
+typedef struct {
+
+	int		length;
+
+	int		upper_N;
+	int		lower_N;
+
+	int		*upper;
+	int		*lower;
+	int		*place;
+
+	double		*value;
+}
+median_t;
+
+median_t *medianAlloc(int length);
+void medianClean(median_t *md);
+
+void medianInsert(median_t *md, int slot, double value);
+void medianRemove(median_t *md, int slot);
+
+int medianGet(median_t *md);
+int medianTotal(median_t *md);
+
+#endif /* _H_MEDIAN_ */
+
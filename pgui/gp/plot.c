@@ -29,9 +29,84 @@
 #include "read.h"
 #include "draw.h"
 #include "lse.h"
+#include "fft.h"
+#include "codec.h"
 #include "lz4.h"
 #include "scheme.h"
 
+typedef struct {
+
+	plot_t		*pl;
+
+	int		dN;
+	int		xN;
+}
+cache_job_t;
+
+typedef struct {
+
+	lse_t		lsq;
+
+	int		N0;
+	int		N1;
+
+	int		length;
+	double		xy[PLOT_POLYFIT_BLOCK * 2];
+
+	SDL_atomic_t	done;
+}
+polyfit_job_t;
+
+typedef struct {
+
+	const fft_t	*ft;
+
+	int		hop;
+	int		length;
+	int		segment_N;
+
+	double		*x;
+	double		*power;
+	double		*work;
+
+	SDL_atomic_t	done;
+}
+spectrum_job_t;
+
+typedef struct {
+
+	const fval_t	*raw;
+
+	int		stride;
+	int		column_X;
+	int		column_Y;
+	int		length;
+
+	double		id;
+
+	density_t	tf;
+
+	int		*pixel;
+	int		pixel_N;
+
+	fval_t		*xy;
+
+	SDL_atomic_t	done;
+}
+density_job_t;
+
+typedef struct {
+
+	plot_t		*pl;
+	SDL_Surface	*surface;
+
+	draw_t		dw;
+	int		flush;
+
+	SDL_atomic_t	done;
+}
+tile_job_t;
+
 extern SDL_RWops *TTF_RW_roboto_mono_normal();
 extern SDL_RWops *TTF_RW_roboto_mono_thin();
 
@@ -104,11 +179,30 @@ plot_t *plotAlloc(draw_t *dw, scheme_t *sch)
 	pl->transparency = 1;
 	pl->fprecision = 9;
 	pl->fhexadecimal = 1;
-	pl->lz4_compress = 1;
+	pl->lz4_compress = LZ4_COMPRESS_COLUMNS;
+	pl->cache_budget = 256;
 
 	return pl;
 }
 
+static void
+plotDensityFree(plot_t *pl, int fN)
+{
+	int		N;
+
+	for (N = 0; N < 2; ++N) {
+
+		if (pl->draw[fN].density[N].count != NULL) {
+
+			free(pl->draw[fN].density[N].count);
+
+			pl->draw[fN].density[N].count = NULL;
+		}
+	}
+
+	pl->draw[fN].density_ready = 0;
+}
+
 static void
 plotSketchFree(plot_t *pl)
 {
@@ -125,6 +219,11 @@ plotSketchFree(plot_t *pl)
 			pl->sketch[N].chunk = NULL;
 		}
 	}
+
+	for (N = 0; N < PLOT_FIGURE_MAX; ++N) {
+
+		plotDensityFree(pl, N);
+	}
 }
 
 void plotClean(plot_t *pl)
@@ -138,6 +237,13 @@ void plotClean(plot_t *pl)
 
 		if (pl->data[dN].column_N != 0)
 			plotDataClean(pl, dN);
+
+		plotDataRangeCacheClean(pl, dN);
+	}
+
+	if (pl->pool != NULL) {
+
+		async_pool_close(pl->pool);
 	}
 
 	free(pl);
@@ -307,7 +413,7 @@ unsigned long long plotDataMemoryUsage(plot_t *pl, int dN)
 
 unsigned long long plotDataMemoryUncompressed(plot_t *pl, int dN)
 {
-	int			N;
+	int			N, kN;
 	unsigned long long	bUSAGE;
 
 	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
@@ -318,10 +424,14 @@ unsigned long long plotDataMemoryUncompressed(plot_t *pl, int dN)
 
 	bUSAGE = 0;
 
+	kN = (pl->data[dN].mapped.raw != NULL)
+		? (pl->data[dN].mapped.length - 1) >> pl->data[dN].chunk_SHIFT : -1;
+
 	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
 
 		if (		pl->data[dN].raw[N] != NULL
-				|| pl->data[dN].compress[N].raw != NULL) {
+				|| pl->data[dN].compress[N].raw != NULL
+				|| N <= kN) {
 
 			bUSAGE += pl->data[dN].chunk_bSIZE;
 		}
@@ -343,7 +453,7 @@ unsigned long long plotDataMemoryCached(plot_t *pl, int dN)
 
 	bUSAGE = 0;
 
-	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+	for (N = 0; N < PLOT_CHUNK_CACHE_MAX; ++N) {
 
 		if (pl->data[dN].cache[N].raw != NULL) {
 
@@ -354,749 +464,1726 @@ unsigned long long plotDataMemoryCached(plot_t *pl, int dN)
 	return bUSAGE;
 }
 
-static int
-plotDataCacheGetNode(plot_t *pl, int dN)
+static void
+plotDataMappedFetch(plot_t *pl, int dN, int kN, fval_t *place)
 {
-	int		N, kNOT, xN = -1;
+	const char	*map;
 
-	for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+	int		cN, rN, jN, N, bSIZE;
 
-		if (pl->data[dN].cache[N].raw == NULL) {
+	cN = pl->data[dN].column_N;
+	rN = kN << pl->data[dN].chunk_SHIFT;
 
-			xN = N;
-			break;
-		}
-	}
+	jN = pl->data[dN].mapped.length - rN;
+	jN = (jN > pl->data[dN].chunk_MASK) ? pl->data[dN].chunk_MASK + 1 : jN;
 
-	if (xN < 0) {
+	bSIZE = cN * pl->data[dN].mapped.fp_bSIZE;
 
-		kNOT = pl->data[dN].tail_N >> pl->data[dN].chunk_SHIFT;
+	map = (const char *) pl->data[dN].mapped.raw + (size_t) rN * bSIZE;
 
-		N = (pl->data[dN].cache_ID < PLOT_CHUNK_CACHE - 1)
-			? pl->data[dN].cache_ID + 1 : 0;
+	/* Convert rows from the file mapping into the chunk layout, page
+	 * faults bring in only the part of file we actually look at.
+	 * */
+	while (jN > 0) {
 
-		if (pl->data[dN].cache[N].chunk_N == kNOT) {
+		if (pl->data[dN].mapped.fp_bSIZE == sizeof(float)) {
 
-			N = (N < PLOT_CHUNK_CACHE - 1) ? N + 1 : 0;
+			for (N = 0; N < cN; ++N)
+				place[N] = (fval_t) ((const float *) map)[N];
+		}
+		else {
+			for (N = 0; N < cN; ++N)
+				place[N] = (fval_t) ((const double *) map)[N];
 		}
 
-		xN = N;
+		memset(place + cN, 0, PLOT_SUBTRACT * sizeof(fval_t));
+
+		place += cN + PLOT_SUBTRACT;
+		map += bSIZE;
 
-		pl->data[dN].cache_ID = N;
+		jN--;
 	}
+}
 
-	return xN;
+static int
+plotDataCodecSize(plot_t *pl, int dN)
+{
+	int		cN;
+
+	cN = pl->data[dN].column_N + PLOT_SUBTRACT;
+
+	return ((cN + 7) & ~7) + ((cN * 4 + 7) & ~7) + pl->data[dN].chunk_bSIZE;
 }
 
-static void
-plotDataCacheFetch(plot_t *pl, int dN, int kN)
+/* The codec is applied only to the compressed copy of chunk. Chunks in
+ * cache are always row-major fval_t as all consumers index them by row.
+ * */
+static int
+plotDataCodecEncode(plot_t *pl, int dN, const fval_t *raw, char *pack)
 {
-	int		xN, kNZ, lzLEN;
+	int		*length;
+	char		*place;
 
-	xN = plotDataCacheGetNode(pl, dN);
+	int		cN, lN, N, codec, bSIZE;
 
-	if (pl->data[dN].cache[xN].raw != NULL) {
+	cN = pl->data[dN].column_N + PLOT_SUBTRACT;
+	lN = pl->data[dN].chunk_MASK + 1;
 
-		kNZ = pl->data[dN].cache[xN].chunk_N;
+	length = (int *) (pack + ((cN + 7) & ~7));
+	place = (char *) length + ((cN * 4 + 7) & ~7);
 
-		if (pl->data[dN].cache[xN].dirty != 0) {
+	/* Each column goes contiguous by the codec that gives the shortest
+	 * result. Float columns as float32, integer and time columns as
+	 * delta-of-delta, smooth signals as XOR of neighbouring values.
+	 * */
+	for (N = 0; N < cN; ++N) {
 
-			lzLEN = LZ4_compressBound(pl->data[dN].chunk_bSIZE);
+		bSIZE = codecEncodeBest(&codec, raw + N, cN, lN, place,
+				lN * (int) sizeof(double));
 
-			if (pl->data[dN].compress[kNZ].raw != NULL) {
+		if (bSIZE < 0) {
 
-				free(pl->data[dN].compress[kNZ].raw);
+			codec = CODEC_FP_64;
+			bSIZE = codecEncode(codec, raw + N, cN, lN, place,
+					lN * (int) sizeof(double));
+		}
 
-				pl->data[dN].compress[kNZ].raw = NULL;
-			}
+		pack[N] = (char) codec;
+		length[N] = bSIZE;
 
-			pl->data[dN].compress[kNZ].length = 0;
+		place += bSIZE;
+	}
 
-			if (pl->data[dN].lz4_reserved == NULL) {
+	return (int) (place - pack);
+}
 
-				pl->data[dN].lz4_reserved = (void *) malloc(lzLEN);
-			}
+static int
+plotDataCodecDecode(plot_t *pl, int dN, fval_t *raw, const char *pack, int bSIZE)
+{
+	const int	*length;
+	const char	*place;
 
-			if (pl->data[dN].lz4_reserved != NULL) {
+	int		cN, lN, N;
 
-				lzLEN = LZ4_compress_fast((const char *) pl->data[dN].cache[xN].raw,
-						(char *) pl->data[dN].lz4_reserved,
-						pl->data[dN].chunk_bSIZE, lzLEN, 1);
+	cN = pl->data[dN].column_N + PLOT_SUBTRACT;
+	lN = pl->data[dN].chunk_MASK + 1;
 
-				pl->data[dN].compress[kNZ].raw = (void *) malloc(lzLEN);
+	length = (const int *) (pack + ((cN + 7) & ~7));
+	place = (const char *) length + ((cN * 4 + 7) & ~7);
 
-				if (pl->data[dN].compress[kNZ].raw != NULL) {
+	for (N = 0; N < cN; ++N) {
 
-					memcpy(pl->data[dN].compress[kNZ].raw,
-							pl->data[dN].lz4_reserved, lzLEN);
+		if (		length[N] < 0
+				|| place + length[N] > pack + bSIZE)
+			return 0;
 
-					pl->data[dN].compress[kNZ].length = lzLEN;
-				}
-				else {
-					ERROR("Unable to allocate LZ4 memory of %i dataset\n", dN);
-				}
-			}
-			else {
-				ERROR("Unable to allocate reserved memory of %i dataset\n", dN);
-			}
-		}
+		if (codecDecode(pack[N], raw + N, cN, lN, place, length[N]) < 0)
+			return 0;
 
-		pl->data[dN].raw[kNZ] = NULL;
+		place += length[N];
 	}
-	else {
-		pl->data[dN].cache[xN].raw = (fval_t *) malloc(pl->data[dN].chunk_bSIZE);
 
-		if (pl->data[dN].cache[xN].raw == NULL) {
+	return 1;
+}
+
+static void
+plotDataCacheCompress(cache_job_t *job)
+{
+	plot_t		*pl = job->pl;
+	int		dN = job->dN;
+	int		xN = job->xN;
 
-			ERROR("Unable to allocate cache of %i dataset\n", dN);
-		}
-	}
+	const char	*src;
+	char		*pack = NULL, *lz4;
+	int		lzLEN, bSIZE, format;
 
-	pl->data[dN].cache[xN].chunk_N = kN;
-	pl->data[dN].cache[xN].dirty = 0;
+	src = (const char *) pl->data[dN].cache[xN].raw;
+	bSIZE = pl->data[dN].chunk_bSIZE;
 
-	pl->data[dN].raw[kN] = pl->data[dN].cache[xN].raw;
+	format = CHUNK_LZ4_ROWS;
 
-	if (pl->data[dN].compress[kN].raw != NULL) {
+	if (pl->data[dN].lz4_compress == LZ4_COMPRESS_COLUMNS) {
 
-		lzLEN = LZ4_decompress_safe((const char *) pl->data[dN].compress[kN].raw,
-				(char *) pl->data[dN].raw[kN], pl->data[dN].compress[kN].length,
-				pl->data[dN].chunk_bSIZE);
+		pack = (char *) malloc(plotDataCodecSize(pl, dN));
 
-		if (lzLEN != pl->data[dN].chunk_bSIZE) {
+		if (pack != NULL) {
 
-			ERROR("Unable to decompress LZ4 memory of %i dataset\n", dN);
+			bSIZE = plotDataCodecEncode(pl, dN, pl->data[dN].cache[xN].raw, pack);
+
+			src = (const char *) pack;
+			format = CHUNK_LZ4_CODEC;
 		}
 	}
-}
 
-static void
-plotDataChunkFetch(plot_t *pl, int dN, int kN)
-{
-	if (		   pl->data[dN].raw[kN] == NULL
-			&& pl->data[dN].length_N != 0) {
+	lzLEN = LZ4_compressBound(bSIZE);
+	lz4 = (char *) malloc(lzLEN);
 
-		plotDataCacheFetch(pl, dN, kN);
-	}
-}
+	pl->data[dN].cache[xN].zraw = NULL;
+	pl->data[dN].cache[xN].zlength = 0;
 
-static void
-plotDataChunkWrite(plot_t *pl, int dN, int kN)
-{
-	int		N;
+	if (lz4 != NULL) {
 
-	if (		   pl->data[dN].raw[kN] == NULL
-			&& pl->data[dN].length_N != 0) {
+		lzLEN = LZ4_compress_fast(src, lz4, bSIZE, lzLEN, 1);
 
-		plotDataCacheFetch(pl, dN, kN);
-	}
+		if (		format == CHUNK_LZ4_CODEC
+				&& (lzLEN <= 0 || lzLEN >= bSIZE)) {
 
-	if (pl->data[dN].raw[kN] != NULL) {
+			/* LZ4 does not help over the column codecs so we
+			 * keep the pack as is.
+			 * */
+			format = CHUNK_PLAIN_CODEC;
 
-		for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
+			free(lz4);
 
-			if (pl->data[dN].cache[N].chunk_N == kN) {
+			lz4 = pack;
+			pack = NULL;
 
-				pl->data[dN].cache[N].dirty = 1;
-				break;
-			}
+			lzLEN = bSIZE;
+		}
+
+		if (lzLEN > 0) {
+
+			pl->data[dN].cache[xN].zraw = (void *) realloc(lz4, lzLEN);
+			pl->data[dN].cache[xN].zlength = lzLEN;
+			pl->data[dN].cache[xN].zformat = format;
+		}
+		else {
+			free(lz4);
 		}
 	}
+
+	free(pack);
+	free(job);
+
+	SDL_AtomicSet(&pl->data[dN].cache[xN].done, 1);
 }
 
-void plotDataAlloc(plot_t *pl, int dN, int cN, int lN)
+static void
+plotDataCacheDecompress(cache_job_t *job)
 {
-	int		*map;
+	plot_t		*pl = job->pl;
+	int		dN = job->dN;
+	int		xN = job->xN;
 
-	int		N, bSIZE;
+	const char	*src;
+	char		*pack;
+	fval_t		*raw;
+	int		kN, lzLEN, rc = 1;
 
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+	kN = pl->data[dN].cache[xN].chunk_N;
+	raw = pl->data[dN].cache[xN].raw;
 
-		ERROR("Dataset number is out of range\n");
-		return ;
-	}
+	src = (const char *) pl->data[dN].compress[kN].raw;
 
-	if (cN < 1) {
+	if (src == NULL) {
 
-		ERROR("Number of columns is too few\n");
-		return ;
+		if (pl->data[dN].mapped.raw != NULL) {
+
+			plotDataMappedFetch(pl, dN, kN, raw);
+		}
 	}
+	else if (pl->data[dN].compress[kN].format == CHUNK_LZ4_ROWS) {
 
-	if (lN < 1) {
+		lzLEN = LZ4_decompress_safe(src, (char *) raw,
+				pl->data[dN].compress[kN].length,
+				pl->data[dN].chunk_bSIZE);
 
-		ERROR("Length of dataset is too short\n");
-		return ;
+		rc = (lzLEN == pl->data[dN].chunk_bSIZE) ? 1 : 0;
 	}
+	else if (pl->data[dN].compress[kN].format == CHUNK_PLAIN_CODEC) {
 
-	if (pl->data[dN].column_N != 0) {
+		rc = plotDataCodecDecode(pl, dN, raw, src,
+				pl->data[dN].compress[kN].length);
+	}
+	else {
+		pack = (char *) malloc(plotDataCodecSize(pl, dN));
 
-		if (pl->data[dN].column_N != cN) {
+		if (pack != NULL) {
 
-			ERROR("Number of columns cannot be changed\n");
-			return ;
-		}
+			lzLEN = LZ4_decompress_safe(src, pack,
+					pl->data[dN].compress[kN].length,
+					plotDataCodecSize(pl, dN));
 
-		if (plotFigureHaveData(pl, dN) != 0) {
+			rc = (lzLEN > 0) ? plotDataCodecDecode(pl, dN, raw, pack, lzLEN) : 0;
 
-			plotSketchClean(pl);
+			free(pack);
+		}
+		else {
+			rc = 0;
 		}
+	}
 
-		plotDataRangeCacheClean(pl, dN);
-		plotDataChunkAlloc(pl, dN, lN);
+	if (rc == 0) {
 
-		pl->data[dN].head_N = 0;
-		pl->data[dN].tail_N = 0;
-		pl->data[dN].id_N = 0;
-		pl->data[dN].sub_N = 0;
+		ERROR("Unable to decompress LZ4 memory of %i dataset\n", dN);
 	}
-	else {
-		pl->data[dN].column_N = cN;
 
-		for (N = 0; N < 30; ++N) {
+	free(job);
 
-			bSIZE = (int) sizeof(fval_t) * (cN + PLOT_SUBTRACT) * (1UL << N);
+	SDL_AtomicSet(&pl->data[dN].cache[xN].done, 1);
+}
 
-			if (bSIZE >= PLOT_CHUNK_SIZE) {
+static void
+plotDataCacheReap(plot_t *pl, int dN, int xN)
+{
+	int		kN;
 
-				pl->data[dN].chunk_SHIFT = N;
-				pl->data[dN].chunk_MASK = (1UL << N) - 1UL;
-				pl->data[dN].chunk_bSIZE = bSIZE;
-				break;
-			}
-		}
+	if (		pl->data[dN].cache[xN].job != CACHE_JOB_NONE
+			&& SDL_AtomicGet(&pl->data[dN].cache[xN].done) != 0) {
 
-		pl->data[dN].lz4_compress = pl->lz4_compress;
+		if (pl->data[dN].cache[xN].job == CACHE_JOB_COMPRESS) {
 
-		plotDataChunkAlloc(pl, dN, lN);
+			kN = pl->data[dN].cache[xN].chunk_N;
 
-		pl->data[dN].cache_ID = 0;
+			if (pl->data[dN].cache[xN].zraw != NULL) {
 
-		pl->data[dN].head_N = 0;
-		pl->data[dN].tail_N = 0;
-		pl->data[dN].id_N = 0;
-		pl->data[dN].sub_N = 0;
+				if (pl->data[dN].compress[kN].raw != NULL) {
 
-		for (N = 0; N < PLOT_SUBTRACT; ++N) {
+					free(pl->data[dN].compress[kN].raw);
+				}
 
-			pl->data[dN].sub[N].busy = SUBTRACT_FREE;
+				pl->data[dN].compress[kN].raw = pl->data[dN].cache[xN].zraw;
+				pl->data[dN].compress[kN].length = pl->data[dN].cache[xN].zlength;
+				pl->data[dN].compress[kN].format = pl->data[dN].cache[xN].zformat;
+
+				pl->data[dN].cache[xN].zraw = NULL;
+				pl->data[dN].cache[xN].dirty = 0;
+			}
+			else {
+				ERROR("Unable to allocate LZ4 memory of %i dataset\n", dN);
+			}
 		}
 
-		map = (int *) malloc(sizeof(int) * (cN + PLOT_SUBTRACT + 1));
+		pl->data[dN].cache[xN].job = CACHE_JOB_NONE;
+	}
+}
 
-		if (map == NULL) {
+static void
+plotDataCacheWait(plot_t *pl, int dN, int xN)
+{
+	while (pl->data[dN].cache[xN].job != CACHE_JOB_NONE) {
 
-			ERROR("No memory allocated for %i map\n", dN);
-			return ;
+		if (SDL_AtomicGet(&pl->data[dN].cache[xN].done) == 0) {
+
+			SDL_Delay(1);
 		}
 
-		pl->data[dN].map = (int *) map + 1;
+		plotDataCacheReap(pl, dN, xN);
+	}
+}
 
-		for (N = -1; N < cN + PLOT_SUBTRACT; ++N) {
+static void
+plotDataCacheSync(plot_t *pl, int dN)
+{
+	int		xN;
 
-			pl->data[dN].map[N] = -1;
-		}
+	for (xN = 0; xN < PLOT_CHUNK_CACHE_MAX; ++xN) {
+
+		plotDataCacheWait(pl, dN, xN);
 	}
 }
 
-void plotDataResize(plot_t *pl, int dN, int lN)
+void plotPoolOpen(plot_t *pl)
 {
-	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+	int		thread_N;
 
-		ERROR("Dataset number is out of range\n");
-		return ;
+	if (pl->pool == NULL) {
+
+		/* Leave one core for the UI thread but keep enough workers
+		 * for the chunk cache. The same pool parses the text files.
+		 * */
+		thread_N = SDL_GetCPUCount() - 1;
+		thread_N = (thread_N < PLOT_CHUNK_THREADS) ? PLOT_CHUNK_THREADS : thread_N;
+		thread_N = (pl->threads > 0) ? pl->threads : thread_N;
+
+		pl->pool = async_pool_open(thread_N);
 	}
+}
 
-	if (lN < 1) {
+static void
+plotDataCacheRun(plot_t *pl, int dN, int xN, int job, int async)
+{
+	cache_job_t	*arg;
+	void		(* proc) (void *);
 
-		ERROR("Length of dataset is too short\n");
+	arg = (cache_job_t *) malloc(sizeof(cache_job_t));
+
+	if (arg == NULL) {
+
+		ERROR("No memory allocated for cache job\n");
 		return ;
 	}
 
-	if (pl->data[dN].column_N != 0) {
+	arg->pl = pl;
+	arg->dN = dN;
+	arg->xN = xN;
 
-		if (lN < pl->data[dN].length_N) {
+	proc = (job == CACHE_JOB_COMPRESS)
+		? (void (*) (void *)) &plotDataCacheCompress
+		: (void (*) (void *)) &plotDataCacheDecompress;
 
-			pl->data[dN].head_N = 0;
-			pl->data[dN].tail_N = 0;
-			pl->data[dN].id_N = 0;
-			pl->data[dN].sub_N = 0;
-		}
+	pl->data[dN].cache[xN].job = job;
 
-		plotDataChunkAlloc(pl, dN, lN);
+	SDL_AtomicSet(&pl->data[dN].cache[xN].done, 0);
+
+	if (async != 0) {
+
+		plotPoolOpen(pl);
 	}
-}
 
-int plotDataLength(plot_t *pl, int dN)
-{
-	int		N;
+	if (		async == 0 || pl->pool == NULL
+			|| async_pool_submit(pl->pool, proc, arg) != ASYNC_OK) {
 
-	N = pl->data[dN].tail_N - pl->data[dN].head_N;
-	N += (N < 0) ? pl->data[dN].length_N : 0;
+		proc(arg);
 
-	return N;
+		plotDataCacheReap(pl, dN, xN);
+	}
 }
 
-int plotDataSpaceLeft(plot_t *pl, int dN)
+static void
+plotDataCacheDrop(plot_t *pl, int dN, int xN)
 {
-	return pl->data[dN].length_N - plotDataLength(pl, dN);
-}
+	int		kN;
 
-void plotDataGrowUp(plot_t *pl, int dN)
-{
-	int			lSHIFT, lN;
+	kN = pl->data[dN].cache[xN].chunk_N;
 
-	lSHIFT = pl->data[dN].chunk_SHIFT;
+	if (kN >= 0) {
 
-	lN = pl->data[dN].length_N;
-	lN = ((lN >> lSHIFT) + 1) << lSHIFT;
+		if (pl->data[dN].raw[kN] == pl->data[dN].cache[xN].raw) {
 
-	plotDataResize(pl, dN, lN);
+			pl->data[dN].raw[kN] = NULL;
+		}
+
+		pl->data[dN].cache_map[kN] = 0;
+	}
+
+	pl->data[dN].cache[xN].chunk_N = -1;
+	pl->data[dN].cache[xN].dirty = 0;
 }
 
-static const fval_t *
-plotDataGet(plot_t *pl, int dN, int *rN)
+static int
+plotDataCacheGetNode(plot_t *pl, int dN, int kNKEEP)
 {
-	const fval_t	*row = NULL;
+	int		N, kNOT, xN;
 
-	int		lN, kN, jN;
+	for (N = 0; N < pl->data[dN].cache_N; ++N) {
 
-	if (*rN != pl->data[dN].tail_N) {
+		plotDataCacheReap(pl, dN, N);
 
-		kN = *rN >> pl->data[dN].chunk_SHIFT;
-		jN = *rN & pl->data[dN].chunk_MASK;
+		if (pl->data[dN].cache[N].raw == NULL) {
 
-		if (pl->data[dN].lz4_compress != 0) {
+			pl->data[dN].cache[N].raw = (fval_t *) malloc(pl->data[dN].chunk_bSIZE);
 
-			plotDataChunkFetch(pl, dN, kN);
+			if (pl->data[dN].cache[N].raw == NULL) {
+
+				ERROR("Unable to allocate cache of %i dataset\n", dN);
+				break;
+			}
+
+			pl->data[dN].cache[N].chunk_N = -1;
+			pl->data[dN].cache[N].dirty = 0;
+
+			return N;
 		}
+	}
 
-		row = pl->data[dN].raw[kN];
+	kNOT = pl->data[dN].tail_N >> pl->data[dN].chunk_SHIFT;
 
-		if (row != NULL) {
+	for (N = 0; N < pl->data[dN].cache_N * 2; ++N) {
 
-			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+		xN = (pl->data[dN].cache_ID < pl->data[dN].cache_N - 1)
+			? pl->data[dN].cache_ID + 1 : 0;
 
-			lN = pl->data[dN].length_N;
-			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
+		pl->data[dN].cache_ID = xN;
+
+		if (		pl->data[dN].cache[xN].raw == NULL
+				|| pl->data[dN].cache[xN].job != CACHE_JOB_NONE
+				|| pl->data[dN].cache[xN].chunk_N == kNOT
+				|| pl->data[dN].cache[xN].chunk_N == kNKEEP)
+			continue;
+
+		if (pl->data[dN].cache[xN].dirty != 0) {
+
+			/* Write back the dirty chunk in background and look
+			 * for another node.
+			 * */
+			plotDataCacheRun(pl, dN, xN, CACHE_JOB_COMPRESS, 1);
+
+			if (		pl->data[dN].cache[xN].job != CACHE_JOB_NONE
+					|| pl->data[dN].cache[xN].dirty != 0)
+				continue;
 		}
+
+		plotDataCacheDrop(pl, dN, xN);
+
+		return xN;
 	}
 
-	return row;
+	return -1;
 }
 
 static void
-plotDataRangeCacheWipe(plot_t *pl, int dN, int kN)
+plotDataCachePrefetch(plot_t *pl, int dN, int kN, int kNKEEP)
 {
-	int		N;
+	int		xN, kN_N;
 
-	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
+	kN_N = ((pl->data[dN].length_N - 1) >> pl->data[dN].chunk_SHIFT) + 1;
 
-		if (		pl->rcache[N].busy != 0
-				&& pl->rcache[N].data_N == dN) {
+	if (		kN < 0 || kN >= kN_N
+			|| pl->data[dN].cache_N <= PLOT_CHUNK_CACHE
+			|| pl->data[dN].cache_map[kN] != 0)
+		return ;
 
-			pl->rcache[N].chunk[kN].computed = 0;
-			pl->rcache[N].cached = 0;
-		}
+	if (		pl->data[dN].compress[kN].raw == NULL
+			&& (pl->data[dN].mapped.raw == NULL
+				|| (kN << pl->data[dN].chunk_SHIFT) >= pl->data[dN].mapped.length))
+		return ;
+
+	xN = plotDataCacheGetNode(pl, dN, kNKEEP);
+
+	if (xN >= 0) {
+
+		pl->data[dN].cache[xN].chunk_N = kN;
+		pl->data[dN].cache_map[kN] = xN + 1;
+
+		plotDataCacheRun(pl, dN, xN, CACHE_JOB_DECOMPRESS, 1);
 	}
 }
 
-static fval_t *
-plotDataWrite(plot_t *pl, int dN, int *rN)
+static void
+plotDataCacheFetch(plot_t *pl, int dN, int kN)
 {
-	fval_t		*row = NULL;
-	int		lN, kN, jN;
+	int		xN, kNDIR, N;
 
-	if (*rN != pl->data[dN].tail_N) {
+	xN = pl->data[dN].cache_map[kN] - 1;
 
-		kN = *rN >> pl->data[dN].chunk_SHIFT;
-		jN = *rN & pl->data[dN].chunk_MASK;
+	if (xN >= 0) {
 
-		if (pl->data[dN].lz4_compress != 0) {
+		/* Chunk was prefetched or it is under compression that
+		 * does not prevent us from reading.
+		 * */
+		if (pl->data[dN].cache[xN].job == CACHE_JOB_DECOMPRESS) {
 
-			plotDataChunkWrite(pl, dN, kN);
+			plotDataCacheWait(pl, dN, xN);
 		}
+	}
+	else {
+		xN = plotDataCacheGetNode(pl, dN, kN);
 
-		if (		   pl->rcache_wipe_data_N != dN
-				|| pl->rcache_wipe_chunk_N != kN) {
+		if (xN < 0) {
 
-			plotDataRangeCacheWipe(pl, dN, kN);
+			plotDataCacheSync(pl, dN);
 
-			pl->rcache_wipe_data_N = dN;
-			pl->rcache_wipe_chunk_N = kN;
+			xN = plotDataCacheGetNode(pl, dN, kN);
 		}
 
-		row = pl->data[dN].raw[kN];
+		if (xN < 0) {
 
-		if (row != NULL) {
+			ERROR("Unable to get cache node of %i dataset\n", dN);
+			return ;
+		}
 
-			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+		pl->data[dN].cache[xN].chunk_N = kN;
+		pl->data[dN].cache_map[kN] = xN + 1;
 
-			lN = pl->data[dN].length_N;
-			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
-		}
+		plotDataCacheRun(pl, dN, xN, CACHE_JOB_DECOMPRESS, 0);
 	}
 
-	return row;
-}
+	pl->data[dN].raw[kN] = pl->data[dN].cache[xN].raw;
 
-static void
-plotDataSkip(plot_t *pl, int dN, int *rN, int *id_N, int iN)
-{
-	int		N, lN, tN;
+	/* Predict the pan direction by the previous fetch.
+	 * */
+	kNDIR = (kN < pl->data[dN].cache_kN) ? - 1 : 1;
 
-	lN = pl->data[dN].length_N;
+	pl->data[dN].cache_kN = kN;
 
-	N = *rN - pl->data[dN].head_N;
-	N = (N < 0) ? N + lN : N;
+	for (N = 1; N <= PLOT_CHUNK_THREADS; ++N) {
 
-	tN = pl->data[dN].tail_N - pl->data[dN].head_N;
-	tN = (tN < 0) ? tN + lN : tN;
+		plotDataCachePrefetch(pl, dN, kN + kNDIR * N, kN);
+	}
+}
 
-	iN = (N + iN < 0) ? - N : iN;
-	iN = (N + iN > tN) ? tN - N : iN;
+static void
+plotDataCacheClean(plot_t *pl, int dN)
+{
+	int		xN;
 
-	N += iN;
+	plotDataCacheSync(pl, dN);
 
-	N = pl->data[dN].head_N + N;
-	N = (N > lN - 1) ? N - lN : N;
+	for (xN = 0; xN < PLOT_CHUNK_CACHE_MAX; ++xN) {
 
-	if (rN != NULL) {
+		plotDataCacheDrop(pl, dN, xN);
 
-		*rN = N;
-	}
+		if (pl->data[dN].cache[xN].raw != NULL) {
 
-	if (id_N != NULL) {
+			free(pl->data[dN].cache[xN].raw);
 
-		*id_N += iN;
+			pl->data[dN].cache[xN].raw = NULL;
+		}
 	}
 }
 
-static int
-plotDataChunkN(plot_t *pl, int dN, int rN)
+static void
+plotDataChunkFetch(plot_t *pl, int dN, int kN)
 {
-	int		kN;
-
-	kN = rN >> pl->data[dN].chunk_SHIFT;
+	if (		   pl->data[dN].raw[kN] == NULL
+			&& pl->data[dN].length_N != 0) {
 
-	return kN;
+		plotDataCacheFetch(pl, dN, kN);
+	}
 }
 
 static void
-plotDataChunkSkip(plot_t *pl, int dN, int *rN, int *id_N)
+plotDataChunkWrite(plot_t *pl, int dN, int kN)
 {
-	int		skip_N, wrap_N;
+	int		xN;
 
-	skip_N = (1UL << pl->data[dN].chunk_SHIFT)
-		- (*rN & pl->data[dN].chunk_MASK);
+	if (		   pl->data[dN].raw[kN] == NULL
+			&& pl->data[dN].length_N != 0) {
 
-	wrap_N = pl->data[dN].length_N - *rN;
-	skip_N = (wrap_N < skip_N) ? wrap_N : skip_N;
+		plotDataCacheFetch(pl, dN, kN);
+	}
 
-	plotDataSkip(pl, dN, rN, id_N, skip_N);
+	xN = pl->data[dN].cache_map[kN] - 1;
+
+	if (xN >= 0) {
+
+		if (pl->data[dN].cache[xN].job != CACHE_JOB_NONE) {
+
+			plotDataCacheWait(pl, dN, xN);
+		}
+
+		pl->data[dN].cache[xN].dirty = 1;
+	}
 }
 
-static tuple_t
-plotDataMedianAdd(plot_t *pl, int dN, int sN, double fval, double fpay)
+void plotDataAlloc(plot_t *pl, int dN, int cN, int lN)
 {
-	int		index[PLOT_MEDIAN_MAX];
-	int		N, Nq, N0, N1, length, keep, tail, total;
+	int		*map;
 
-	tuple_t		mN = { -1, -1 };
+	int		N, bSIZE;
 
-	length = pl->data[dN].sub[sN].op.median.length;
-	keep = pl->data[dN].sub[sN].op.median.keep;
-	tail = pl->data[dN].sub[sN].op.median.tail;
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
 
-	pl->data[dN].sub[sN].op.median.window[tail].fval = fval;
-	pl->data[dN].sub[sN].op.median.window[tail].fpay = fpay;
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
 
-	keep = (keep < length - 1) ? keep + 1 : length;
-	tail = (tail < length - 1) ? tail + 1 : 0;
+	if (cN < 1) {
 
-	pl->data[dN].sub[sN].op.median.keep = keep;
-	pl->data[dN].sub[sN].op.median.tail = tail;
+		ERROR("Number of columns is too few\n");
+		return ;
+	}
+
+	if (lN < 1) {
+
+		ERROR("Length of dataset is too short\n");
+		return ;
+	}
+
+	if (pl->data[dN].column_N != 0) {
+
+		if (pl->data[dN].column_N != cN) {
 
-	for (N = 0, total = 0; N < keep; ++N) {
+			ERROR("Number of columns cannot be changed\n");
+			return ;
+		}
 
-		fval = pl->data[dN].sub[sN].op.median.window[N].fval;
+		if (plotFigureHaveData(pl, dN) != 0) {
 
-		if (fp_isfinite(fval)) {
+			plotSketchClean(pl);
+		}
 
-			index[total++] = N;
+		plotDataRangeCacheClean(pl, dN);
 
-			for (Nq = total - 1; Nq > 0; --Nq) {
+		if (		pl->data[dN].mapped.raw != NULL
+				&& pl->data[dN].lz4_compress == 0) {
 
-				N0 = index[Nq - 1];
-				N1 = index[Nq];
+			/* Mapped dataset is always served through the
+			 * chunk cache so we drop the plain chunks.
+			 * */
+			for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
 
-				fval = pl->data[dN].sub[sN].op.median.window[N0].fval;
-				fpay = pl->data[dN].sub[sN].op.median.window[N1].fval;
+				if (pl->data[dN].raw[N] != NULL) {
 
-				if (fval < fpay) {
+					free(pl->data[dN].raw[N]);
 
-					index[Nq - 1] = N1;
-					index[Nq] = N0;
+					pl->data[dN].raw[N] = NULL;
 				}
 			}
+
+			pl->data[dN].lz4_compress = LZ4_COMPRESS_ROWS;
 		}
-	}
 
-	if (total > 2 || (length < 3 && total > 0)) {
+		if (pl->data[dN].lz4_compress != 0) {
 
-		mN.X = index[total / 2];
-		mN.Y = mN.X;
+			plotDataCacheClean(pl, dN);
+		}
+
+		plotDataChunkAlloc(pl, dN, lN);
+
+		pl->data[dN].head_N = 0;
+		pl->data[dN].tail_N = 0;
+		pl->data[dN].id_N = 0;
+		pl->data[dN].sub_N = 0;
 	}
+	else {
+		pl->data[dN].column_N = cN;
 
-	if (pl->data[dN].sub[sN].op.median.opdata != 0) {
+		for (N = 0; N < 30; ++N) {
 
-		for (N = 0, total = 0; N < keep; ++N) {
+			bSIZE = (int) sizeof(fval_t) * (cN + PLOT_SUBTRACT) * (1UL << N);
+
+			if (bSIZE >= PLOT_CHUNK_SIZE) {
 
-			fval = pl->data[dN].sub[sN].op.median.window[N].fval;
-			fpay = pl->data[dN].sub[sN].op.median.window[N].fpay;
+				pl->data[dN].chunk_SHIFT = N;
+				pl->data[dN].chunk_MASK = (1UL << N) - 1UL;
+				pl->data[dN].chunk_bSIZE = bSIZE;
+				break;
+			}
+		}
 
-			if (fp_isfinite(fval) && fp_isfinite(fpay)) {
+		pl->data[dN].lz4_compress = (pl->data[dN].mapped.raw != NULL
+				&& pl->lz4_compress == LZ4_COMPRESS_NONE)
+			? LZ4_COMPRESS_ROWS : pl->lz4_compress;
 
-				index[total++] = N;
+		plotDataChunkAlloc(pl, dN, lN);
 
-				for (Nq = total - 1; Nq > 0; --Nq) {
+		/* Cache size is taken from memory budget.
+		 * */
+		N = (int) (((long long) pl->cache_budget << 20) / pl->data[dN].chunk_bSIZE);
 
-					N0 = index[Nq - 1];
-					N1 = index[Nq];
+		pl->data[dN].cache_N = (N < PLOT_CHUNK_CACHE) ? PLOT_CHUNK_CACHE
+			: (N > PLOT_CHUNK_CACHE_MAX) ? PLOT_CHUNK_CACHE_MAX : N;
 
-					fval = pl->data[dN].sub[sN].op.median.window[N0].fpay;
-					fpay = pl->data[dN].sub[sN].op.median.window[N1].fpay;
+		pl->data[dN].cache_ID = 0;
+		pl->data[dN].cache_kN = 0;
 
-					if (fval < fpay) {
+		for (N = 0; N < PLOT_CHUNK_CACHE_MAX; ++N) {
 
-						index[Nq - 1] = N1;
-						index[Nq] = N0;
-					}
-				}
-			}
+			pl->data[dN].cache[N].chunk_N = -1;
 		}
 
-		if (total > 2 || (length < 3 && total > 0)) {
+		pl->data[dN].head_N = 0;
+		pl->data[dN].tail_N = 0;
+		pl->data[dN].id_N = 0;
+		pl->data[dN].sub_N = 0;
+
+		for (N = 0; N < PLOT_SUBTRACT; ++N) {
 
-			mN.Y = index[total / 2];
+			pl->data[dN].sub[N].busy = SUBTRACT_FREE;
 		}
-	}
 
-	return mN;
+		map = (int *) malloc(sizeof(int) * (cN + PLOT_SUBTRACT + 1));
+
+		if (map == NULL) {
+
+			ERROR("No memory allocated for %i map\n", dN);
+			return ;
+		}
+
+		pl->data[dN].map = (int *) map + 1;
+
+		for (N = -1; N < cN + PLOT_SUBTRACT; ++N) {
+
+			pl->data[dN].map[N] = -1;
+		}
+	}
 }
 
-static void
-plotDataResample(plot_t *pl, int dN, int cNX, int cNY, int in_dN, int in_cNX, int in_cNY)
+void plotDataResize(plot_t *pl, int dN, int lN)
 {
-	fval_t		*row, X, Y, X2, Y2, prev_X2, prev_Y2, Qf;
-	const fval_t	*prey;
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
 
-	int		rN, id_N, rN2, id_N2;
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
 
-	rN = pl->data[dN].head_N;
-	id_N = pl->data[dN].id_N;
+	if (lN < 1) {
+
+		ERROR("Length of dataset is too short\n");
+		return ;
+	}
+
+	if (pl->data[dN].column_N != 0) {
+
+		if (lN < pl->data[dN].length_N) {
+
+			pl->data[dN].head_N = 0;
+			pl->data[dN].tail_N = 0;
+			pl->data[dN].id_N = 0;
+			pl->data[dN].sub_N = 0;
+		}
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataCacheClean(pl, dN);
+		}
+
+		plotDataChunkAlloc(pl, dN, lN);
+	}
+}
+
+int plotDataLength(plot_t *pl, int dN)
+{
+	int		N;
+
+	N = pl->data[dN].tail_N - pl->data[dN].head_N;
+	N += (N < 0) ? pl->data[dN].length_N : 0;
+
+	return N;
+}
+
+int plotDataSpaceLeft(plot_t *pl, int dN)
+{
+	return pl->data[dN].length_N - plotDataLength(pl, dN);
+}
+
+void plotDataGrowUp(plot_t *pl, int dN)
+{
+	int			lSHIFT, lN;
+
+	lSHIFT = pl->data[dN].chunk_SHIFT;
+
+	lN = pl->data[dN].length_N;
+	lN = ((lN >> lSHIFT) + 1) << lSHIFT;
+
+	plotDataResize(pl, dN, lN);
+}
+
+static const fval_t *
+plotDataGet(plot_t *pl, int dN, int *rN)
+{
+	const fval_t	*row = NULL;
+
+	int		lN, kN, jN;
+
+	if (*rN != pl->data[dN].tail_N) {
+
+		kN = *rN >> pl->data[dN].chunk_SHIFT;
+		jN = *rN & pl->data[dN].chunk_MASK;
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataChunkFetch(pl, dN, kN);
+		}
+
+		row = pl->data[dN].raw[kN];
+
+		if (row != NULL) {
+
+			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+
+			lN = pl->data[dN].length_N;
+			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
+		}
+	}
+
+	return row;
+}
+
+static void
+plotDataRangeCacheWipe(plot_t *pl, int dN, int kN, int jN)
+{
+	int		N;
+
+	jN &= ~((1 << PLOT_LOD_SHIFT) - 1);
+
+	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
+
+		if (		pl->rcache[N].busy != 0
+				&& pl->rcache[N].data_N == dN) {
+
+			pl->rcache[N].chunk[kN].computed = 0;
+			pl->rcache[N].cached = 0;
+
+			/* Keep the pyramid of rows that were not touched.
+			 * */
+			if (pl->rcache[N].chunk[kN].lod_N > jN) {
+
+				pl->rcache[N].chunk[kN].lod_N = jN;
+			}
+		}
+	}
+}
+
+static fval_t *
+plotDataWrite(plot_t *pl, int dN, int *rN)
+{
+	fval_t		*row = NULL;
+	int		lN, kN, jN;
+
+	if (*rN != pl->data[dN].tail_N) {
+
+		kN = *rN >> pl->data[dN].chunk_SHIFT;
+		jN = *rN & pl->data[dN].chunk_MASK;
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataChunkWrite(pl, dN, kN);
+		}
+
+		if (		   pl->rcache_wipe_data_N != dN
+				|| pl->rcache_wipe_chunk_N != kN) {
+
+			plotDataRangeCacheWipe(pl, dN, kN, 0);
+
+			pl->rcache_wipe_data_N = dN;
+			pl->rcache_wipe_chunk_N = kN;
+		}
+
+		row = pl->data[dN].raw[kN];
+
+		if (row != NULL) {
+
+			row += (pl->data[dN].column_N + PLOT_SUBTRACT) * jN;
+
+			lN = pl->data[dN].length_N;
+			*rN = (*rN < lN - 1) ? *rN + 1 : 0;
+		}
+	}
+
+	return row;
+}
+
+static void
+plotDataSkip(plot_t *pl, int dN, int *rN, int *id_N, int iN)
+{
+	int		N, lN, tN;
+
+	lN = pl->data[dN].length_N;
+
+	N = *rN - pl->data[dN].head_N;
+	N = (N < 0) ? N + lN : N;
+
+	tN = pl->data[dN].tail_N - pl->data[dN].head_N;
+	tN = (tN < 0) ? tN + lN : tN;
+
+	iN = (N + iN < 0) ? - N : iN;
+	iN = (N + iN > tN) ? tN - N : iN;
+
+	N += iN;
+
+	N = pl->data[dN].head_N + N;
+	N = (N > lN - 1) ? N - lN : N;
+
+	if (rN != NULL) {
+
+		*rN = N;
+	}
+
+	if (id_N != NULL) {
+
+		*id_N += iN;
+	}
+}
+
+static int
+plotDataChunkN(plot_t *pl, int dN, int rN)
+{
+	int		kN;
+
+	kN = rN >> pl->data[dN].chunk_SHIFT;
+
+	return kN;
+}
+
+static void
+plotDataChunkSkip(plot_t *pl, int dN, int *rN, int *id_N)
+{
+	int		skip_N, wrap_N;
+
+	skip_N = (1UL << pl->data[dN].chunk_SHIFT)
+		- (*rN & pl->data[dN].chunk_MASK);
+
+	wrap_N = pl->data[dN].length_N - *rN;
+	skip_N = (wrap_N < skip_N) ? wrap_N : skip_N;
+
+	plotDataSkip(pl, dN, rN, id_N, skip_N);
+}
+
+static tuple_t
+plotDataMedianAdd(plot_t *pl, int dN, int sN, double fval, double fpay)
+{
+	median_t	*mX, *mY;
+	int		N, length, keep, tail, total;
+
+	tuple_t		mN = { -1, -1 };
+
+	length = pl->data[dN].sub[sN].op.median.length;
+	keep = pl->data[dN].sub[sN].op.median.keep;
+	tail = pl->data[dN].sub[sN].op.median.tail;
+
+	mX = pl->data[dN].sub[sN].median[0];
+	mY = pl->data[dN].sub[sN].median[1];
+
+	if (mX == NULL || mX->length != length) {
+
+		for (N = 0; N < 2; ++N) {
+
+			if (pl->data[dN].sub[sN].median[N] != NULL) {
+
+				free(pl->data[dN].sub[sN].median[N]);
+			}
+
+			pl->data[dN].sub[sN].median[N] = medianAlloc(length);
+		}
+
+		mX = pl->data[dN].sub[sN].median[0];
+		mY = pl->data[dN].sub[sN].median[1];
+
+		if (mX == NULL || mY == NULL) {
+
+			ERROR("No memory allocated for median of %i dataset\n", dN);
+			return mN;
+		}
+
+		keep = 0;
+		tail = 0;
+	}
+
+	if (keep == 0) {
+
+		medianClean(mX);
+		medianClean(mY);
+	}
+
+	/* Replace the oldest value in the window, non-finite values are
+	 * stored but do not take part in the median.
+	 * */
+	medianRemove(mX, tail);
+	medianRemove(mY, tail);
+
+	mX->value[tail] = fval;
+	mY->value[tail] = fpay;
+
+	if (fp_isfinite(fval)) {
+
+		medianInsert(mX, tail, fval);
+
+		if (		pl->data[dN].sub[sN].op.median.opdata != 0
+				&& fp_isfinite(fpay)) {
+
+			medianInsert(mY, tail, fpay);
+		}
+	}
+
+	keep = (keep < length - 1) ? keep + 1 : length;
+	tail = (tail < length - 1) ? tail + 1 : 0;
+
+	pl->data[dN].sub[sN].op.median.keep = keep;
+	pl->data[dN].sub[sN].op.median.tail = tail;
+
+	total = medianTotal(mX);
+
+	if (total > 2 || (length < 3 && total > 0)) {
+
+		mN.X = medianGet(mX);
+		mN.Y = mN.X;
+	}
+
+	if (pl->data[dN].sub[sN].op.median.opdata != 0) {
+
+		total = medianTotal(mY);
+
+		if (total > 2 || (length < 3 && total > 0)) {
+
+			mN.Y = medianGet(mY);
+		}
+	}
+
+	return mN;
+}
+
+static void
+plotDataResample(plot_t *pl, int dN, int cNX, int cNY, int in_dN, int in_cNX, int in_cNY)
+{
+	fval_t		*row, X, Y, X2, Y2, prev_X2, prev_Y2, Qf;
+	const fval_t	*prey;
+
+	int		rN, id_N, rN2, id_N2;
+
+	rN = pl->data[dN].head_N;
+	id_N = pl->data[dN].id_N;
+
+	rN2 = pl->data[in_dN].head_N;
+	id_N2 = pl->data[in_dN].id_N;
+
+	do {
+		prey = plotDataGet(pl, in_dN, &rN2);
+
+		if (prey == NULL)
+			break;
+
+		X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
+		Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+
+		id_N2++;
+
+		if (fp_isfinite(X2))
+			break;
+	}
+	while (1);
+
+	if (id_N2 != pl->data[in_dN].id_N) {
+
+		prev_X2 = X2;
+		prev_Y2 = Y2;
+	}
+	else {
+		ERROR("No data to resample in dataset %i column %i\n", in_dN, in_cNX);
+		return ;
+	}
+
+	do {
+		row = plotDataWrite(pl, dN, &rN);
+
+		if (row == NULL)
+			break;
+
+		X = (cNX < 0) ? id_N : row[cNX];
+
+		if (fp_isfinite(X)) {
+
+			do {
+				if (X2 >= X)
+					break;
+
+				prey = plotDataGet(pl, in_dN, &rN2);
+
+				if (prey == NULL)
+					break;
+
+				if (fp_isfinite(X2)) {
+
+					prev_X2 = X2;
+					prev_Y2 = Y2;
+				}
+
+				X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
+				Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+
+				id_N2++;
+			}
+			while (1);
+
+			if (prev_X2 + (fval_t) pl->defungap > X2) {
+
+				if (		pl->interpolation != 0
+						&& X2 >= X) {
+
+					if (		prev_X2 <= X
+							&& prev_X2 < X2) {
+
+						Qf = (X - prev_X2) / (X2 - prev_X2);
+						Y = prev_Y2 + (Y2 - prev_Y2) * Qf;
+					}
+					else {
+						Y = prev_Y2;
+					}
+				}
+				else {
+					Y = Y2;
+				}
+			}
+			else {
+				Y = FP_NAN;
+			}
+		}
+		else {
+			Y = FP_NAN;
+		}
+
+		row[cNY] = Y;
+
+		id_N++;
+	}
+	while (1);
+}
+
+static void
+plotDataPolyfitRun(polyfit_job_t *job)
+{
+	double		fvec[LSE_FULL_MAX];
+	int		N, lN;
+
+	for (lN = 0; lN < job->length; ++lN) {
+
+		fvec[0] = 1.;
+
+		for (N = 0; N < job->N1; ++N)
+			fvec[N + 1] = fvec[N] * job->xy[lN * 2 + 0];
+
+		for (N = 0; N < job->N1 - job->N0 + 1; ++N)
+			fvec[N] = fvec[N + job->N0];
+
+		fvec[job->N1 - job->N0 + 1] = job->xy[lN * 2 + 1];
+
+		lse_insert(&job->lsq, fvec);
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+}
+
+static polyfit_job_t *
+plotDataPolyfitAlloc(int N0, int N1)
+{
+	polyfit_job_t	*job;
+
+	job = (polyfit_job_t *) malloc(sizeof(polyfit_job_t));
+
+	if (job == NULL) {
+
+		ERROR("No memory allocated for polyfit job\n");
+		return NULL;
+	}
+
+	lse_construct(&job->lsq, LSE_CASCADE_MAX, N1 - N0 + 1, 1);
+
+	job->N0 = N0;
+	job->N1 = N1;
+	job->length = 0;
+
+	SDL_AtomicSet(&job->done, 0);
+
+	return job;
+}
+
+static void
+plotDataPolyfitSubmit(plot_t *pl, polyfit_job_t *job)
+{
+	if (		pl->pool == NULL
+			|| async_pool_submit(pl->pool, (void (*) (void *))
+				&plotDataPolyfitRun, job) != ASYNC_OK) {
+
+		plotDataPolyfitRun(job);
+	}
+}
+
+static void
+plotDataPolyfitMerge(plot_t *pl, polyfit_job_t *job)
+{
+	while (SDL_AtomicGet(&job->done) == 0) {
+
+		SDL_Delay(1);
+	}
+
+	if (job->lsq.n_total != 0) {
+
+		/* Note that lse_merge() does not count the data rows.
+		 * */
+		lse_merge(&pl->lsq, &job->lsq);
+
+		pl->lsq.n_total += job->lsq.n_total;
+	}
+
+	free(job);
+}
+
+static void
+plotDataPolyfit(plot_t *pl, int dN, int cNX, int cNY,
+		double scale_X, double offset_X,
+		double scale_Y, double offset_Y, int N0, int N1)
+{
+	const fval_t	*row;
+
+	polyfit_job_t	*queue[ASYNC_THREAD_MAX * 2], *job;
+
+	double		fval_X, fval_Y, fvec[2];
+	int		N, xN, yN, kN, rN, id_N, job_N, queue_N, queue_MAX;
+
+	lse_construct(&pl->lsq, LSE_CASCADE_MAX, N1 - N0 + 1, 1);
+
+	xN = plotDataRangeCacheFetch(pl, dN, cNX);
+	yN = plotDataRangeCacheFetch(pl, dN, cNY);
+
+	/* We gather the rows in range into blocks and do QR updates of each
+	 * block on the worker thread. Then blocks are merged in order.
+	 * */
+	plotPoolOpen(pl);
+
+	queue_MAX = (pl->pool != NULL) ? pl->pool->thread_N * 2 : 1;
+	queue_MAX = (queue_MAX < 1) ? 1 : queue_MAX;
+	queue_N = 0;
+
+	job = plotDataPolyfitAlloc(N0, N1);
+
+	if (job == NULL)
+		return ;
+
+	rN = pl->data[dN].head_N;
+	id_N = pl->data[dN].id_N;
+
+	do {
+		kN = plotDataChunkN(pl, dN, rN);
+		job_N = 1;
+
+		if (xN >= 0 && pl->rcache[xN].chunk[kN].computed != 0) {
+
+			if (pl->rcache[xN].chunk[kN].finite != 0) {
+
+				fvec[0] = pl->rcache[xN].chunk[kN].fmin * scale_X + offset_X;
+				fvec[1] = pl->rcache[xN].chunk[kN].fmax * scale_X + offset_X;
+
+				if (fvec[0] > 1. || fvec[1] < 0.) {
+
+					job_N = 0;
+				}
+			}
+			else {
+				job_N = 0;
+			}
+		}
+
+		if (yN >= 0 && pl->rcache[yN].chunk[kN].computed != 0) {
+
+			if (pl->rcache[yN].chunk[kN].finite != 0) {
+
+				fvec[0] = pl->rcache[yN].chunk[kN].fmin * scale_Y + offset_Y;
+				fvec[1] = pl->rcache[yN].chunk[kN].fmax * scale_Y + offset_Y;
+
+				if (fvec[0] > 1. || fvec[1] < 0.) {
+
+					job_N = 0;
+				}
+			}
+			else {
+				job_N = 0;
+			}
+		}
+
+		if (job_N != 0) {
+
+			do {
+				if (kN != plotDataChunkN(pl, dN, rN))
+					break;
+
+				row = plotDataGet(pl, dN, &rN);
+
+				if (row == NULL)
+					break;
+
+				fval_X = (cNX < 0) ? id_N : row[cNX];
+				fval_Y = (cNY < 0) ? id_N : row[cNY];
+
+				if (fp_isfinite(fval_X) && fp_isfinite(fval_Y)) {
+
+					fvec[0] = fval_X * scale_X + offset_X;
+					fvec[1] = fval_Y * scale_Y + offset_Y;
+
+					if (		   fvec[0] >= 0. && fvec[0] <= 1.
+							&& fvec[1] >= 0. && fvec[1] <= 1.) {
+
+						job->xy[job->length * 2 + 0] = fval_X;
+						job->xy[job->length * 2 + 1] = fval_Y;
+
+						job->length++;
+					}
+				}
+
+				if (job->length >= PLOT_POLYFIT_BLOCK) {
+
+					if (queue_N >= queue_MAX) {
+
+						plotDataPolyfitMerge(pl, queue[0]);
+
+						for (N = 1; N < queue_N; ++N)
+							queue[N - 1] = queue[N];
+
+						queue_N--;
+					}
+
+					plotDataPolyfitSubmit(pl, job);
+
+					queue[queue_N++] = job;
+
+					job = plotDataPolyfitAlloc(N0, N1);
+
+					if (job == NULL)
+						break;
+				}
+
+				id_N++;
+			}
+			while (1);
+		}
+		else {
+			plotDataChunkSkip(pl, dN, &rN, &id_N);
+		}
+
+		if (job == NULL || rN == pl->data[dN].tail_N)
+			break;
+	}
+	while (1);
+
+	if (job != NULL) {
+
+		/* The last block is done on the UI thread.
+		 * */
+		plotDataPolyfitRun(job);
+
+		if (queue_N >= queue_MAX) {
+
+			plotDataPolyfitMerge(pl, queue[0]);
+
+			for (N = 1; N < queue_N; ++N)
+				queue[N - 1] = queue[N];
+
+			queue_N--;
+		}
+
+		queue[queue_N++] = job;
+	}
+
+	for (N = 0; N < queue_N; ++N) {
+
+		plotDataPolyfitMerge(pl, queue[N]);
+	}
+
+	lse_solve(&pl->lsq);
+	lse_std(&pl->lsq);
+}
+
+static void
+plotDataSpectrumRun(spectrum_job_t *job)
+{
+	int		N;
+
+	for (N = 0; N + job->ft->length <= job->length; N += job->hop) {
+
+		fftPower(job->ft, job->power, job->x + N, job->work);
+
+		job->segment_N++;
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+}
+
+static spectrum_job_t *
+plotDataSpectrumAlloc(const fft_t *ft, int hop, int block)
+{
+	spectrum_job_t	*job;
+
+	int		N, M;
+
+	M = ft->length / 2 + 1;
+
+	job = (spectrum_job_t *) malloc(sizeof(spectrum_job_t) + sizeof(double)
+			+ (block + M + fftWorkSize(ft)) * sizeof(double));
+
+	if (job == NULL) {
+
+		ERROR("No memory allocated for spectrum job\n");
+		return NULL;
+	}
+
+	job->ft = ft;
+	job->hop = hop;
+	job->length = 0;
+	job->segment_N = 0;
+
+	job->x = (double *) (((size_t) (job + 1) + sizeof(double) - 1)
+			& ~(sizeof(double) - 1));
+
+	job->power = job->x + block;
+	job->work = job->power + M;
+
+	for (N = 0; N < M; ++N)
+		job->power[N] = 0.;
+
+	SDL_AtomicSet(&job->done, 0);
+
+	return job;
+}
+
+static void
+plotDataSpectrumSubmit(plot_t *pl, spectrum_job_t *job)
+{
+	if (		pl->pool == NULL
+			|| async_pool_submit(pl->pool, (void (*) (void *))
+				&plotDataSpectrumRun, job) != ASYNC_OK) {
+
+		plotDataSpectrumRun(job);
+	}
+}
+
+static int
+plotDataSpectrumMerge(spectrum_job_t *job, double *power)
+{
+	int		N, segment_N;
+
+	while (SDL_AtomicGet(&job->done) == 0) {
+
+		SDL_Delay(1);
+	}
+
+	for (N = 0; N < job->ft->length / 2 + 1; ++N)
+		power[N] += job->power[N];
+
+	segment_N = job->segment_N;
+
+	free(job);
+
+	return segment_N;
+}
+
+/* The function estimates the power spectral density of Y column over the
+ * rows with X column in visible range. We use Welch method with Hann window
+ * and half overlap of segments, each block of segments is transformed on the
+ * worker thread and then blocks are summed in order. Zero \length means one
+ * segment as long as possible with no overlap.
+ * */
+static int
+plotDataSpectrum(plot_t *pl, int dN, int cNX, int cNY,
+		double scale_X, double offset_X, int length,
+		double *power, double *pfs)
+{
+	const fval_t	*row;
+
+	spectrum_job_t	*queue[ASYNC_THREAD_MAX * 2], *job, *next;
+	fft_t		*ft;
+
+	double		fval_X, fval_Y, fvec[2], tmin, tmax;
+	int		N, xN, kN, rN, id_N, pass, job_N, queue_N, queue_MAX;
+	int		hop, block, total_N, segment_N;
+
+	xN = plotDataRangeCacheFetch(pl, dN, cNX);
+
+	total_N = 0;
+	segment_N = 0;
+
+	tmin = 0.;
+	tmax = 0.;
+
+	ft = NULL;
+	job = NULL;
+
+	queue_N = 0;
+	queue_MAX = 1;
+
+	hop = 0;
+	block = 0;
+
+	/* First pass counts the samples so we know the sampling rate and the
+	 * largest segment. Second pass gathers samples into the jobs.
+	 * */
+	for (pass = 0; pass < 2; ++pass) {
+
+		rN = pl->data[dN].head_N;
+		id_N = pl->data[dN].id_N;
+
+		do {
+			kN = plotDataChunkN(pl, dN, rN);
+			job_N = 1;
+
+			if (xN >= 0 && pl->rcache[xN].chunk[kN].computed != 0) {
+
+				if (pl->rcache[xN].chunk[kN].finite != 0) {
+
+					fvec[0] = pl->rcache[xN].chunk[kN].fmin * scale_X + offset_X;
+					fvec[1] = pl->rcache[xN].chunk[kN].fmax * scale_X + offset_X;
+
+					if (fvec[0] > 1. || fvec[1] < 0.) {
+
+						job_N = 0;
+					}
+				}
+				else {
+					job_N = 0;
+				}
+			}
+
+			if (job_N != 0) {
+
+				do {
+					if (kN != plotDataChunkN(pl, dN, rN))
+						break;
+
+					row = plotDataGet(pl, dN, &rN);
 
-	rN2 = pl->data[in_dN].head_N;
-	id_N2 = pl->data[in_dN].id_N;
+					if (row == NULL)
+						break;
 
-	do {
-		prey = plotDataGet(pl, in_dN, &rN2);
+					fval_X = (cNX < 0) ? id_N : row[cNX];
+					fval_Y = (cNY < 0) ? id_N : row[cNY];
 
-		if (prey == NULL)
-			break;
+					id_N++;
 
-		X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
-		Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+					if (		fp_isfinite(fval_X) == 0
+							|| fp_isfinite(fval_Y) == 0)
+						continue;
 
-		id_N2++;
+					fvec[0] = fval_X * scale_X + offset_X;
 
-		if (fp_isfinite(X2))
-			break;
-	}
-	while (1);
+					if (fvec[0] < 0. || fvec[0] > 1.)
+						continue;
 
-	if (id_N2 != pl->data[in_dN].id_N) {
+					if (pass == 0) {
 
-		prev_X2 = X2;
-		prev_Y2 = Y2;
-	}
-	else {
-		ERROR("No data to resample in dataset %i column %i\n", in_dN, in_cNX);
-		return ;
-	}
+						tmin = (total_N == 0) ? fval_X : tmin;
+						tmax = fval_X;
 
-	do {
-		row = plotDataWrite(pl, dN, &rN);
+						total_N++;
+						continue;
+					}
 
-		if (row == NULL)
-			break;
+					job->x[job->length++] = fval_Y;
 
-		X = (cNX < 0) ? id_N : row[cNX];
+					if (job->length >= block) {
 
-		if (fp_isfinite(X)) {
+						if (queue_N >= queue_MAX) {
 
-			do {
-				if (X2 >= X)
-					break;
+							segment_N += plotDataSpectrumMerge(queue[0], power);
 
-				prey = plotDataGet(pl, in_dN, &rN2);
+							for (N = 1; N < queue_N; ++N)
+								queue[N - 1] = queue[N];
 
-				if (prey == NULL)
-					break;
+							queue_N--;
+						}
 
-				if (fp_isfinite(X2)) {
+						next = plotDataSpectrumAlloc(ft, hop, block);
 
-					prev_X2 = X2;
-					prev_Y2 = Y2;
-				}
+						if (next != NULL) {
 
-				X2 = (in_cNX < 0) ? id_N2 : prey[in_cNX];
-				Y2 = (in_cNY < 0) ? id_N2 : prey[in_cNY];
+							/* Samples after the last segment
+							 * start are carried to the next job.
+							 * */
+							N = ((block - ft->length) / hop + 1) * hop;
 
-				id_N2++;
-			}
-			while (1);
+							memcpy(next->x, job->x + N, (block - N) * sizeof(double));
 
-			if (prev_X2 + (fval_t) pl->defungap > X2) {
+							next->length = block - N;
+						}
 
-				if (		pl->interpolation != 0
-						&& X2 >= X) {
+						plotDataSpectrumSubmit(pl, job);
 
-					if (		prev_X2 <= X
-							&& prev_X2 < X2) {
+						queue[queue_N++] = job;
 
-						Qf = (X - prev_X2) / (X2 - prev_X2);
-						Y = prev_Y2 + (Y2 - prev_Y2) * Qf;
-					}
-					else {
-						Y = prev_Y2;
+						job = next;
+
+						if (job == NULL)
+							break;
 					}
 				}
-				else {
-					Y = Y2;
-				}
+				while (1);
 			}
 			else {
-				Y = FP_NAN;
+				plotDataChunkSkip(pl, dN, &rN, &id_N);
 			}
+
+			if (		(pass != 0 && job == NULL)
+					|| rN == pl->data[dN].tail_N)
+				break;
 		}
-		else {
-			Y = FP_NAN;
-		}
+		while (1);
 
-		row[cNY] = Y;
+		if (pass == 0) {
 
-		id_N++;
-	}
-	while (1);
-}
+			if (total_N < (1 << FFT_SHIFT_MIN) || tmax <= tmin) {
 
-static void
-plotDataPolyfit(plot_t *pl, int dN, int cNX, int cNY,
-		double scale_X, double offset_X,
-		double scale_Y, double offset_Y, int N0, int N1)
-{
-	const fval_t	*row;
+				ERROR("Not enough samples in range to get spectrum\n");
+				return -1;
+			}
 
-	double		fval_X, fval_Y, fvec[LSE_FULL_MAX];
-	int		N, xN, yN, kN, rN, id_N, job;
+			if (length == 0) {
 
-	lse_construct(&pl->lsq, LSE_CASCADE_MAX, N1 - N0 + 1, 1);
+				for (length = 1 << FFT_SHIFT_MIN; length < (1 << PLOT_SPECTRUM_SHIFT)
+						&& length * 2 <= total_N; length *= 2) ;
 
-	xN = plotDataRangeCacheFetch(pl, dN, cNX);
-	yN = plotDataRangeCacheFetch(pl, dN, cNY);
+				hop = length;
+			}
+			else {
+				hop = length / 2;
+			}
 
-	rN = pl->data[dN].head_N;
-	id_N = pl->data[dN].id_N;
+			if (length < 0 || length > (1 << PLOT_SPECTRUM_SHIFT)) {
 
-	do {
-		kN = plotDataChunkN(pl, dN, rN);
-		job = 1;
+				ERROR("Segment length %i is out of range\n", length);
+				return -1;
+			}
 
-		if (xN >= 0 && pl->rcache[xN].chunk[kN].computed != 0) {
+			if (length > total_N) {
 
-			if (pl->rcache[xN].chunk[kN].finite != 0) {
+				ERROR("Segment length %i is more than %i samples\n",
+						length, total_N);
+				return -1;
+			}
 
-				fvec[0] = pl->rcache[xN].chunk[kN].fmin * scale_X + offset_X;
-				fvec[1] = pl->rcache[xN].chunk[kN].fmax * scale_X + offset_X;
+			ft = fftAlloc(length);
 
-				if (fvec[0] > 1. || fvec[1] < 0.) {
+			if (ft == NULL) {
 
-					job = 0;
-				}
-			}
-			else {
-				job = 0;
+				ERROR("Segment length %i is not power of two\n", length);
+				return -1;
 			}
-		}
 
-		if (yN >= 0 && pl->rcache[yN].chunk[kN].computed != 0) {
+			for (N = 0; N < length / 2 + 1; ++N)
+				power[N] = 0.;
 
-			if (pl->rcache[yN].chunk[kN].finite != 0) {
+			block = (PLOT_SPECTRUM_BLOCK > length * 2)
+				? PLOT_SPECTRUM_BLOCK : length * 2;
 
-				fvec[0] = pl->rcache[yN].chunk[kN].fmin * scale_Y + offset_Y;
-				fvec[1] = pl->rcache[yN].chunk[kN].fmax * scale_Y + offset_Y;
+			plotPoolOpen(pl);
 
-				if (fvec[0] > 1. || fvec[1] < 0.) {
+			queue_MAX = (pl->pool != NULL) ? pl->pool->thread_N * 2 : 1;
+			queue_MAX = (queue_MAX > PLOT_SPECTRUM_QUEUE / block)
+				? PLOT_SPECTRUM_QUEUE / block : queue_MAX;
+			queue_MAX = (queue_MAX < 1) ? 1 : queue_MAX;
 
-					job = 0;
-				}
-			}
-			else {
-				job = 0;
+			job = plotDataSpectrumAlloc(ft, hop, block);
+
+			if (job == NULL) {
+
+				free(ft);
+				return -1;
 			}
 		}
+	}
 
-		if (job != 0) {
+	if (job != NULL) {
 
-			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
-					break;
+		/* The last block is done on the UI thread.
+		 * */
+		plotDataSpectrumRun(job);
 
-				row = plotDataGet(pl, dN, &rN);
+		if (queue_N >= queue_MAX) {
 
-				if (row == NULL)
-					break;
+			segment_N += plotDataSpectrumMerge(queue[0], power);
 
-				fval_X = (cNX < 0) ? id_N : row[cNX];
-				fval_Y = (cNY < 0) ? id_N : row[cNY];
+			for (N = 1; N < queue_N; ++N)
+				queue[N - 1] = queue[N];
 
-				if (fp_isfinite(fval_X) && fp_isfinite(fval_Y)) {
+			queue_N--;
+		}
 
-					fvec[0] = fval_X * scale_X + offset_X;
-					fvec[1] = fval_Y * scale_Y + offset_Y;
+		queue[queue_N++] = job;
+	}
 
-					if (		   fvec[0] >= 0. && fvec[0] <= 1.
-							&& fvec[1] >= 0. && fvec[1] <= 1.) {
+	for (N = 0; N < queue_N; ++N) {
 
-						fvec[0] = 1.;
+		segment_N += plotDataSpectrumMerge(queue[N], power);
+	}
 
-						for (N = 0; N < N1; ++N)
-							fvec[N + 1] = fvec[N] * fval_X;
+	if (segment_N == 0) {
 
-						for (N = 0; N < N1 - N0 + 1; ++N)
-							fvec[N] = fvec[N + N0];
+		free(ft);
+		return -1;
+	}
 
-						fvec[N1 - N0 + 1] = fval_Y;
+	/* One-sided density is normalized by sampling rate and window power.
+	 * */
+	*pfs = (double) (total_N - 1) / (tmax - tmin);
 
-						lse_insert(&pl->lsq, fvec);
-					}
-				}
+	fval_X = 1. / (*pfs * ft->wsum * (double) segment_N);
 
-				id_N++;
-			}
-			while (1);
-		}
-		else {
-			plotDataChunkSkip(pl, dN, &rN, &id_N);
-		}
+	for (N = 0; N < length / 2 + 1; ++N) {
 
-		if (rN == pl->data[dN].tail_N)
-			break;
+		power[N] *= (N > 0 && N < length / 2) ? 2. * fval_X : fval_X;
 	}
-	while (1);
 
-	lse_solve(&pl->lsq);
-	lse_std(&pl->lsq);
+	free(ft);
+
+	return length;
 }
 
 static void
@@ -1302,8 +2389,8 @@ plotDataSubtractWrite(plot_t *pl, int dN, int sN, int rN_beg, int id_N_beg, int
 				X2 = FP_NAN;
 			}
 			else {
-				X1 = pl->data[dN].sub[sN].op.median.window[mN.X].fval;
-				X2 = pl->data[dN].sub[sN].op.median.window[mN.Y].fpay;
+				X1 = pl->data[dN].sub[sN].median[0]->value[mN.X];
+				X2 = pl->data[dN].sub[sN].median[1]->value[mN.Y];
 			}
 
 			if (pl->data[dN].sub[sN].op.median.unwrap == UNWRAP_OVERFLOW) {
@@ -1720,7 +2807,7 @@ plotDataSubtractWrite(plot_t *pl, int dN, int sN, int rN_beg, int id_N_beg, int
 				X2 = FP_NAN;
 			}
 			else {
-				X2 = pl->data[dN].sub[sN].op.median.window[mN.X].fval;
+				X2 = pl->data[dN].sub[sN].median[0]->value[mN.X];
 			}
 
 			row[cN] = X2;
@@ -1770,6 +2857,56 @@ plotDataSubtractWrite(plot_t *pl, int dN, int sN, int rN_beg, int id_N_beg, int
 
 		pl->data[dN].sub[sN].op.filter.state[0] = (double) X3;
 	}
+	else if (mode == SUBTRACT_EXPRESSION) {
+
+		fval_t		*block[EXPR_BLOCK];
+		fval_t		result[EXPR_BLOCK];
+
+		int		N, lN, kN, id_N_block;
+
+		if (pl->data[dN].sub[sN].expr == NULL)
+			return ;
+
+		do {
+			/* We gather rows within one chunk only so the row
+			 * pointers are kept valid in the chunk cache.
+			 * */
+			kN = rN >> pl->data[dN].chunk_SHIFT;
+
+			id_N_block = id_N;
+			lN = 0;
+
+			do {
+				row = plotDataWrite(pl, dN, &rN);
+
+				if (row == NULL)
+					break;
+
+				block[lN++] = row;
+
+				id_N++;
+
+				if (		rN == rN_end || lN >= EXPR_BLOCK
+						|| kN != (rN >> pl->data[dN].chunk_SHIFT))
+					break;
+			}
+			while (1);
+
+			if (lN != 0) {
+
+				exprEval(pl->data[dN].sub[sN].expr, result,
+						(const double * const *) block,
+						(double) id_N_block, lN);
+
+				for (N = 0; N < lN; ++N)
+					block[N][cN] = result[N];
+			}
+
+			if (row == NULL || rN == rN_end)
+				break;
+		}
+		while (1);
+	}
 }
 
 static void
@@ -1880,6 +3017,32 @@ void plotDataSubtractResidual(plot_t *pl, int dN)
 	pl->data[dN].sub_N = rN_end;
 }
 
+static void
+plotDataSubtractFree(plot_t *pl, int dN)
+{
+	int		sN, N;
+
+	for (sN = 0; sN < PLOT_SUBTRACT; ++sN) {
+
+		for (N = 0; N < 2; ++N) {
+
+			if (pl->data[dN].sub[sN].median[N] != NULL) {
+
+				free(pl->data[dN].sub[sN].median[N]);
+
+				pl->data[dN].sub[sN].median[N] = NULL;
+			}
+		}
+
+		if (pl->data[dN].sub[sN].expr != NULL) {
+
+			free(pl->data[dN].sub[sN].expr);
+
+			pl->data[dN].sub[sN].expr = NULL;
+		}
+	}
+}
+
 void plotDataSubtractClean(plot_t *pl)
 {
 	int		dN, N;
@@ -1892,6 +3055,8 @@ void plotDataSubtractClean(plot_t *pl)
 
 				pl->data[dN].sub[N].busy = SUBTRACT_FREE;
 			}
+
+			plotDataSubtractFree(pl, dN);
 		}
 	}
 }
@@ -1993,10 +3158,14 @@ void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 		plotDataChunkWrite(pl, dN, kN);
 	}
 
+	/* We insert rows sequentially so the pyramid is trimmed at the
+	 * first row inserted into the chunk or when we wrap around.
+	 * */
 	if (		   pl->rcache_wipe_data_N != dN
-			|| pl->rcache_wipe_chunk_N != kN) {
+			|| pl->rcache_wipe_chunk_N != kN
+			|| jN == 0) {
 
-		plotDataRangeCacheWipe(pl, dN, kN);
+		plotDataRangeCacheWipe(pl, dN, kN, jN);
 
 		pl->rcache_wipe_data_N = dN;
 		pl->rcache_wipe_chunk_N = kN;
@@ -2024,7 +3193,93 @@ void plotDataInsert(plot_t *pl, int dN, const fval_t *row)
 			pl->data[dN].sub_N = (sN == tN) ? hN : sN;
 		}
 
-		pl->data[dN].tail_N = tN;
+		pl->data[dN].tail_N = tN;
+	}
+}
+
+void plotDataMapped(plot_t *pl, int dN, int cN, int lN, const void *raw, int fp_bSIZE)
+{
+	int		N;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	pl->data[dN].mapped.raw = raw;
+	pl->data[dN].mapped.fp_bSIZE = fp_bSIZE;
+	pl->data[dN].mapped.length = 0;
+
+	plotDataAlloc(pl, dN, cN, lN + 1);
+
+	if (		pl->data[dN].column_N != cN
+			|| pl->data[dN].lz4_compress == 0) {
+
+		pl->data[dN].mapped.raw = NULL;
+		return ;
+	}
+
+	/* Forget all chunks of previous content.
+	 * */
+	plotDataCacheClean(pl, dN);
+
+	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+
+		pl->data[dN].raw[N] = NULL;
+
+		if (pl->data[dN].compress[N].raw != NULL) {
+
+			free(pl->data[dN].compress[N].raw);
+
+			pl->data[dN].compress[N].raw = NULL;
+		}
+
+		pl->data[dN].compress[N].length = 0;
+	}
+
+
+	if (lN > pl->data[dN].length_N - 1) {
+
+		/* Dataset is limited by the number of chunks so we keep
+		 * the tail of file as the ring buffer would do.
+		 * */
+		N = lN - (pl->data[dN].length_N - 1);
+
+		pl->data[dN].mapped.raw = (const char *) raw + (size_t) N * cN * fp_bSIZE;
+		pl->data[dN].id_N = N;
+
+		lN = pl->data[dN].length_N - 1;
+	}
+
+	pl->data[dN].mapped.length = lN;
+	pl->data[dN].tail_N = lN;
+}
+
+void plotDataUnmap(plot_t *pl, int dN)
+{
+	int		N, kN;
+
+	if (pl->data[dN].mapped.raw != NULL) {
+
+		/* Chunks that were not modified are lost.
+		 * */
+		plotDataCacheSync(pl, dN);
+
+		for (N = 0; N < PLOT_CHUNK_CACHE_MAX; ++N) {
+
+			kN = pl->data[dN].cache[N].chunk_N;
+
+			if (		kN >= 0
+					&& pl->data[dN].cache[N].dirty == 0
+					&& pl->data[dN].compress[kN].raw == NULL) {
+
+				plotDataCacheDrop(pl, dN, N);
+			}
+		}
+
+		pl->data[dN].mapped.raw = NULL;
+		pl->data[dN].mapped.length = 0;
 	}
 }
 
@@ -2037,17 +3292,11 @@ void plotDataClean(plot_t *pl, int dN)
 		pl->data[dN].column_N = 0;
 		pl->data[dN].length_N = 0;
 
-		if (pl->data[dN].lz4_compress != 0) {
-
-			for (N = 0; N < PLOT_CHUNK_CACHE; ++N) {
-
-				if (pl->data[dN].cache[N].raw) {
+		plotDataSubtractFree(pl, dN);
 
-					free(pl->data[dN].cache[N].raw);
+		if (pl->data[dN].lz4_compress != 0) {
 
-					pl->data[dN].cache[N].raw = NULL;
-				}
-			}
+			plotDataCacheClean(pl, dN);
 
 			for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
 
@@ -2060,13 +3309,6 @@ void plotDataClean(plot_t *pl, int dN)
 					pl->data[dN].compress[N].raw = NULL;
 				}
 			}
-
-			if (pl->data[dN].lz4_reserved != NULL) {
-
-				free(pl->data[dN].lz4_reserved);
-
-				pl->data[dN].lz4_reserved = NULL;
-			}
 		}
 		else {
 			for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
@@ -2083,6 +3325,27 @@ void plotDataClean(plot_t *pl, int dN)
 		free(pl->data[dN].map - 1);
 
 		pl->data[dN].map = NULL;
+
+		pl->data[dN].mapped.raw = NULL;
+		pl->data[dN].mapped.length = 0;
+	}
+}
+
+static void
+plotDataRangeCacheLodFree(plot_t *pl, int xN)
+{
+	int		N;
+
+	for (N = 0; N < PLOT_CHUNK_MAX; ++N) {
+
+		if (pl->rcache[xN].chunk[N].lod != NULL) {
+
+			free(pl->rcache[xN].chunk[N].lod);
+
+			pl->rcache[xN].chunk[N].lod = NULL;
+		}
+
+		pl->rcache[xN].chunk[N].lod_N = 0;
 	}
 }
 
@@ -2111,8 +3374,12 @@ void plotDataRangeCacheClean(plot_t *pl, int dN)
 
 	for (N = 0; N < PLOT_RCACHE_SIZE; ++N) {
 
-		if (pl->rcache[N].data_N == dN)
+		if (pl->rcache[N].data_N == dN) {
+
 			pl->rcache[N].busy = 0;
+
+			plotDataRangeCacheLodFree(pl, N);
+		}
 	}
 }
 
@@ -2129,8 +3396,12 @@ void plotDataRangeCacheSubtractClean(plot_t *pl)
 			if (		dN >= 0 && dN < PLOT_DATASET_MAX
 					&& pl->data[dN].column_N != 0) {
 
-				if (pl->rcache[N].column_N >= pl->data[dN].column_N)
+				if (pl->rcache[N].column_N >= pl->data[dN].column_N) {
+
 					pl->rcache[N].busy = 0;
+
+					plotDataRangeCacheLodFree(pl, N);
+				}
 			}
 		}
 	}
@@ -2161,6 +3432,8 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 
 			pl->rcache[xN].chunk[N].computed = 0;
 		}
+
+		plotDataRangeCacheLodFree(pl, xN);
 	}
 
 	rN = pl->data[dN].head_N;
@@ -2271,28 +3544,432 @@ int plotDataRangeCacheFetch(plot_t *pl, int dN, int cN)
 	pl->rcache_wipe_data_N = -1;
 	pl->rcache_wipe_chunk_N = -1;
 
-	return xN;
-}
+	return xN;
+}
+
+static void
+plotDataRangeGet(plot_t *pl, int dN, int cN, double *pmin, double *pmax)
+{
+	int		xN;
+
+	xN = plotDataRangeCacheFetch(pl, dN, cN);
+
+	*pmin = (double) pl->rcache[xN].fmin;
+	*pmax = (double) pl->rcache[xN].fmax;
+}
+
+static int
+plotDataLodOffset(plot_t *pl, int dN, int lSHIFT)
+{
+	int		N, bN = 0;
+
+	for (N = PLOT_LOD_SHIFT; N < lSHIFT; N += PLOT_LOD_FANOUT) {
+
+		bN += 1UL << (pl->data[dN].chunk_SHIFT - N);
+	}
+
+	return bN;
+}
+
+static void
+plotDataLodFetch(plot_t *pl, int xN, int kN)
+{
+	const fval_t	*row;
+	lod_t		*lod, *up, *ch;
+
+	double		fval;
+	int		dN, cN, lN, eN, bN, jN, N, sN, sUP, rSIZE;
+
+	dN = pl->rcache[xN].data_N;
+	cN = pl->rcache[xN].column_N;
+
+	/* Pyramid covers the rows of chunk that are already inserted.
+	 * */
+	eN = pl->data[dN].length_N - (kN << pl->data[dN].chunk_SHIFT);
+	eN = (eN > (1 << pl->data[dN].chunk_SHIFT)) ? (1 << pl->data[dN].chunk_SHIFT) : eN;
+
+	if (kN == plotDataChunkN(pl, dN, pl->data[dN].tail_N)) {
+
+		eN = pl->data[dN].tail_N & pl->data[dN].chunk_MASK;
+	}
+
+	eN &= ~((1 << PLOT_LOD_SHIFT) - 1);
+	lN = pl->rcache[xN].chunk[kN].lod_N;
+
+	if (lN > eN) {
+
+		/* Tail has wrapped around the chunk.
+		 * */
+		lN = 0;
+	}
+
+	if (lN >= eN)
+		return ;
+
+	lod = pl->rcache[xN].chunk[kN].lod;
+
+	if (lod == NULL) {
+
+		N = plotDataLodOffset(pl, dN, pl->data[dN].chunk_SHIFT + 1);
+		lod = (lod_t *) malloc(sizeof(lod_t) * N);
+
+		if (lod == NULL) {
+
+			ERROR("No memory allocated for LOD of %i dataset\n", dN);
+			return ;
+		}
+
+		pl->rcache[xN].chunk[kN].lod = lod;
+	}
+
+	if (pl->data[dN].lz4_compress != 0) {
+
+		plotDataChunkFetch(pl, dN, kN);
+	}
+
+	row = pl->data[dN].raw[kN];
+
+	if (row == NULL)
+		return ;
+
+	rSIZE = pl->data[dN].column_N + PLOT_SUBTRACT;
+
+	for (bN = lN >> PLOT_LOD_SHIFT; bN < eN >> PLOT_LOD_SHIFT; ++bN) {
+
+		jN = bN << PLOT_LOD_SHIFT;
+
+		lod[bN].finite = 1;
+
+		for (N = 0; N < (1 << PLOT_LOD_SHIFT); ++N) {
+
+			fval = row[(jN + N) * rSIZE + cN];
+
+			if (fp_isfinite(fval) == 0) {
+
+				lod[bN].finite = 0;
+				break;
+			}
+
+			if (N != 0) {
+
+				lod[bN].fmin = (fval < lod[bN].fmin) ? fval : lod[bN].fmin;
+				lod[bN].fmax = (fval > lod[bN].fmax) ? fval : lod[bN].fmax;
+			}
+			else {
+				lod[bN].fmin = fval;
+				lod[bN].fmax = fval;
+				lod[bN].first = fval;
+			}
+
+			lod[bN].last = fval;
+		}
+	}
+
+	/* Each upper level is merged from the children.
+	 * */
+	sN = PLOT_LOD_SHIFT;
+	sUP = PLOT_LOD_SHIFT + PLOT_LOD_FANOUT;
+
+	while (sUP <= pl->data[dN].chunk_SHIFT) {
+
+		up = lod + (1UL << (pl->data[dN].chunk_SHIFT - sN));
+
+		for (bN = lN >> sUP; bN < eN >> sUP; ++bN) {
+
+			ch = lod + (bN << PLOT_LOD_FANOUT);
+			up[bN] = ch[0];
+
+			for (N = 1; N < (1 << PLOT_LOD_FANOUT); ++N) {
+
+				up[bN].finite = (ch[N].finite != 0) ? up[bN].finite : 0;
+
+				if (up[bN].finite == 0)
+					break;
+
+				up[bN].fmin = (ch[N].fmin < up[bN].fmin) ? ch[N].fmin : up[bN].fmin;
+				up[bN].fmax = (ch[N].fmax > up[bN].fmax) ? ch[N].fmax : up[bN].fmax;
+				up[bN].last = ch[N].last;
+			}
+		}
+
+		lod = up;
+
+		sN = sUP;
+		sUP += PLOT_LOD_FANOUT;
+	}
+
+	pl->rcache[xN].chunk[kN].lod_N = eN;
+}
+
+static const lod_t *
+plotDataLodGet(plot_t *pl, int xN, int kN, int jN, int lSHIFT)
+{
+	const lod_t	*lod;
+	int		dN, bN;
+
+	dN = pl->rcache[xN].data_N;
+
+	if (pl->rcache[xN].chunk[kN].lod_N < jN + (1 << lSHIFT)) {
+
+		plotDataLodFetch(pl, xN, kN);
+
+		if (pl->rcache[xN].chunk[kN].lod_N < jN + (1 << lSHIFT))
+			return NULL;
+	}
+
+	bN = plotDataLodOffset(pl, dN, lSHIFT) + (jN >> lSHIFT);
+	lod = pl->rcache[xN].chunk[kN].lod + bN;
+
+	return (lod->finite != 0) ? lod : NULL;
+}
+
+static int
+plotDataLodPick(plot_t *pl, int dN, int xNR, int yNR, int rN, double scale_X,
+		const lod_t **xlod, const lod_t **ylod)
+{
+	double		span;
+	int		kN, jN, lSHIFT;
+
+	jN = rN & pl->data[dN].chunk_MASK;
+
+	if ((jN & ((1 << PLOT_LOD_SHIFT) - 1)) != 0)
+		return 0;
+
+	kN = plotDataChunkN(pl, dN, rN);
+
+	lSHIFT = PLOT_LOD_SHIFT;
+
+	while (		lSHIFT + PLOT_LOD_FANOUT <= pl->data[dN].chunk_SHIFT
+			&& (jN & ((1 << (lSHIFT + PLOT_LOD_FANOUT)) - 1)) == 0) {
+
+		lSHIFT += PLOT_LOD_FANOUT;
+	}
+
+	scale_X = (scale_X < 0.) ? - scale_X : scale_X;
+
+	/* Look for the largest bucket that fits into one pixel column.
+	 * */
+	do {
+		*ylod = plotDataLodGet(pl, yNR, kN, jN, lSHIFT);
+		*xlod = (xNR >= 0) ? plotDataLodGet(pl, xNR, kN, jN, lSHIFT) : NULL;
+
+		if (*ylod != NULL && (xNR < 0 || *xlod != NULL)) {
+
+			span = (xNR >= 0) ? ((*xlod)->fmax - (*xlod)->fmin) * scale_X
+				: (double) ((1 << lSHIFT) - 1) * scale_X;
+
+			if (span < 1.)
+				return lSHIFT;
+		}
+
+		lSHIFT -= PLOT_LOD_FANOUT;
+	}
+	while (lSHIFT >= PLOT_LOD_SHIFT);
+
+	return 0;
+}
+
+static int
+plotDataChunkEnd(plot_t *pl, int dN, int rN)
+{
+	int		kN, jN, jEND;
+
+	kN = plotDataChunkN(pl, dN, rN);
+	jN = rN & pl->data[dN].chunk_MASK;
+
+	jEND = pl->data[dN].length_N - (kN << pl->data[dN].chunk_SHIFT);
+	jEND = (jEND > (1 << pl->data[dN].chunk_SHIFT))
+		? (1 << pl->data[dN].chunk_SHIFT) : jEND;
+
+	if (		kN == plotDataChunkN(pl, dN, pl->data[dN].tail_N)
+			&& (pl->data[dN].tail_N & pl->data[dN].chunk_MASK) > jN) {
+
+		jEND = pl->data[dN].tail_N & pl->data[dN].chunk_MASK;
+	}
+
+	return jEND;
+}
+
+static int
+plotDataLodTop(plot_t *pl, int dN, int jN, int jEND)
+{
+	int		lSHIFT;
+
+	if ((jN & ((1 << PLOT_LOD_SHIFT) - 1)) != 0)
+		return 0;
+
+	lSHIFT = PLOT_LOD_SHIFT;
+
+	while (		lSHIFT + PLOT_LOD_FANOUT <= pl->data[dN].chunk_SHIFT
+			&& (jN & ((1 << (lSHIFT + PLOT_LOD_FANOUT)) - 1)) == 0) {
+
+		lSHIFT += PLOT_LOD_FANOUT;
+	}
+
+	while (lSHIFT >= PLOT_LOD_SHIFT && jN + (1 << lSHIFT) > jEND) {
+
+		lSHIFT -= PLOT_LOD_FANOUT;
+	}
+
+	return (lSHIFT >= PLOT_LOD_SHIFT) ? lSHIFT : 0;
+}
+
+static void
+plotDataRangeCondChunk(plot_t *pl, int dN, int kN, int jN, int jEND, int id_N,
+		int xN, int yN, double scale, double offset,
+		int *pflag, double *pmin, double *pmax)
+{
+	const fval_t	*row;
+	const lod_t	*xlod, *ylod;
+
+	double		fval, fcond, fmin, fmax, vmin, vmax;
+	int		cN, cN_cond, lSHIFT, rSIZE, job, started;
+
+	started = *pflag;
+	fmin = *pmin;
+	fmax = *pmax;
+
+	cN = pl->rcache[yN].column_N;
+	cN_cond = pl->rcache[xN].column_N;
+
+	rSIZE = pl->data[dN].column_N + PLOT_SUBTRACT;
+
+	while (jN < jEND) {
+
+		lSHIFT = plotDataLodTop(pl, dN, jN, jEND);
+		job = 1;
+
+		/* Descend the pyramid until the bucket is entirely inside or
+		 * outside of the condition range.
+		 * */
+		while (lSHIFT >= PLOT_LOD_SHIFT && job != 0) {
+
+			if (cN_cond >= 0) {
+
+				xlod = plotDataLodGet(pl, xN, kN, jN, lSHIFT);
+
+				if (xlod == NULL) {
+
+					lSHIFT -= PLOT_LOD_FANOUT;
+					continue;
+				}
+
+				vmin = xlod->fmin * scale + offset;
+				vmax = xlod->fmax * scale + offset;
+			}
+			else {
+				vmin = (double) id_N * scale + offset;
+				vmax = (double) (id_N + (1 << lSHIFT) - 1) * scale + offset;
+			}
+
+			if (vmin > vmax) {
+
+				fval = vmin;
+				vmin = vmax;
+				vmax = fval;
+			}
+
+			if (vmin > 1. || vmax < 0.) {
+
+				job = 0;
+			}
+			else if (vmin >= 0. && vmax <= 1.) {
+
+				if (cN >= 0) {
+
+					ylod = plotDataLodGet(pl, yN, kN, jN, lSHIFT);
+
+					if (ylod == NULL) {
+
+						lSHIFT -= PLOT_LOD_FANOUT;
+						continue;
+					}
+
+					vmin = ylod->fmin;
+					vmax = ylod->fmax;
+				}
+				else {
+					vmin = (double) id_N;
+					vmax = (double) (id_N + (1 << lSHIFT) - 1);
+				}
+
+				if (started != 0) {
+
+					fmin = (vmin < fmin) ? vmin : fmin;
+					fmax = (vmax > fmax) ? vmax : fmax;
+				}
+				else {
+					started = 1;
+
+					fmin = vmin;
+					fmax = vmax;
+				}
+
+				job = 0;
+			}
+			else {
+				lSHIFT -= PLOT_LOD_FANOUT;
+			}
+		}
+
+		if (job == 0) {
+
+			jN += 1 << lSHIFT;
+			id_N += 1 << lSHIFT;
+
+			continue;
+		}
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataChunkFetch(pl, dN, kN);
+		}
+
+		row = pl->data[dN].raw[kN];
+
+		if (row == NULL)
+			break;
+
+		row += rSIZE * jN;
+
+		fval = (cN < 0) ? id_N : row[cN];
+		fcond = (cN_cond < 0) ? id_N : row[cN_cond];
+
+		fcond = fcond * scale + offset;
+
+		if (fcond >= 0. && fcond <= 1.) {
+
+			if (fp_isfinite(fval)) {
+
+				if (started != 0) {
+
+					fmin = (fval < fmin) ? fval : fmin;
+					fmax = (fval > fmax) ? fval : fmax;
+				}
+				else {
+					started = 1;
 
-static void
-plotDataRangeGet(plot_t *pl, int dN, int cN, double *pmin, double *pmax)
-{
-	int		xN;
+					fmin = fval;
+					fmax = fval;
+				}
+			}
+		}
 
-	xN = plotDataRangeCacheFetch(pl, dN, cN);
+		jN++;
+		id_N++;
+	}
 
-	*pmin = (double) pl->rcache[xN].fmin;
-	*pmax = (double) pl->rcache[xN].fmax;
+	*pflag = started;
+	*pmin = fmin;
+	*pmax = fmax;
 }
 
 static void
 plotDataRangeCond(plot_t *pl, int dN, int cN, int cN_cond, int *pflag,
 		double scale, double offset, double *pmin, double *pmax)
 {
-	const fval_t	*row;
-
-	double		fval, fmin, fmax, fcond, vmin, vmax;
-	int		xN, yN, kN, rN, id_N, job, started;
+	double		fmin, fmax, vmin, vmax;
+	int		xN, yN, kN, rN, jN, jEND, id_N, job, started;
 
 	started = *pflag;
 	fmin = *pmin;
@@ -2382,41 +4059,16 @@ plotDataRangeCond(plot_t *pl, int dN, int cN, int cN_cond, int *pflag,
 
 		if (job != 0) {
 
-			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
-					break;
-
-				row = plotDataGet(pl, dN, &rN);
-
-				if (row == NULL)
-					break;
-
-				fval = (cN < 0) ? id_N : row[cN];
-				fcond = (cN_cond < 0) ? id_N : row[cN_cond];
-
-				fcond = fcond * scale + offset;
-
-				if (fcond >= 0. && fcond <= 1.) {
-
-					if (fp_isfinite(fval)) {
-
-						if (started != 0) {
-
-							fmin = (fval < fmin) ? fval : fmin;
-							fmax = (fval > fmax) ? fval : fmax;
-						}
-						else {
-							started = 1;
+			/* Partially visible chunk is resolved by the pyramid
+			 * so only boundary buckets are scanned by rows.
+			 * */
+			jN = rN & pl->data[dN].chunk_MASK;
+			jEND = plotDataChunkEnd(pl, dN, rN);
 
-							fmin = fval;
-							fmax = fval;
-						}
-					}
-				}
+			plotDataRangeCondChunk(pl, dN, kN, jN, jEND, id_N, xN, yN,
+					scale, offset, &started, &fmin, &fmax);
 
-				id_N++;
-			}
-			while (1);
+			plotDataSkip(pl, dN, &rN, &id_N, jEND - jN);
 		}
 		else {
 			plotDataChunkSkip(pl, dN, &rN, &id_N);
@@ -2511,13 +4163,134 @@ plotDataRangeAxis(plot_t *pl, int dN, int cN, int aN, double *pmin, double *pmax
 	return started;
 }
 
+static void
+plotDataSliceChunk(plot_t *pl, int dN, int kN, int jN, int jEND, int id_N,
+		int xN, double fdot, int *pflag, double *pbest, int *pbest_N)
+{
+	const fval_t	*row;
+	const lod_t	*lod;
+
+	double		fval, fmin, fmax, fbest;
+	int		cN, lSHIFT, rSIZE, job, started, best_N, N;
+
+	started = *pflag;
+	fbest = *pbest;
+	best_N = *pbest_N;
+
+	cN = pl->rcache[xN].column_N;
+
+	rSIZE = pl->data[dN].column_N + PLOT_SUBTRACT;
+
+	while (jN < jEND) {
+
+		lSHIFT = plotDataLodTop(pl, dN, jN, jEND);
+		job = 1;
+
+		/* Skip the buckets that cannot be closer than the best row
+		 * found so far, that is a binary search on monotonic column.
+		 * */
+		while (lSHIFT >= PLOT_LOD_SHIFT) {
+
+			if (cN >= 0) {
+
+				lod = plotDataLodGet(pl, xN, kN, jN, lSHIFT);
+
+				if (lod == NULL) {
+
+					lSHIFT -= PLOT_LOD_FANOUT;
+					continue;
+				}
+
+				fmin = lod->fmin;
+				fmax = lod->fmax;
+			}
+			else {
+				fmin = (double) id_N;
+				fmax = (double) (id_N + (1 << lSHIFT) - 1);
+			}
+
+			fval = (fdot < fmin) ? fmin - fdot
+				: (fdot > fmax) ? fdot - fmax : 0.;
+
+			if (started != 0 && fval >= fbest) {
+
+				job = 0;
+				break;
+			}
+
+			if (lSHIFT == PLOT_LOD_SHIFT)
+				break;
+
+			lSHIFT -= PLOT_LOD_FANOUT;
+		}
+
+		N = (lSHIFT >= PLOT_LOD_SHIFT) ? 1 << lSHIFT : 1;
+
+		if (job == 0) {
+
+			jN += N;
+			id_N += N;
+
+			continue;
+		}
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataChunkFetch(pl, dN, kN);
+		}
+
+		row = pl->data[dN].raw[kN];
+
+		if (row == NULL)
+			break;
+
+		row += rSIZE * jN;
+
+		do {
+			fval = (cN < 0) ? id_N : row[cN];
+
+			if (fp_isfinite(fval)) {
+
+				fval = fabs(fdot - fval);
+
+				if (started != 0) {
+
+					if (fval < fbest) {
+
+						fbest = fval;
+						best_N = id_N;
+					}
+				}
+				else {
+					started = 1;
+
+					fbest = fval;
+					best_N = id_N;
+				}
+			}
+
+			row += rSIZE;
+
+			jN++;
+			id_N++;
+
+			N--;
+		}
+		while (N > 0);
+	}
+
+	*pflag = started;
+	*pbest = fbest;
+	*pbest_N = best_N;
+}
+
 static const fval_t *
 plotDataSliceGet(plot_t *pl, int dN, int cN, double fdot, int *m_id_N)
 {
 	const fval_t	*row;
 
-	double		fval, fbest, fmin, fmax, fneard;
-	int		xN, lN, rN, id_N, kN, kN_rep, best_N;
+	double		fbest, fmin, fmax, fneard;
+	int		xN, lN, rN, id_N, kN, kN_rep, best_N, jEND;
 	int		job, started, span;
 
 	xN = plotDataRangeCacheFetch(pl, dN, cN);
@@ -2579,40 +4352,12 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fdot, int *m_id_N)
 
 			span++;
 
-			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
-					break;
-
-				row = plotDataGet(pl, dN, &rN);
-
-				if (row == NULL)
-					break;
-
-				fval = (cN < 0) ? id_N : row[cN];
-
-				if (fp_isfinite(fval)) {
-
-					fval = fabs(fdot - fval);
-
-					if (started != 0) {
-
-						if (fval < fbest) {
-
-							fbest = fval;
-							best_N = id_N;
-						}
-					}
-					else {
-						started = 1;
+			jEND = plotDataChunkEnd(pl, dN, rN);
 
-						fbest = fval;
-						best_N = id_N;
-					}
-				}
+			plotDataSliceChunk(pl, dN, kN, rN & pl->data[dN].chunk_MASK, jEND,
+					id_N, xN, fdot, &started, &fbest, &best_N);
 
-				id_N++;
-			}
-			while (1);
+			plotDataSkip(pl, dN, &rN, &id_N, jEND - (rN & pl->data[dN].chunk_MASK));
 
 			if (span >= PLOT_SLICE_SPAN)
 				break;
@@ -2638,67 +4383,196 @@ plotDataSliceGet(plot_t *pl, int dN, int cN, double fdot, int *m_id_N)
 
 			if (kN == kN_rep) {
 
-				do {
-					if (kN != plotDataChunkN(pl, dN, rN))
-						break;
+				jEND = plotDataChunkEnd(pl, dN, rN);
 
-					row = plotDataGet(pl, dN, &rN);
+				plotDataSliceChunk(pl, dN, kN, rN & pl->data[dN].chunk_MASK, jEND,
+						id_N, xN, fdot, &started, &fbest, &best_N);
 
-					if (row == NULL)
-						break;
+				plotDataSkip(pl, dN, &rN, &id_N, jEND - (rN & pl->data[dN].chunk_MASK));
+			}
+			else {
+				plotDataChunkSkip(pl, dN, &rN, &id_N);
+			}
 
-					fval = (cN < 0) ? id_N : row[cN];
+			if (rN == pl->data[dN].tail_N)
+				break;
+		}
+		while (1);
+	}
 
-					if (fp_isfinite(fval)) {
+	if (started != 0) {
 
-						fval = fabs(fdot - fval);
+		*m_id_N = best_N;
 
-						if (started != 0) {
+		lN = pl->data[dN].length_N;
 
-							if (fval < fbest) {
+		rN = pl->data[dN].head_N + (best_N - pl->data[dN].id_N);
+		rN = (rN > lN - 1) ? rN - lN : rN;
 
-								fbest = fval;
-								best_N = id_N;
-							}
-						}
-						else {
-							started = 1;
+		row = plotDataGet(pl, dN, &rN);
+	}
+	else {
+		row = NULL;
+	}
 
-							fbest = fval;
-							best_N = id_N;
-						}
-					}
+	return row;
+}
 
-					id_N++;
-				}
-				while (1);
+static double
+plotDataLodDist(const lod_t *lod, int id_N, int lSHIFT, double fdot)
+{
+	double		fmin, fmax;
+
+	if (lod != NULL) {
+
+		fmin = lod->fmin;
+		fmax = lod->fmax;
+	}
+	else {
+		fmin = (double) id_N;
+		fmax = (double) (id_N + (1 << lSHIFT) - 1);
+	}
+
+	return (fdot < fmin) ? fmin - fdot
+		: (fdot > fmax) ? fdot - fmax : 0.;
+}
+
+static void
+plotDataPickChunk(plot_t *pl, int dN, int kN, int jN, int jEND, int id_N,
+		int xNX, int xNY, double fdot_X, double fdot_Y,
+		double tol_X, double tol_Y, int *pflag, double *pbest, int *pbest_N)
+{
+	const fval_t	*row;
+	const lod_t	*xlod, *ylod;
+
+	double		fval_X, fval_Y, fbest;
+	int		cNX, cNY, lSHIFT, rSIZE, job, started, best_N, N;
+
+	started = *pflag;
+	fbest = *pbest;
+	best_N = *pbest_N;
+
+	cNX = pl->rcache[xNX].column_N;
+	cNY = pl->rcache[xNY].column_N;
+
+	rSIZE = pl->data[dN].column_N + PLOT_SUBTRACT;
+
+	while (jN < jEND) {
+
+		lSHIFT = plotDataLodTop(pl, dN, jN, jEND);
+		job = 1;
+
+		/* Bounding boxes of the pyramid buckets are used as the
+		 * spatial index to skip the rows far from the cursor.
+		 * */
+		while (lSHIFT >= PLOT_LOD_SHIFT) {
+
+			xlod = (cNX >= 0) ? plotDataLodGet(pl, xNX, kN, jN, lSHIFT) : NULL;
+			ylod = (cNY >= 0) ? plotDataLodGet(pl, xNY, kN, jN, lSHIFT) : NULL;
+
+			if (		(cNX >= 0 && xlod == NULL)
+					|| (cNY >= 0 && ylod == NULL)) {
+
+				lSHIFT -= PLOT_LOD_FANOUT;
+				continue;
 			}
-			else {
-				plotDataChunkSkip(pl, dN, &rN, &id_N);
+
+			fval_X = plotDataLodDist(xlod, id_N, lSHIFT, fdot_X);
+			fval_Y = plotDataLodDist(ylod, id_N, lSHIFT, fdot_Y);
+
+			if (fval_X >= tol_X || fval_Y >= tol_Y) {
+
+				job = 0;
+				break;
 			}
 
-			if (rN == pl->data[dN].tail_N)
+			fval_X /= tol_X;
+			fval_Y /= tol_Y;
+
+			if (		started != 0
+					&& fval_X * fval_X + fval_Y * fval_Y >= fbest) {
+
+				job = 0;
+				break;
+			}
+
+			if (lSHIFT == PLOT_LOD_SHIFT)
 				break;
+
+			lSHIFT -= PLOT_LOD_FANOUT;
 		}
-		while (1);
-	}
 
-	if (started != 0) {
+		N = (lSHIFT >= PLOT_LOD_SHIFT) ? 1 << lSHIFT : 1;
+
+		if (job == 0) {
+
+			jN += N;
+			id_N += N;
+
+			continue;
+		}
+
+		if (pl->data[dN].lz4_compress != 0) {
+
+			plotDataChunkFetch(pl, dN, kN);
+		}
+
+		row = pl->data[dN].raw[kN];
+
+		if (row == NULL)
+			break;
+
+		row += rSIZE * jN;
+
+		do {
+			fval_X = (cNX < 0) ? id_N : row[cNX];
+			fval_Y = (cNY < 0) ? id_N : row[cNY];
+
+			if (		   fp_isfinite(fval_X)
+					&& fp_isfinite(fval_Y)) {
+
+				fval_X = fabs(fdot_X - fval_X);
+				fval_Y = fabs(fdot_Y - fval_Y);
+
+				if (		   fval_X < tol_X
+						&& fval_Y < tol_Y) {
+
+					fval_X /= tol_X;
+					fval_Y /= tol_Y;
+
+					fval_X =  fval_X * fval_X
+						+ fval_Y * fval_Y;
+
+					if (started != 0) {
+
+						if (fval_X < fbest) {
 
-		*m_id_N = best_N;
+							fbest = fval_X;
+							best_N = id_N;
+						}
+					}
+					else {
+						started = 1;
 
-		lN = pl->data[dN].length_N;
+						fbest = fval_X;
+						best_N = id_N;
+					}
+				}
+			}
 
-		rN = pl->data[dN].head_N + (best_N - pl->data[dN].id_N);
-		rN = (rN > lN - 1) ? rN - lN : rN;
+			row += rSIZE;
 
-		row = plotDataGet(pl, dN, &rN);
-	}
-	else {
-		row = NULL;
+			jN++;
+			id_N++;
+
+			N--;
+		}
+		while (N > 0);
 	}
 
-	return row;
+	*pflag = started;
+	*pbest = fbest;
+	*pbest_N = best_N;
 }
 
 static const fval_t *
@@ -2708,8 +4582,8 @@ plotDataPickGet(plot_t *pl, int dN, int cNX, int cNY,
 {
 	const fval_t	*row;
 
-	double		fval_X, fval_Y, fbest, fmin, fmax;
-	int		xNX, xNY, lN, rN, id_N, kN, best_N;
+	double		fbest, fmin, fmax;
+	int		xNX, xNY, lN, rN, id_N, kN, best_N, jEND;
 	int		job, started, span;
 
 	xNX = plotDataRangeCacheFetch(pl, dN, cNX);
@@ -2765,53 +4639,13 @@ plotDataPickGet(plot_t *pl, int dN, int cNX, int cNY,
 
 			span++;
 
-			do {
-				if (kN != plotDataChunkN(pl, dN, rN))
-					break;
-
-				row = plotDataGet(pl, dN, &rN);
-
-				if (row == NULL)
-					break;
-
-				fval_X = (cNX < 0) ? id_N : row[cNX];
-				fval_Y = (cNY < 0) ? id_N : row[cNY];
-
-				if (		   fp_isfinite(fval_X)
-						&& fp_isfinite(fval_Y)) {
-
-					fval_X = fabs(fdot_X - fval_X);
-					fval_Y = fabs(fdot_Y - fval_Y);
-
-					if (		   fval_X < tol_X
-							&& fval_Y < tol_Y) {
-
-						fval_X /= tol_X;
-						fval_Y /= tol_Y;
-
-						fval_X =  fval_X * fval_X
-							+ fval_Y * fval_Y;
-
-						if (started != 0) {
-
-							if (fval_X < fbest) {
-
-								fbest = fval_X;
-								best_N = id_N;
-							}
-						}
-						else {
-							started = 1;
+			jEND = plotDataChunkEnd(pl, dN, rN);
 
-							fbest = fval_X;
-							best_N = id_N;
-						}
-					}
-				}
+			plotDataPickChunk(pl, dN, kN, rN & pl->data[dN].chunk_MASK, jEND,
+					id_N, xNX, xNY, fdot_X, fdot_Y, tol_X, tol_Y,
+					&started, &fbest, &best_N);
 
-				id_N++;
-			}
-			while (1);
+			plotDataSkip(pl, dN, &rN, &id_N, jEND - (rN & pl->data[dN].chunk_MASK));
 
 			if (span >= PLOT_SLICE_SPAN)
 				break;
@@ -4190,6 +6024,13 @@ plotCheckColumnLinked(plot_t *pl, int dN, int cN)
 				linked++;
 			}
 		}
+		else if (pl->data[dN].sub[sN].busy == SUBTRACT_EXPRESSION) {
+
+			if (pl->data[dN].sub[sN].expr != NULL) {
+
+				linked += exprLinked(pl->data[dN].sub[sN].expr, cN);
+			}
+		}
 	}
 
 	for (fN = 0; fN < PLOT_FIGURE_MAX; ++fN) {
@@ -5104,6 +6945,69 @@ int plotGetSubtractMedian(plot_t *pl, int dN, int cN, int opSUB, int length)
 	return cN;
 }
 
+int plotGetSubtractExpression(plot_t *pl, int dN, int cNX, int cNY, const char *text)
+{
+	expr_t		*ex;
+	int		sN, cN;
+
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return -1;
+	}
+
+	if (cNX < -1 || cNX >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cNX);
+		return -1;
+	}
+
+	if (cNY < -1 || cNY >= pl->data[dN].column_N + PLOT_SUBTRACT) {
+
+		ERROR("Column number %i is out of range\n", cNY);
+		return -1;
+	}
+
+	sN = plotGetFreeSubtract(pl, dN);
+
+	if (sN < 0) {
+
+		ERROR("Unable to get free subtract\n");
+		return -1;
+	}
+
+	ex = pl->data[dN].sub[sN].expr;
+
+	if (ex == NULL) {
+
+		ex = (expr_t *) malloc(sizeof(expr_t));
+
+		if (ex == NULL) {
+
+			ERROR("No memory allocated for expression\n");
+			return -1;
+		}
+
+		pl->data[dN].sub[sN].expr = ex;
+	}
+
+	if (exprParse(ex, text, cNX, cNY, pl->data[dN].column_N + PLOT_SUBTRACT) != 0) {
+
+		ERROR("Syntax error in expression \"%.80s\" at %i\n", text, ex->error);
+		return -1;
+	}
+
+	pl->data[dN].sub[sN].busy = SUBTRACT_EXPRESSION;
+	pl->data[dN].sub[sN].op.expr.column_X = cNX;
+	pl->data[dN].sub[sN].op.expr.column_Y = cNY;
+
+	plotDataSubtractCompute(pl, dN, sN);
+
+	cN = sN + pl->data[dN].column_N;
+
+	return cN;
+}
+
 int plotGetFreeFigure(plot_t *pl)
 {
 	int		N, fN = -1;
@@ -5457,6 +7361,69 @@ void plotFigureSubtractFilter(plot_t *pl, int fN, int opSUB, double value)
 	}
 }
 
+void plotFigureSubtractExpression(plot_t *pl, int fN, const char *text)
+{
+	int		fN_exp, dN, cNX, cNY, aN;
+
+	if (fN < 0 || fN >= PLOT_FIGURE_MAX) {
+
+		ERROR("Figure number is out of range\n");
+		return ;
+	}
+
+	dN = pl->figure[fN].data_N;
+	cNX = pl->figure[fN].column_X;
+	cNY = pl->figure[fN].column_Y;
+
+	fN_exp = plotGetFreeFigure(pl);
+
+	if (fN_exp < 0) {
+
+		ERROR("Unable to get free figure to subtract\n");
+		return ;
+	}
+
+	cNY = plotGetSubtractExpression(pl, dN, cNX, cNY, text);
+
+	if (cNY < 0) {
+
+		return ;
+	}
+
+	aN = plotGetFreeAxis(pl);
+
+	if (aN != -1) {
+
+		pl->axis[aN].busy = AXIS_BUSY_Y;
+		plotAxisLabel(pl, aN, pl->axis[pl->figure[fN].axis_Y].label);
+	}
+	else {
+		aN = pl->figure[fN].axis_Y;
+	}
+
+	plotFigureAdd(pl, fN_exp, dN, cNX, cNY, pl->figure[fN].axis_X, aN, "");
+
+	sprintf(pl->figure[fN_exp].label, "Q: %.75s", text);
+
+	pl->figure[fN_exp].drawing = pl->figure[fN].drawing;
+	pl->figure[fN_exp].width = pl->figure[fN].width;
+
+	plotAxisScaleAutoCond(pl, pl->figure[fN_exp].axis_Y, pl->figure[fN_exp].axis_X);
+
+	pl->on_X = pl->figure[fN_exp].axis_X;
+	pl->on_Y = pl->figure[fN_exp].axis_Y;
+
+	if (pl->axis[pl->on_X].slave != 0) {
+
+		pl->on_X = pl->axis[pl->on_X].slave_N;
+	}
+
+	if (pl->axis[pl->on_Y].slave != 0) {
+
+		pl->on_Y = pl->axis[pl->on_Y].slave_N;
+	}
+}
+
 void plotFigureSubtractDemux(plot_t *pl, int fN, int opSUB, int N)
 {
 	int		dN, cN, cN1, sN, fN_dem;
@@ -5961,60 +7928,174 @@ void plotFigureSubtractPolyfit(plot_t *pl, int fN, int N0, int N1)
 		return ;
 	}
 
-	aN = pl->figure[fN].axis_X;
+	aN = pl->figure[fN].axis_X;
+
+	scale_X = pl->axis[aN].scale;
+	offset_X = pl->axis[aN].offset;
+
+	if (pl->axis[aN].slave != 0) {
+
+		bN = pl->axis[aN].slave_N;
+		scale_X *= pl->axis[bN].scale;
+		offset_X = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+	}
+
+	aN = pl->figure[fN].axis_Y;
+
+	scale_Y = pl->axis[aN].scale;
+	offset_Y = pl->axis[aN].offset;
+
+	if (pl->axis[aN].slave != 0) {
+
+		bN = pl->axis[aN].slave_N;
+		scale_Y *= pl->axis[bN].scale;
+		offset_Y = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+	}
+
+	plotDataPolyfit(pl, dN, pl->figure[fN].column_X, pl->figure[fN].column_Y,
+			scale_X, offset_X, scale_Y, offset_Y, N0, N1);
+
+	pl->data[dN].sub[sN].busy = SUBTRACT_POLYFIT;
+	pl->data[dN].sub[sN].op.polyfit.column_X = pl->figure[fN].column_X;
+	pl->data[dN].sub[sN].op.polyfit.column_Y = pl->figure[fN].column_Y;
+	pl->data[dN].sub[sN].op.polyfit.poly_N0 = N0;
+	pl->data[dN].sub[sN].op.polyfit.poly_N1 = N1;
+
+	for (N = 0; N < N1 - N0 + 1; ++N) {
+
+		pl->data[dN].sub[sN].op.polyfit.coefs[N] = pl->lsq.sol.m[N];
+	}
+
+	pl->data[dN].sub[sN].op.polyfit.std = pl->lsq.std.m[0];
+
+	plotDataSubtractCompute(pl, dN, sN);
+
+	cN = sN + pl->data[dN].column_N;
+	aN = pl->figure[fN].axis_Y;
+
+	plotFigureAdd(pl, fN_pol, dN, pl->figure[fN].column_X, cN,
+			pl->figure[fN].axis_X, aN, "");
+
+	sprintf(pl->figure[fN_pol].label, "P: %.75s", pl->figure[fN].label);
+
+	pl->figure[fN_pol].drawing = pl->figure[fN].drawing;
+	pl->figure[fN_pol].width = pl->figure[fN].width;
+
+	plotDataBoxPolyfit(pl, fN_pol);
+}
+
+int plotFigureSpectrum(plot_t *pl, int fN, int dN_spe, int length)
+{
+	double		*power;
+	fval_t		row[3];
+
+	char		label[PLOT_STRING_MAX];
+
+	double		scale_X, offset_X, fs;
+	int		N, fN_spe, dN, aN, bN;
+
+	if (fN < 0 || fN >= PLOT_FIGURE_MAX) {
+
+		ERROR("Figure number is out of range\n");
+		return -1;
+	}
+
+	if (dN_spe < 0 || dN_spe >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return -1;
+	}
+
+	fN_spe = plotGetFreeFigure(pl);
+
+	if (fN_spe < 0) {
+
+		ERROR("Unable to get free figure to spectrum\n");
+		return -1;
+	}
+
+	power = (double *) malloc(((1 << PLOT_SPECTRUM_SHIFT) / 2 + 1) * sizeof(double));
+
+	if (power == NULL) {
+
+		ERROR("No memory allocated for spectrum\n");
+		return -1;
+	}
+
+	dN = pl->figure[fN].data_N;
+	aN = pl->figure[fN].axis_X;
+
+	scale_X = pl->axis[aN].scale;
+	offset_X = pl->axis[aN].offset;
+
+	if (pl->axis[aN].slave != 0) {
+
+		bN = pl->axis[aN].slave_N;
+		scale_X *= pl->axis[bN].scale;
+		offset_X = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+	}
+
+	length = plotDataSpectrum(pl, dN, pl->figure[fN].column_X,
+			pl->figure[fN].column_Y, scale_X, offset_X,
+			length, power, &fs);
+
+	if (length < 0) {
+
+		free(power);
+		return -1;
+	}
+
+	/* We keep the frequency, density and density in decibels.
+	 * */
+	plotDataAlloc(pl, dN_spe, 3, length / 2 + 2);
 
-	scale_X = pl->axis[aN].scale;
-	offset_X = pl->axis[aN].offset;
+	for (N = 0; N < length / 2 + 1; ++N) {
 
-	if (pl->axis[aN].slave != 0) {
+		row[0] = (fval_t) N * fs / (fval_t) length;
+		row[1] = (fval_t) power[N];
+		row[2] = (power[N] > 0.) ? (fval_t) (10. * log10(power[N])) : fp_nan();
 
-		bN = pl->axis[aN].slave_N;
-		scale_X *= pl->axis[bN].scale;
-		offset_X = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+		plotDataInsert(pl, dN_spe, row);
 	}
 
-	aN = pl->figure[fN].axis_Y;
+	free(power);
 
-	scale_Y = pl->axis[aN].scale;
-	offset_Y = pl->axis[aN].offset;
+	aN = plotGetFreeAxis(pl);
 
-	if (pl->axis[aN].slave != 0) {
+	if (aN == -1) {
 
-		bN = pl->axis[aN].slave_N;
-		scale_Y *= pl->axis[bN].scale;
-		offset_Y = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+		ERROR("Unable to get free axis on X\n");
+		return 0;
 	}
 
-	plotDataPolyfit(pl, dN, pl->figure[fN].column_X, pl->figure[fN].column_Y,
-			scale_X, offset_X, scale_Y, offset_Y, N0, N1);
+	pl->axis[aN].busy = AXIS_BUSY_X;
 
-	pl->data[dN].sub[sN].busy = SUBTRACT_POLYFIT;
-	pl->data[dN].sub[sN].op.polyfit.column_X = pl->figure[fN].column_X;
-	pl->data[dN].sub[sN].op.polyfit.column_Y = pl->figure[fN].column_Y;
-	pl->data[dN].sub[sN].op.polyfit.poly_N0 = N0;
-	pl->data[dN].sub[sN].op.polyfit.poly_N1 = N1;
+	bN = plotGetFreeAxis(pl);
 
-	for (N = 0; N < N1 - N0 + 1; ++N) {
+	if (bN == -1) {
 
-		pl->data[dN].sub[sN].op.polyfit.coefs[N] = pl->lsq.sol.m[N];
+		pl->axis[aN].busy = AXIS_FREE;
+
+		ERROR("Unable to get free axis on Y\n");
+		return 0;
 	}
 
-	pl->data[dN].sub[sN].op.polyfit.std = pl->lsq.std.m[0];
+	pl->axis[bN].busy = AXIS_BUSY_Y;
 
-	plotDataSubtractCompute(pl, dN, sN);
+	plotFigureAdd(pl, fN_spe, dN_spe, 0, 2, aN, bN, "");
 
-	cN = sN + pl->data[dN].column_N;
-	aN = pl->figure[fN].axis_Y;
+	sprintf(label, "S: %.75s", pl->figure[fN].label);
+	strcpy(pl->figure[fN_spe].label, label);
 
-	plotFigureAdd(pl, fN_pol, dN, pl->figure[fN].column_X, cN,
-			pl->figure[fN].axis_X, aN, "");
+	pl->figure[fN_spe].width = pl->figure[fN].width;
 
-	sprintf(pl->figure[fN_pol].label, "P: %.75s", pl->figure[fN].label);
+	plotAxisScaleAuto(pl, aN);
+	plotAxisScaleAuto(pl, bN);
 
-	pl->figure[fN_pol].drawing = pl->figure[fN].drawing;
-	pl->figure[fN_pol].width = pl->figure[fN].width;
+	pl->on_X = aN;
+	pl->on_Y = bN;
 
-	plotDataBoxPolyfit(pl, fN_pol);
+	return 0;
 }
 
 static void
@@ -7351,8 +9432,27 @@ plotSketchGarbage(plot_t *pl)
 	pl->sketch_list_current = -1;
 	pl->sketch_list_current_end = -1;
 
-	for (N = 0; N < PLOT_FIGURE_MAX; ++N)
+	for (N = 0; N < PLOT_FIGURE_MAX; ++N) {
+
 		pl->draw[N].list_self = -1;
+
+		if (		pl->figure[N].busy != 0
+				&& pl->figure[N].drawing == FIGURE_DRAWING_DENSITY) {
+
+			if (pl->draw[N].density[0].count != NULL) {
+
+				density_t	swap = pl->draw[N].density[1];
+
+				pl->draw[N].density[1] = pl->draw[N].density[0];
+				pl->draw[N].density[0] = swap;
+
+				pl->draw[N].density_ready = 1;
+			}
+		}
+		else {
+			plotDensityFree(pl, N);
+		}
+	}
 }
 
 void plotSketchClean(plot_t *pl)
@@ -7361,83 +9461,404 @@ void plotSketchClean(plot_t *pl)
 
 	hN = pl->sketch_list_todraw;
 
-	while (hN >= 0) {
+	while (hN >= 0) {
+
+		linked = pl->sketch[hN].linked;
+
+		pl->sketch[hN].linked = pl->sketch_list_garbage;
+		pl->sketch_list_garbage = hN;
+
+		hN = linked;
+	}
+
+	hN = pl->sketch_list_current;
+
+	while (hN >= 0) {
+
+		linked = pl->sketch[hN].linked;
+
+		pl->sketch[hN].linked = pl->sketch_list_garbage;
+		pl->sketch_list_garbage = hN;
+
+		hN = linked;
+	}
+
+	pl->sketch_list_todraw = -1;
+	pl->sketch_list_current = -1;
+	pl->sketch_list_current_end = -1;
+
+	for (N = 0; N < PLOT_FIGURE_MAX; ++N) {
+
+		pl->draw[N].list_self = -1;
+		pl->draw[N].density_ready = 0;
+	}
+
+	pl->draw_in_progress = 0;
+}
+
+static void
+plotDrawPalette(plot_t *pl)
+{
+	draw_t			*dw = pl->dw;
+	scheme_t		*sch = pl->sch;
+	Uint32			*palette;
+
+	palette = dw->palette;
+
+	palette[0] = drawRGBMap(dw, sch->plot_background);
+	palette[1] = drawRGBMap(dw, sch->plot_figure[0]);
+	palette[2] = drawRGBMap(dw, sch->plot_figure[1]);
+	palette[3] = drawRGBMap(dw, sch->plot_figure[2]);
+	palette[4] = drawRGBMap(dw, sch->plot_figure[3]);
+	palette[5] = drawRGBMap(dw, sch->plot_figure[4]);
+	palette[6] = drawRGBMap(dw, sch->plot_figure[5]);
+	palette[7] = drawRGBMap(dw, sch->plot_figure[6]);
+	palette[8] = drawRGBMap(dw, sch->plot_figure[7]);
+	palette[9] = drawRGBMap(dw, sch->plot_figure[8]);
+	palette[10] = drawRGBMap(dw, sch->plot_figure[9]);
+	palette[11] = drawRGBMap(dw, sch->plot_hidden);
+	palette[12] = drawRGBMap(dw, sch->plot_text);
+}
+
+static Uint32
+plotGetTick(plot_t *pl)
+{
+	if (pl->tick_skip++ >= 63) {
+
+		pl->tick_cached = SDL_GetTicks();
+		pl->tick_skip = 0;
+	}
+
+	return pl->tick_cached;
+}
+
+static void
+plotDensityReset(plot_t *pl, int fN, double scale_X, double offset_X,
+		double scale_Y, double offset_Y)
+{
+	density_t	*dn = &pl->draw[fN].density[0];
+
+	int		size_X, size_Y;
+
+	size_X = pl->viewport.max_x - pl->viewport.min_x + 1;
+	size_Y = pl->viewport.max_y - pl->viewport.min_y + 1;
+
+	if (		dn->count != NULL
+			&& (dn->size_X != size_X || dn->size_Y != size_Y)) {
+
+		free(dn->count);
+
+		dn->count = NULL;
+	}
+
+	if (dn->count == NULL) {
+
+		dn->count = (Uint32 *) malloc(size_X * size_Y * sizeof(Uint32));
+
+		if (dn->count == NULL) {
+
+			ERROR("Unable to allocate memory of %i density\n", fN);
+			return ;
+		}
+	}
+
+	memset(dn->count, 0, size_X * size_Y * sizeof(Uint32));
+
+	dn->count_max = 0;
+
+	dn->min_X = pl->viewport.min_x;
+	dn->min_Y = pl->viewport.min_y;
+	dn->size_X = size_X;
+	dn->size_Y = size_Y;
+
+	dn->scale_X = scale_X;
+	dn->offset_X = offset_X;
+	dn->scale_Y = scale_Y;
+	dn->offset_Y = offset_Y;
+}
+
+static void
+plotDensityRun(density_job_t *job)
+{
+	const fval_t	*row = job->raw;
+
+	double		X, Y;
+	int		N;
+
+	for (N = 0; N < job->length; ++N) {
+
+		X = (job->column_X < 0) ? job->id + N : row[job->column_X];
+		Y = (job->column_Y < 0) ? job->id + N : row[job->column_Y];
+
+		X = X * job->tf.scale_X + job->tf.offset_X - job->tf.min_X;
+		Y = Y * job->tf.scale_Y + job->tf.offset_Y - job->tf.min_Y;
+
+		if (fp_isfinite(X) && fp_isfinite(Y)) {
+
+			if (		   X >= 0. && X < (double) job->tf.size_X
+					&& Y >= 0. && Y < (double) job->tf.size_Y) {
+
+				job->pixel[job->pixel_N++] = (int) Y * job->tf.size_X + (int) X;
+			}
+		}
+
+		row += job->stride;
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+}
+
+static density_job_t *
+plotDensityAlloc(plot_t *pl, int fN, int length, int gather)
+{
+	density_job_t	*job;
+
+	int		bSIZE;
+
+	bSIZE = length * sizeof(int);
+	bSIZE += (gather != 0) ? length * 2 * sizeof(fval_t) + sizeof(fval_t) : 0;
+
+	job = (density_job_t *) malloc(sizeof(density_job_t) + bSIZE);
+
+	if (job == NULL) {
+
+		ERROR("No memory allocated for density job\n");
+		return NULL;
+	}
+
+	job->tf = pl->draw[fN].density[0];
+	job->length = length;
+	job->pixel_N = 0;
+
+	if (gather != 0) {
+
+		job->xy = (fval_t *) (((size_t) (job + 1) + sizeof(fval_t) - 1)
+				& ~(sizeof(fval_t) - 1));
+
+		job->pixel = (int *) (job->xy + length * 2);
+	}
+	else {
+		job->xy = NULL;
+		job->pixel = (int *) (job + 1);
+	}
+
+	SDL_AtomicSet(&job->done, 0);
+
+	return job;
+}
+
+static void
+plotDensityMerge(plot_t *pl, int fN, density_job_t *job)
+{
+	density_t	*dn = &pl->draw[fN].density[0];
+
+	Uint32		count_max, *count = dn->count;
+	int		N;
+
+	while (SDL_AtomicGet(&job->done) == 0) {
+
+		SDL_Delay(1);
+	}
+
+	count_max = dn->count_max;
+
+	for (N = 0; N < job->pixel_N; ++N) {
+
+		Uint32		n = ++count[job->pixel[N]];
+
+		count_max = (n > count_max) ? n : count_max;
+	}
+
+	dn->count_max = count_max;
+
+	free(job);
+}
+
+/* The function bins the rows into the density buffer chunk by chunk. Rows
+ * of each chunk are transformed to pixels on the worker thread and then we
+ * increment the counts in order. With compressed dataset the chunk memory
+ * belongs to the cache so we gather the columns before submit.
+ * */
+static void
+plotDrawDensityTrial(plot_t *pl, int fN, int xNR, int yNR, Uint32 tTOP)
+{
+	const density_t	*dn = &pl->draw[fN].density[0];
+	const fval_t	*row;
+
+	density_job_t	*queue[ASYNC_THREAD_MAX * 2], *job;
+
+	double		im_MIN, im_MAX;
+	int		N, dN, xN, yN, rN, rN_end, id_N, kN, lN;
+	int		skip, gather, queue_N, queue_MAX;
+
+	dN = pl->figure[fN].data_N;
+	xN = pl->figure[fN].column_X;
+	yN = pl->figure[fN].column_Y;
+
+	rN = pl->draw[fN].rN;
+	id_N = pl->draw[fN].id_N;
+
+	if (dn->count == NULL) {
+
+		pl->draw[fN].sketch = SKETCH_FINISHED;
+		return ;
+	}
+
+	plotPoolOpen(pl);
+
+	queue_MAX = (pl->pool != NULL) ? pl->pool->thread_N * 2 : 1;
+	queue_MAX = (queue_MAX < 1) ? 1 : queue_MAX;
+	queue_N = 0;
+
+	gather = (pl->data[dN].lz4_compress != 0) ? 1 : 0;
+
+	pl->draw[fN].sketch = SKETCH_INTERRUPTED;
+
+	do {
+		if (rN == pl->data[dN].tail_N) {
+
+			pl->draw[fN].sketch = SKETCH_FINISHED;
+			break;
+		}
+
+		kN = plotDataChunkN(pl, dN, rN);
+		skip = 0;
+
+		if (xNR >= 0 && pl->rcache[xNR].chunk[kN].computed != 0) {
+
+			if (pl->rcache[xNR].chunk[kN].finite != 0) {
+
+				im_MIN = pl->rcache[xNR].chunk[kN].fmin * dn->scale_X + dn->offset_X;
+				im_MAX = pl->rcache[xNR].chunk[kN].fmax * dn->scale_X + dn->offset_X;
+
+				skip = (   im_MAX < pl->viewport.min_x
+					|| im_MIN > pl->viewport.max_x + 1) ? 1 : skip;
+			}
+			else {
+				skip = 1;
+			}
+		}
+
+		if (yNR >= 0 && pl->rcache[yNR].chunk[kN].computed != 0) {
+
+			if (pl->rcache[yNR].chunk[kN].finite != 0) {
+
+				im_MIN = pl->rcache[yNR].chunk[kN].fmin * dn->scale_Y + dn->offset_Y;
+				im_MAX = pl->rcache[yNR].chunk[kN].fmax * dn->scale_Y + dn->offset_Y;
+
+				skip = (   im_MIN > pl->viewport.max_y + 1
+					|| im_MAX < pl->viewport.min_y) ? 1 : skip;
+			}
+			else {
+				skip = 1;
+			}
+		}
+
+		if (skip != 0) {
+
+			plotDataChunkSkip(pl, dN, &rN, &id_N);
+		}
+		else {
+			/* Rows up to the end of chunk or the tail are placed
+			 * in memory in a row.
+			 * */
+			rN_end = (kN + 1) << pl->data[dN].chunk_SHIFT;
+			rN_end = (rN_end > pl->data[dN].length_N) ? pl->data[dN].length_N : rN_end;
+
+			if (pl->data[dN].tail_N > rN && pl->data[dN].tail_N < rN_end) {
+
+				rN_end = pl->data[dN].tail_N;
+			}
+
+			lN = rN_end - rN;
+			N = rN;
+
+			row = plotDataGet(pl, dN, &N);
+
+			if (row == NULL) {
+
+				pl->draw[fN].sketch = SKETCH_FINISHED;
+				break;
+			}
+
+			if (queue_N >= queue_MAX) {
+
+				plotDensityMerge(pl, fN, queue[0]);
+
+				for (N = 1; N < queue_N; ++N)
+					queue[N - 1] = queue[N];
 
-		linked = pl->sketch[hN].linked;
+				queue_N--;
+			}
 
-		pl->sketch[hN].linked = pl->sketch_list_garbage;
-		pl->sketch_list_garbage = hN;
+			job = plotDensityAlloc(pl, fN, lN, gather);
 
-		hN = linked;
-	}
+			if (job == NULL)
+				break;
 
-	hN = pl->sketch_list_current;
+			job->id = (double) id_N;
 
-	while (hN >= 0) {
+			if (gather != 0) {
 
-		linked = pl->sketch[hN].linked;
+				for (N = 0; N < lN; ++N) {
 
-		pl->sketch[hN].linked = pl->sketch_list_garbage;
-		pl->sketch_list_garbage = hN;
+					job->xy[N * 2 + 0] = (xN < 0) ? id_N + N : row[xN];
+					job->xy[N * 2 + 1] = (yN < 0) ? id_N + N : row[yN];
 
-		hN = linked;
-	}
+					row += pl->data[dN].column_N + PLOT_SUBTRACT;
+				}
 
-	pl->sketch_list_todraw = -1;
-	pl->sketch_list_current = -1;
-	pl->sketch_list_current_end = -1;
+				job->raw = job->xy;
+				job->stride = 2;
+				job->column_X = 0;
+				job->column_Y = 1;
+			}
+			else {
+				job->raw = row;
+				job->stride = pl->data[dN].column_N + PLOT_SUBTRACT;
+				job->column_X = xN;
+				job->column_Y = yN;
+			}
 
-	for (N = 0; N < PLOT_FIGURE_MAX; ++N)
-		pl->draw[N].list_self = -1;
+			if (		pl->pool == NULL
+					|| async_pool_submit(pl->pool, (void (*) (void *))
+						&plotDensityRun, job) != ASYNC_OK) {
 
-	pl->draw_in_progress = 0;
-}
+				plotDensityRun(job);
+			}
 
-static void
-plotDrawPalette(plot_t *pl)
-{
-	draw_t			*dw = pl->dw;
-	scheme_t		*sch = pl->sch;
-	Uint32			*palette;
+			queue[queue_N++] = job;
 
-	palette = dw->palette;
+			plotDataSkip(pl, dN, &rN, &id_N, lN);
+		}
 
-	palette[0] = drawRGBMap(dw, sch->plot_background);
-	palette[1] = drawRGBMap(dw, sch->plot_figure[0]);
-	palette[2] = drawRGBMap(dw, sch->plot_figure[1]);
-	palette[3] = drawRGBMap(dw, sch->plot_figure[2]);
-	palette[4] = drawRGBMap(dw, sch->plot_figure[3]);
-	palette[5] = drawRGBMap(dw, sch->plot_figure[4]);
-	palette[6] = drawRGBMap(dw, sch->plot_figure[5]);
-	palette[7] = drawRGBMap(dw, sch->plot_figure[6]);
-	palette[8] = drawRGBMap(dw, sch->plot_figure[7]);
-	palette[9] = drawRGBMap(dw, sch->plot_figure[8]);
-	palette[10] = drawRGBMap(dw, sch->plot_figure[9]);
-	palette[11] = drawRGBMap(dw, sch->plot_hidden);
-	palette[12] = drawRGBMap(dw, sch->plot_text);
-}
+		if (SDL_GetTicks() > tTOP)
+			break;
+	}
+	while (1);
 
-static Uint32
-plotGetTick(plot_t *pl)
-{
-	if (pl->tick_skip++ >= 63) {
+	/* We wait for all jobs here as the rows may be changed after we
+	 * return.
+	 * */
+	for (N = 0; N < queue_N; ++N) {
 
-		pl->tick_cached = SDL_GetTicks();
-		pl->tick_skip = 0;
+		plotDensityMerge(pl, fN, queue[N]);
 	}
 
-	return pl->tick_cached;
+	pl->draw[fN].rN = rN;
+	pl->draw[fN].id_N = id_N;
 }
 
 static void
 plotDrawFigureTrial(plot_t *pl, int fN, Uint32 tTOP)
 {
 	const fval_t	*row;
+	const lod_t	*xlod, *ylod;
 
 	double		scale_X, scale_Y, offset_X, offset_Y, im_MIN, im_MAX;
 	double		X, Y, last_X, last_Y, im_X, im_Y, last_im_X, last_im_Y;
-	int		dN, rN, xN, yN, xNR, yNR, aN, bN, id_N, id_N_top, kN, kN_cached;
-	int		job, skipped, line, rc, ncolor, fdrawing, fwidth;
+	int		dN, rN, xN, yN, xNR, yNR, xNL, yNL, aN, bN, id_N, id_N_top, kN, kN_cached;
+	int		job, skipped, line, rc, ncolor, fdrawing, fwidth, lSHIFT;
 
 	ncolor = (pl->figure[fN].hidden != 0) ? 11 : fN + 1;
 
@@ -7451,6 +9872,11 @@ plotDrawFigureTrial(plot_t *pl, int fN, Uint32 tTOP)
 	xNR = plotDataRangeCacheFetch(pl, dN, xN);
 	yNR = plotDataRangeCacheFetch(pl, dN, yN);
 
+	/* Pyramid of the index column is not needed.
+	 * */
+	xNL = (xN >= 0) ? xNR : -1;
+	yNL = (yN >= 0 && (xN < 0 || xNR >= 0)) ? yNR : -1;
+
 	aN = pl->figure[fN].axis_X;
 	scale_X = pl->axis[aN].scale;
 	offset_X = pl->axis[aN].offset;
@@ -7487,6 +9913,17 @@ plotDrawFigureTrial(plot_t *pl, int fN, Uint32 tTOP)
 	id_N_top = id_N + (1UL << pl->data[dN].chunk_SHIFT);
 	kN_cached = -1;
 
+	if (fdrawing == FIGURE_DRAWING_DENSITY) {
+
+		if (pl->draw[fN].sketch == SKETCH_STARTED) {
+
+			plotDensityReset(pl, fN, scale_X, offset_X, scale_Y, offset_Y);
+		}
+
+		plotDrawDensityTrial(pl, fN, xNR, yNR, tTOP);
+		return ;
+	}
+
 	plotSketchDataChunkSetUp(pl, fN);
 
 	if (		fdrawing == FIGURE_DRAWING_LINE
@@ -7542,28 +9979,19 @@ plotDrawFigureTrial(plot_t *pl, int fN, Uint32 tTOP)
 
 			if (job != 0 || line != 0) {
 
-				if (skipped != 0) {
-
-					plotDataSkip(pl, dN, &rN, &id_N, -1);
-
-					skipped = 0;
-				}
-
-				row = plotDataGet(pl, dN, &rN);
-
-				if (row == NULL) {
-
-					pl->draw[fN].sketch = SKETCH_FINISHED;
-					break;
-				}
+				lSHIFT = (job != 0 && skipped == 0 && yNL >= 0)
+					? plotDataLodPick(pl, dN, xNL, yNL, rN, scale_X, &xlod, &ylod) : 0;
 
-				X = (xN < 0) ? id_N : row[xN];
-				Y = (yN < 0) ? id_N : row[yN];
+				if (lSHIFT != 0) {
 
-				im_X = X * scale_X + offset_X;
-				im_Y = Y * scale_Y + offset_Y;
+					/* Bucket fits into one pixel column so we draw
+					 * the vertical span instead of all its rows.
+					 * */
+					X = (xlod != NULL) ? xlod->first : id_N;
+					Y = ylod->first;
 
-				if (fp_isfinite(im_X) && fp_isfinite(im_Y)) {
+					im_X = X * scale_X + offset_X;
+					im_Y = Y * scale_Y + offset_Y;
 
 					if (line != 0) {
 
@@ -7577,21 +10005,82 @@ plotDrawFigureTrial(plot_t *pl, int fN, Uint32 tTOP)
 							plotSketchDataAdd(pl, fN, X, Y);
 						}
 					}
-					else {
-						line = 1;
+
+					im_MIN = ylod->fmin * scale_Y + offset_Y;
+					im_MAX = ylod->fmax * scale_Y + offset_Y;
+
+					rc = drawLineTrial(pl->dw, &pl->viewport,
+							im_X, im_MIN, im_X, im_MAX,
+							ncolor, fwidth);
+
+					if (rc != 0) {
+
+						plotSketchDataAdd(pl, fN, X, ylod->fmin);
+						plotSketchDataAdd(pl, fN, X, ylod->fmax);
 					}
 
-					last_X = X;
-					last_Y = Y;
+					last_X = (xlod != NULL) ? xlod->last : id_N + (1 << lSHIFT) - 1;
+					last_Y = ylod->last;
+
+					last_im_X = last_X * scale_X + offset_X;
+					last_im_Y = last_Y * scale_Y + offset_Y;
 
-					last_im_X = im_X;
-					last_im_Y = im_Y;
+					line = 1;
+
+					plotDataSkip(pl, dN, &rN, &id_N, 1 << lSHIFT);
 				}
 				else {
-					line = 0;
-				}
+					if (skipped != 0) {
 
-				id_N++;
+						plotDataSkip(pl, dN, &rN, &id_N, -1);
+
+						skipped = 0;
+					}
+
+					row = plotDataGet(pl, dN, &rN);
+
+					if (row == NULL) {
+
+						pl->draw[fN].sketch = SKETCH_FINISHED;
+						break;
+					}
+
+					X = (xN < 0) ? id_N : row[xN];
+					Y = (yN < 0) ? id_N : row[yN];
+
+					im_X = X * scale_X + offset_X;
+					im_Y = Y * scale_Y + offset_Y;
+
+					if (fp_isfinite(im_X) && fp_isfinite(im_Y)) {
+
+						if (line != 0) {
+
+							rc = drawLineTrial(pl->dw, &pl->viewport,
+									last_im_X, last_im_Y, im_X, im_Y,
+									ncolor, fwidth);
+
+							if (rc != 0) {
+
+								plotSketchDataAdd(pl, fN, last_X, last_Y);
+								plotSketchDataAdd(pl, fN, X, Y);
+							}
+						}
+						else {
+							line = 1;
+						}
+
+						last_X = X;
+						last_Y = Y;
+
+						last_im_X = im_X;
+						last_im_Y = im_Y;
+					}
+					else {
+						line = 0;
+					}
+
+					id_N++;
+				}
 			}
 
 			if (job == 0) {
@@ -7721,7 +10210,7 @@ int plotGetSketchLength(plot_t *pl)
 }
 
 static void
-plotDrawSketch(plot_t *pl, SDL_Surface *surface)
+plotDrawSketchTile(plot_t *pl, draw_t *dw, SDL_Surface *surface)
 {
 	double		scale_X, offset_X, scale_Y, offset_Y;
 	double		X, Y, last_X, last_Y, *chunk, *lend;
@@ -7731,10 +10220,6 @@ plotDrawSketch(plot_t *pl, SDL_Surface *surface)
 
 	hN = pl->sketch_list_todraw;
 
-	drawDashReset(pl->dw);
-
-	SDL_LockSurface(surface);
-
 	while (hN >= 0) {
 
 		fN = pl->sketch[hN].figure_N;
@@ -7793,7 +10278,7 @@ plotDrawSketch(plot_t *pl, SDL_Surface *surface)
 				X = X * scale_X + offset_X;
 				Y = Y * scale_Y + offset_Y;
 
-				drawLineCanvas(pl->dw, surface, &pl->viewport,
+				drawLineCanvas(dw, surface, &pl->viewport,
 						last_X, last_Y, X, Y,
 						ncolor, fwidth);
 			}
@@ -7814,7 +10299,7 @@ plotDrawSketch(plot_t *pl, SDL_Surface *surface)
 				X = X * scale_X + offset_X;
 				Y = Y * scale_Y + offset_Y;
 
-				drawDashCanvas(pl->dw, surface, &pl->viewport,
+				drawDashCanvas(dw, surface, &pl->viewport,
 						last_X, last_Y, X, Y,
 						ncolor, fwidth, pl->layout_drawing_dash,
 						pl->layout_drawing_space);
@@ -7830,7 +10315,7 @@ plotDrawSketch(plot_t *pl, SDL_Surface *surface)
 				X = X * scale_X + offset_X;
 				Y = Y * scale_Y + offset_Y;
 
-				drawDotCanvas(pl->dw, surface, &pl->viewport,
+				drawDotCanvas(dw, surface, &pl->viewport,
 						X, Y, fwidth,
 						ncolor, 1);
 			}
@@ -7838,10 +10323,223 @@ plotDrawSketch(plot_t *pl, SDL_Surface *surface)
 
 		hN = pl->sketch[hN].linked;
 	}
+}
+
+static void
+plotDrawTileRun(tile_job_t *job)
+{
+	clipBox_t	cb;
+
+	if (job->flush != 0) {
+
+		cb = job->pl->viewport;
+
+		cb.min_y = job->dw.tile_min_y;
+		cb.max_y = job->dw.tile_max_y;
+
+		drawFlushCanvas(&job->dw, job->surface, &cb);
+	}
+	else {
+		plotDrawSketchTile(job->pl, &job->dw, job->surface);
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+}
+
+/* The function splits the viewport into bands of rows and draws each band
+ * on its own thread with the copy of drawing context. Each band goes over
+ * the whole sketch in order so the result is the same as we draw it all on
+ * the single thread.
+ * */
+static void
+plotDrawTiled(plot_t *pl, SDL_Surface *surface, int flush)
+{
+	tile_job_t	job[ASYNC_THREAD_MAX + 1];
+
+	int		N, tile_N, min_y, length_y;
+
+	tile_N = 1;
+
+	if (surface->userdata == NULL && SDL_GetCPUCount() > 1) {
+
+		plotPoolOpen(pl);
+
+		if (pl->pool != NULL) {
+
+			length_y = pl->viewport.max_y - pl->viewport.min_y + 1;
+
+			tile_N = pl->pool->thread_N + 1;
+			tile_N = (tile_N > SDL_GetCPUCount()) ? SDL_GetCPUCount() : tile_N;
+			tile_N = (tile_N > length_y / PLOT_TILE_HEIGHT) ? length_y / PLOT_TILE_HEIGHT : tile_N;
+		}
+	}
+
+	if (tile_N < 2) {
+
+		if (flush != 0) {
+
+			drawFlushCanvas(pl->dw, surface, &pl->viewport);
+		}
+		else {
+			plotDrawSketchTile(pl, pl->dw, surface);
+		}
+
+		return ;
+	}
+
+	min_y = pl->viewport.min_y;
+	length_y = pl->viewport.max_y - pl->viewport.min_y + 1;
+
+	for (N = 0; N < tile_N; ++N) {
+
+		job[N].pl = pl;
+		job[N].surface = surface;
+		job[N].dw = *pl->dw;
+		job[N].flush = flush;
+
+		job[N].dw.tile = 1;
+		job[N].dw.tile_min_y = min_y + length_y * N / tile_N;
+		job[N].dw.tile_max_y = min_y + length_y * (N + 1) / tile_N - 1;
+
+		SDL_AtomicSet(&job[N].done, 0);
+
+		if (		N == tile_N - 1
+				|| async_pool_submit(pl->pool, (void (*) (void *))
+					&plotDrawTileRun, &job[N]) != ASYNC_OK) {
+
+			plotDrawTileRun(&job[N]);
+		}
+	}
+
+	for (N = 0; N < tile_N; ++N) {
+
+		while (SDL_AtomicGet(&job[N].done) == 0) {
+
+			SDL_Delay(0);
+		}
+	}
+
+	/* Dash context is the same in all tiles.
+	 * */
+	pl->dw->dash_context = job[0].dw.dash_context;
+}
+
+static void
+plotDrawSketch(plot_t *pl, SDL_Surface *surface)
+{
+	drawDashReset(pl->dw);
+
+	SDL_LockSurface(surface);
+
+	plotDrawTiled(pl, surface, 0);
 
 	SDL_UnlockSurface(surface);
 }
 
+static void
+plotDrawDensity(plot_t *pl, SDL_Surface *surface)
+{
+	const density_t	*dn;
+
+	double		scale_X, offset_X, scale_Y, offset_Y, X, Y;
+	int		fN, aN, bN, N, size_X, size_Y, *map_X, *map_Y;
+
+	size_X = pl->viewport.max_x - pl->viewport.min_x + 1;
+	size_Y = pl->viewport.max_y - pl->viewport.min_y + 1;
+
+	map_X = NULL;
+	map_Y = NULL;
+
+	for (fN = 0; fN < PLOT_FIGURE_MAX; ++fN) {
+
+		if (		pl->figure[fN].busy == 0
+				|| pl->figure[fN].drawing != FIGURE_DRAWING_DENSITY
+				|| pl->draw[fN].density_ready == 0)
+			continue;
+
+		dn = &pl->draw[fN].density[1];
+
+		if (dn->count == NULL)
+			continue;
+
+		if (map_X == NULL) {
+
+			map_X = (int *) malloc((size_X + size_Y) * sizeof(int));
+
+			if (map_X == NULL) {
+
+				ERROR("No memory allocated for density map\n");
+				break;
+			}
+
+			map_Y = map_X + size_X;
+
+			SDL_LockSurface(surface);
+		}
+
+		aN = pl->figure[fN].axis_X;
+		scale_X = pl->axis[aN].scale;
+		offset_X = pl->axis[aN].offset;
+
+		if (pl->axis[aN].slave != 0) {
+
+			bN = pl->axis[aN].slave_N;
+			scale_X *= pl->axis[bN].scale;
+			offset_X = offset_X * pl->axis[bN].scale + pl->axis[bN].offset;
+		}
+
+		aN = pl->figure[fN].axis_Y;
+		scale_Y = pl->axis[aN].scale;
+		offset_Y = pl->axis[aN].offset;
+
+		if (pl->axis[aN].slave != 0) {
+
+			bN = pl->axis[aN].slave_N;
+			scale_Y *= pl->axis[bN].scale;
+			offset_Y = offset_Y * pl->axis[bN].scale + pl->axis[bN].offset;
+		}
+
+		X = (double) (pl->viewport.max_x - pl->viewport.min_x);
+		Y = (double) (pl->viewport.min_y - pl->viewport.max_y);
+
+		scale_X *= X;
+		offset_X = offset_X * X + pl->viewport.min_x;
+		scale_Y *= Y;
+		offset_Y = offset_Y * Y + pl->viewport.max_y;
+
+		/* Counts were binned with the scale of the previous pass so
+		 * we map the screen back to the bins. That gives the preview
+		 * when the axes were moved during the pass.
+		 * */
+		for (N = 0; N < size_X; ++N) {
+
+			X = ((double) (pl->viewport.min_x + N) + 0.5 - offset_X) / scale_X;
+			X = X * dn->scale_X + dn->offset_X - dn->min_X;
+
+			map_X[N] = (fp_isfinite(X) && X >= 0. && X < (double) dn->size_X) ? (int) X : -1;
+		}
+
+		for (N = 0; N < size_Y; ++N) {
+
+			Y = ((double) (pl->viewport.min_y + N) + 0.5 - offset_Y) / scale_Y;
+			Y = Y * dn->scale_Y + dn->offset_Y - dn->min_Y;
+
+			map_Y[N] = (fp_isfinite(Y) && Y >= 0. && Y < (double) dn->size_Y) ? (int) Y : -1;
+		}
+
+		drawDensityCanvas(pl->dw, surface, &pl->viewport, dn->count, dn->size_X,
+				map_X, map_Y, dn->count_max,
+				(pl->figure[fN].hidden != 0) ? 11 : fN + 1);
+	}
+
+	if (map_X != NULL) {
+
+		SDL_UnlockSurface(surface);
+
+		free(map_X);
+	}
+}
+
 static void
 plotDrawBrush(plot_t *pl, SDL_Surface *surface)
 {
@@ -8525,6 +11223,14 @@ plotLegendDraw(plot_t *pl, SDL_Surface *surface)
 							boxX + padY, boxY + padY,
 							(fwidth > 4) ? fwidth : 4, ncolor, 1);
 				}
+				else if (pl->figure[fN].drawing == FIGURE_DRAWING_DENSITY) {
+
+					boxX = legX + pl->layout_font_height;
+
+					drawDotCanvas(pl->dw, surface, &pl->viewport,
+							boxX + padY, boxY + padY,
+							pl->layout_font_height / 2, ncolor, 0);
+				}
 
 				if (pl->mark_on != 0) {
 
@@ -8934,6 +11640,7 @@ void plotDraw(plot_t *pl, SDL_Surface *surface)
 
 	drawClearCanvas(pl->dw);
 
+	plotDrawDensity(pl, surface);
 	plotDrawSketch(pl, surface);
 
 	if (pl->mark_on != 0) {
@@ -8957,7 +11664,7 @@ void plotDraw(plot_t *pl, SDL_Surface *surface)
 
 	SDL_LockSurface(surface);
 
-	drawFlushCanvas(pl->dw, surface, &pl->viewport);
+	plotDrawTiled(pl, surface, 1);
 
 	SDL_UnlockSurface(surface);
 
@@ -8969,7 +11676,7 @@ void plotDraw(plot_t *pl, SDL_Surface *surface)
 
 	SDL_LockSurface(surface);
 
-	drawFlushCanvas(pl->dw, surface, &pl->viewport);
+	plotDrawTiled(pl, surface, 1);
 
 	SDL_UnlockSurface(surface);
 
@@ -22,8 +22,11 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "async.h"
 #include "draw.h"
 #include "lse.h"
+#include "median.h"
+#include "expr.h"
 #include "scheme.h"
 
 #ifdef ERROR
@@ -41,18 +44,27 @@
 #define PLOT_CHUNK_SIZE				16777216
 #define PLOT_CHUNK_MAX				2000
 #define PLOT_CHUNK_CACHE			4
+#define PLOT_CHUNK_CACHE_MAX			64
+#define PLOT_CHUNK_THREADS			2
 #define PLOT_RCACHE_SIZE			32
+#define PLOT_LOD_SHIFT				4
+#define PLOT_LOD_FANOUT				2
 #define PLOT_SLICE_SPAN				4
 #define PLOT_AXES_MAX				10
 #define PLOT_FIGURE_MAX 			10
 #define PLOT_DATA_BOX_MAX			10
-#define PLOT_MEDIAN_MAX 			57
+#define PLOT_MEDIAN_MAX 			32767
 #define PLOT_POLYFIT_MAX			7
+#define PLOT_POLYFIT_BLOCK			16384
+#define PLOT_SPECTRUM_SHIFT			20
+#define PLOT_SPECTRUM_BLOCK			65536
+#define PLOT_SPECTRUM_QUEUE			16777216
 #define PLOT_SUBTRACT				20
 #define PLOT_GROUP_MAX				40
 #define PLOT_MARK_MAX				80
 #define PLOT_SKETCH_CHUNK_SIZE			32768
 #define PLOT_SKETCH_MAX				800
+#define PLOT_TILE_HEIGHT			32
 #define PLOT_STRING_MAX				200
 #define PLOT_RUNTIME_MAX			20
 
@@ -84,7 +96,8 @@ enum {
 enum {
 	FIGURE_DRAWING_LINE		= 0,
 	FIGURE_DRAWING_DASH,
-	FIGURE_DRAWING_DOT
+	FIGURE_DRAWING_DOT,
+	FIGURE_DRAWING_DENSITY
 };
 
 enum {
@@ -104,7 +117,26 @@ enum {
 	SUBTRACT_FILTER_BITFIELD,
 	SUBTRACT_FILTER_LOW_PASS,
 	SUBTRACT_FILTER_MEDIAN,
-	SUBTRACT_FILTER_DEMULTIPLEX
+	SUBTRACT_FILTER_DEMULTIPLEX,
+	SUBTRACT_EXPRESSION
+};
+
+enum {
+	LZ4_COMPRESS_NONE		= 0,
+	LZ4_COMPRESS_ROWS,
+	LZ4_COMPRESS_COLUMNS
+};
+
+enum {
+	CHUNK_LZ4_ROWS			= 0,
+	CHUNK_LZ4_CODEC,
+	CHUNK_PLAIN_CODEC
+};
+
+enum {
+	CACHE_JOB_NONE			= 0,
+	CACHE_JOB_COMPRESS,
+	CACHE_JOB_DECOMPRESS
 };
 
 enum {
@@ -135,6 +167,34 @@ typedef struct {
 }
 tuple_t;
 
+typedef struct {
+
+	int		finite;
+
+	fval_t		fmin;
+	fval_t		fmax;
+	fval_t		first;
+	fval_t		last;
+}
+lod_t;
+
+typedef struct {
+
+	Uint32		*count;
+	Uint32		count_max;
+
+	int		min_X;
+	int		min_Y;
+	int		size_X;
+	int		size_Y;
+
+	double		scale_X;
+	double		offset_X;
+	double		scale_Y;
+	double		offset_Y;
+}
+density_t;
+
 typedef struct {
 
 	draw_t			*dw;
@@ -152,7 +212,6 @@ typedef struct {
 		int		chunk_bSIZE;
 
 		int		lz4_compress;
-		void		*lz4_reserved;
 
 		struct {
 
@@ -160,21 +219,41 @@ typedef struct {
 
 			int		chunk_N;
 			int		dirty;
+
+			int		job;
+			SDL_atomic_t	done;
+
+			void		*zraw;
+			int		zlength;
+			int		zformat;
 		}
-		cache[PLOT_CHUNK_CACHE];
+		cache[PLOT_CHUNK_CACHE_MAX];
 
+		int		cache_N;
 		int		cache_ID;
+		int		cache_kN;
+		int		cache_map[PLOT_CHUNK_MAX];
 
 		struct {
 
 			void		*raw;
 			int		length;
+			int		format;
 		}
 		compress[PLOT_CHUNK_MAX];
 
 		fval_t		*raw[PLOT_CHUNK_MAX];
 		int		*map;
 
+		struct {
+
+			const void	*raw;
+
+			int		fp_bSIZE;
+			int		length;
+		}
+		mapped;
+
 		int		head_N;
 		int		tail_N;
 		int		id_N;
@@ -183,6 +262,9 @@ typedef struct {
 
 			int	busy;
 
+			median_t	*median[2];
+			expr_t		*expr;
+
 			union {
 
 				struct {
@@ -196,13 +278,6 @@ typedef struct {
 					int	unwrap;
 					int	opdata;
 
-					struct {
-
-						double	fval;
-						double	fpay;
-					}
-					window[PLOT_MEDIAN_MAX];
-
 					int	keep;
 					int	tail;
 
@@ -260,6 +335,13 @@ typedef struct {
 					double	state[2];
 				}
 				filter;
+
+				struct {
+
+					int	column_X;
+					int	column_Y;
+				}
+				expr;
 			}
 			op;
 		}
@@ -284,6 +366,9 @@ typedef struct {
 
 			fval_t		fmin;
 			fval_t		fmax;
+
+			lod_t		*lod;
+			int		lod_N;
 		}
 		chunk[PLOT_CHUNK_MAX];
 
@@ -427,6 +512,12 @@ typedef struct {
 		double		last_Y;
 
 		int		list_self;
+
+		/* Density is binned into the first buffer and we show the
+		 * second one that was completed in previous pass.
+		 * */
+		density_t	density[2];
+		int		density_ready;
 	}
 	draw[PLOT_FIGURE_MAX];
 
@@ -490,6 +581,10 @@ typedef struct {
 	int			fprecision;
 	int			fhexadecimal;
 	int			lz4_compress;
+	int			cache_budget;
+	int			threads;
+
+	async_POOL		*pool;
 
 	int			shift_on;
 }
@@ -519,6 +614,9 @@ void plotDataSubtractClean(plot_t *pl);
 void plotDataSubtractPaused(plot_t *pl);
 void plotDataSubtractAlternate(plot_t *pl);
 void plotDataInsert(plot_t *pl, int dN, const fval_t *row);
+void plotPoolOpen(plot_t *pl);
+void plotDataMapped(plot_t *pl, int dN, int cN, int lN, const void *raw, int fp_bSIZE);
+void plotDataUnmap(plot_t *pl, int dN);
 void plotDataClean(plot_t *pl, int dN);
 
 void plotDataRangeCacheClean(plot_t *pl, int dN);
@@ -565,6 +663,7 @@ int plotGetSubtractResample(plot_t *pl, int dN, int cN_X, int in_dN, int in_cN_X
 int plotGetSubtractBinary(plot_t *pl, int dN, int opSUB, int cN_1, int cN_2);
 int plotGetSubtractFilter(plot_t *pl, int dN, int cNX, int cNY, int opSUB, double value);
 int plotGetSubtractMedian(plot_t *pl, int dN, int cN, int opSUB, int length);
+int plotGetSubtractExpression(plot_t *pl, int dN, int cNX, int cNY, const char *text);
 int plotGetFreeFigure(plot_t *pl);
 
 int plotFigureSubtractGetMedianConfig(plot_t *pl, int fN, int *length, int *unwrap, int *opdata);
@@ -572,12 +671,14 @@ void plotFigureSubtractTimeMedian(plot_t *pl, int fN, int length, int unwrap, in
 void plotFigureSubtractScale(plot_t *pl, int fN, int aBUSY, double scale, double offset);
 void plotFigureSubtractFilter(plot_t *pl, int fN, int opSUB, double value);
 void plotFigureSubtractDemux(plot_t *pl, int fN, int opSUB, int N);
+void plotFigureSubtractExpression(plot_t *pl, int fN, const char *text);
 void plotFigureSubtractClean(plot_t *pl, int fN, int opSUB);
 void plotFigureSubtractSwitch(plot_t *pl, int opSUB);
 void plotTotalSubtractResample(plot_t *pl, int dN, double tmin, double tmax);
 
 int plotDataBoxPolyfit(plot_t *pl, int fN);
 void plotFigureSubtractPolyfit(plot_t *pl, int fN, int N0, int N1);
+int plotFigureSpectrum(plot_t *pl, int fN, int dN_spe, int length);
 int plotFigureExportCSV(plot_t *pl, const char *file);
 void plotFigureClean(plot_t *pl);
 void plotSketchClean(plot_t *pl);
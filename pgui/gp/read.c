@@ -27,14 +27,97 @@
 #include <windows.h>
 #endif /* _WINDOWS */
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
 #include "async.h"
 #include "dirent.h"
 #include "draw.h"
 #include "edit.h"
+#include "frame.h"
 #include "lang.h"
 #include "plot.h"
 #include "read.h"
 
+static const double	read_pow10[] = {
+
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+	1e21, 1e22
+};
+
+static void
+readMarkupMap(markup_t *mk)
+{
+	const char	*s;
+
+	memset(mk->map, 0, sizeof(mk->map));
+
+	for (s = mk->space; *s != 0; ++s) {
+
+		mk->map[(unsigned char) *s] |= MARKUP_SPACE;
+	}
+
+	for (s = mk->lend; *s != 0; ++s) {
+
+		mk->map[(unsigned char) *s] |= MARKUP_LEND;
+	}
+
+	mk->map[0] = MARKUP_END;
+}
+
+static char *
+readMarkupScan(const markup_t *mk, char *s, int flags)
+{
+#ifdef __SSE2__
+	const char	*list[2], *c;
+	__m128i		xb, xm;
+	int		mask, skip, lN, N;
+
+	lN = 0;
+
+	if (flags & MARKUP_SPACE) { list[lN++] = mk->space; }
+	if (flags & MARKUP_LEND) { list[lN++] = mk->lend; }
+
+	/* We use aligned loads only so we never cross the page boundary
+	 * after the terminating zero.
+	 * */
+	skip = (int) ((size_t) s & 15U);
+	s -= skip;
+
+	do {
+		xb = _mm_load_si128((const __m128i *) s);
+		xm = _mm_cmpeq_epi8(xb, _mm_setzero_si128());
+
+		for (N = 0; N < lN; ++N) {
+
+			for (c = list[N]; *c != 0; ++c) {
+
+				xm = _mm_or_si128(xm, _mm_cmpeq_epi8(xb, _mm_set1_epi8(*c)));
+			}
+		}
+
+		mask = _mm_movemask_epi8(xm) & (0xFFFF << skip);
+
+		if (mask != 0) {
+
+			return s + __builtin_ctz(mask);
+		}
+
+		s += 16;
+		skip = 0;
+	}
+	while (1);
+#else /* __SSE2__ */
+	flags |= MARKUP_END;
+
+	while ((mk->map[(unsigned char) *s] & flags) == 0) { s++; }
+
+	return s;
+#endif /* __SSE2__ */
+}
+
 char *stoi(const markup_t *mk, int *x, char *s)
 {
 	int		n, d, i;
@@ -54,8 +137,7 @@ char *stoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 9) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != 0) {
 
 		*x = i;
 	}
@@ -86,8 +168,7 @@ char *htoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 8) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != 0) {
 
 		*x = h;
 	}
@@ -114,8 +195,7 @@ char *otoi(const markup_t *mk, int *x, char *s)
 
 	if (d == 0 || d > 11) { return NULL; }
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	if (mk->map[(unsigned char) *s] != 0) {
 
 		*x = h;
 	}
@@ -124,23 +204,70 @@ char *otoi(const markup_t *mk, int *x, char *s)
 	return s;
 }
 
+static double
+stod_strtod(const markup_t *mk, const char *s, int e)
+{
+	char		lbuf[800];
+	int		len, dot, z;
+
+	len = 0;
+	dot = 0;
+	z = 0;
+
+	/* Rewrite the number as plain digits and exponent so libc does the
+	 * correct rounding. Digits beyond the buffer matter as sticky only.
+	 * */
+	do {
+		if (*s >= '0' && *s <= '9') {
+
+			if (len == 0 && *s == '0') { e -= dot; }
+			else if (len < 770) { lbuf[len++] = *s; e -= dot; }
+			else { e += 1 - dot; z |= (*s != '0') ? 1 : 0; }
+
+			s++;
+		}
+		else if (*s == mk->delim && dot == 0) { dot = 1; s++; }
+		else break;
+	}
+	while (1);
+
+	if (len == 0) { return 0.; }
+
+	if (z != 0) { lbuf[len++] = '1'; e -= 1; }
+
+	sprintf(lbuf + len, "e%i", e);
+
+	return strtod(lbuf, NULL);
+}
+
 char *stod(const markup_t *mk, double *x, char *s)
 {
-	int		n, d, v, e;
-	double		f;
+	unsigned long long	w;
+	int			n, d, v, e, z;
+	double			f;
+	const char		*b;
 
 	if (*s == '-') { n = - 1; s++; }
 	else if (*s == '+') { n = 1; s++; }
 	else { n = 1; }
 
+	b = s;
+
 	d = 0;
 	v = 0;
-	f = 0.;
+	e = 0;
+	z = 0;
+	w = 0ULL;
 
+	/* We collect up to 18 significant digits into the integer mantissa,
+	 * the rest of digits sends us to the slow path.
+	 * */
 	while (*s >= '0' && *s <= '9') {
 
-		f = 10. * f + (*s++ - '0') * n;
-		d += 1;
+		if (w < 100000000000000000ULL) { w = 10ULL * w + (*s - '0'); }
+		else { v += 1; z = 1; }
+
+		s++; d += 1;
 	}
 
 	if (*s == mk->delim) {
@@ -149,36 +276,54 @@ char *stod(const markup_t *mk, double *x, char *s)
 
 		while (*s >= '0' && *s <= '9') {
 
-			f = 10. * f + (*s++ - '0') * n;
-			d += 1; v -= 1;
+			if (w < 100000000000000000ULL) { w = 10ULL * w + (*s - '0'); v -= 1; }
+			else { z = 1; }
+
+			s++; d += 1;
 		}
 	}
 
 	if (d == 0) { return NULL; }
 
-	if (*s == 'p') { v += - 12; s++; }
-	else if (*s == 'n') { v += - 9; s++; }
-	else if (*s == 'u') { v += - 6; s++; }
-	else if (*s == 'm') { v += - 3; s++; }
-	else if (*s == 'K') { v += 3; s++; }
-	else if (*s == 'M') { v += 6; s++; }
-	else if (*s == 'G') { v += 9; s++; }
-	else if (*s == 'T') { v += 12; s++; }
+	if (*s == 'p') { e = - 12; s++; }
+	else if (*s == 'n') { e = - 9; s++; }
+	else if (*s == 'u') { e = - 6; s++; }
+	else if (*s == 'm') { e = - 3; s++; }
+	else if (*s == 'K') { e = 3; s++; }
+	else if (*s == 'M') { e = 6; s++; }
+	else if (*s == 'G') { e = 9; s++; }
+	else if (*s == 'T') { e = 12; s++; }
 	else if (*s == 'e' || *s == 'E') {
 
 		s = stoi(mk, &e, s + 1);
 
-		if (s != NULL) { v += e; }
+		if (s != NULL) {
+
+			e = (e < - 100000) ? - 100000 : (e > 100000) ? 100000 : e;
+		}
 		else { return NULL; }
 	}
 
-	if (*s == 0 || strchr(mk->space, *s) != NULL
-			|| strchr(mk->lend, *s) != NULL) {
+	v += e;
+
+	if (mk->map[(unsigned char) *s] != 0) {
 
-		while (v < 0) { f /= 10.; v += 1; }
-		while (v > 0) { f *= 10.; v -= 1; }
+		f = (double) w;
 
-		*x = f;
+		if (		z == 0 && w <= 9007199254740992ULL
+				&& v >= - 22 && v <= 22) {
+
+			/* Mantissa and power of ten are both exact so the
+			 * single IEEE operation gives correctly rounded result.
+			 * */
+			f = (v < 0) ? f / read_pow10[- v] : f * read_pow10[v];
+		}
+		else if (w != 0ULL) {
+
+			f = stod_strtod(mk, b, e);
+		}
+
+		*x = (n < 0) ? - f : f;
 	}
 	else { return NULL; }
 
@@ -211,6 +356,9 @@ read_t *readAlloc(draw_t *dw, plot_t *pl)
 	strcpy(rd->mk_text.space, "; \t");
 	strcpy(rd->mk_text.lend, rd->mk_config.lend);
 
+	readMarkupMap(&rd->mk_config);
+	readMarkupMap(&rd->mk_text);
+
 #ifdef _WINDOWS
 	rd->legacy_label = 1;
 	rd->legacy_console = 0;
@@ -220,6 +368,7 @@ read_t *readAlloc(draw_t *dw, plot_t *pl)
 	rd->chunk = 4096;
 	rd->timeout = 5000;
 	rd->length_N = 0;
+	rd->mmap = 0;
 
 	rd->bind_N = -1;
 	rd->page_N = -1;
@@ -773,106 +922,101 @@ readCSVGetBuf(char *s, int len, FILE *fd, int timeout)
 }
 
 static int
-readCSVGetRow(read_t *rd, int dN, int label_N)
+readCSVParseRow(const markup_t *mk, char *s, fval_t *rbuf, int *hint, int label_N)
 {
-	fval_t 		*row = rd->data[dN].row;
-	int		*hint = rd->data[dN].hint;
-	char 		*r, *s = rd->data[dN].buf;
+	fval_t 		*row = rbuf;
+	char 		*r;
 
 	int		hex, m, N;
 	double		val;
 
-	m = 0;
 	N = 0;
 
 	while (*s != 0) {
 
-		if (		strchr(rd->mk_text.space, *s) != NULL
-				|| strchr(rd->mk_text.lend, *s) != NULL) {
+		if (mk->map[(unsigned char) *s] != 0) {
 
-			m = 0;
+			s++;
+			continue;
 		}
-		else {
-			if (m == 0) {
 
-				m = 1;
+		if (hint[N] == DATA_HINT_FLOAT) {
 
-				if (hint[N] == DATA_HINT_FLOAT) {
+			r = stod(mk, &val, s);
 
-					r = stod(&rd->mk_text, &val, s);
+			if (r != NULL) {
 
-					if (r != NULL) {
-
-						*row++ = (fval_t) val;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else if (hint[N] == DATA_HINT_HEX) {
-
-					r = htoi(&rd->mk_text, &hex, s);
+				*row++ = (fval_t) val;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else if (hint[N] == DATA_HINT_HEX) {
 
-					if (r != NULL) {
+			r = htoi(mk, &hex, s);
 
-						*row++ = (fval_t) hex;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else if (hint[N] == DATA_HINT_OCT) {
+			if (r != NULL) {
 
-					r = otoi(&rd->mk_text, &hex, s);
+				*row++ = (fval_t) hex;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else if (hint[N] == DATA_HINT_OCT) {
 
-					if (r != NULL) {
+			r = otoi(mk, &hex, s);
 
-						*row++ = (fval_t) hex;
-					}
-					else {
-						*row++ = (fval_t) FP_NAN;
-					}
-				}
-				else {
-					r = stod(&rd->mk_text, &val, s);
+			if (r != NULL) {
 
-					if (r != NULL) {
+				*row++ = (fval_t) hex;
+			}
+			else {
+				*row++ = (fval_t) FP_NAN;
+			}
+		}
+		else {
+			r = stod(mk, &val, s);
 
-						*row++ = (fval_t) val;
-					}
-					else {
-						r = htoi(&rd->mk_text, &hex, s);
+			if (r != NULL) {
 
-						if (r != NULL) {
+				*row++ = (fval_t) val;
+			}
+			else {
+				r = htoi(mk, &hex, s);
 
-							if (hint[N] == DATA_HINT_NONE) {
+				if (r != NULL) {
 
-								hint[N] = DATA_HINT_HEX;
-							}
+					if (hint[N] == DATA_HINT_NONE) {
 
-							*row++ = (fval_t) hex;
-						}
-						else {
-							*row++ = (fval_t) FP_NAN;
-						}
+						hint[N] = DATA_HINT_HEX;
 					}
-				}
-
-				N++;
 
-				if (N >= READ_COLUMN_MAX)
-					break;
+					*row++ = (fval_t) hex;
+				}
+				else {
+					*row++ = (fval_t) FP_NAN;
+				}
 			}
 		}
 
-		s++;
+		N++;
+
+		if (N >= READ_COLUMN_MAX)
+			break;
+
+		/* Parsers stop at the token end, otherwise we skip the
+		 * malformed token up to the next separator.
+		 * */
+		s = (r != NULL) ? r : readMarkupScan(mk, s, MARKUP_SPACE | MARKUP_LEND);
 	}
 
 	if (N > label_N) {
 
 		fval_t		*end = row;
 
-		row = rd->data[dN].row;
+		row = rbuf;
 
 		m = 0;
 
@@ -911,6 +1055,13 @@ readCSVGetRow(read_t *rd, int dN, int label_N)
 	return N;
 }
 
+static int
+readCSVGetRow(read_t *rd, int dN, int label_N)
+{
+	return readCSVParseRow(&rd->mk_text, rd->data[dN].buf,
+			rd->data[dN].row, rd->data[dN].hint, label_N);
+}
+
 static int
 readCSVGetLabel(read_t *rd, int dN)
 {
@@ -936,8 +1087,7 @@ readCSVGetLabel(read_t *rd, int dN)
 
 	while (*s != 0) {
 
-		if (		strchr(rd->mk_text.space, *s) != NULL
-				|| strchr(rd->mk_text.lend, *s) != NULL) {
+		if (rd->mk_text.map[(unsigned char) *s] != 0) {
 
 			if (m != 0) {
 
@@ -1071,9 +1221,45 @@ readCSVGetCN(read_t *rd, int dN, FILE *fd, fval_t *rbuf, int *rbuf_N)
 	return cN;
 }
 
+static void
+readChunkFree(read_t *rd, int dN)
+{
+	chunk_t		*ck;
+	int		N;
+
+	/* Wait for the workers to finish with the chunks in progress.
+	 * */
+	for (N = rd->data[dN].chunk_rp; N != rd->data[dN].chunk_wp; ++N) {
+
+		ck = rd->data[dN].chunk + N % READ_CHUNK_MAX;
+
+		while (SDL_AtomicGet(&ck->done) == 0) {
+
+			SDL_Delay(1);
+		}
+	}
+
+	for (N = 0; N < READ_CHUNK_MAX; ++N) {
+
+		ck = rd->data[dN].chunk + N;
+
+		free(ck->text);
+		free(ck->row);
+	}
+
+	free(rd->data[dN].chunk);
+
+	rd->data[dN].chunk = NULL;
+}
+
 static void
 readCloseFile(read_t *rd, int dN)
 {
+	if (rd->data[dN].chunk != NULL) {
+
+		readChunkFree(rd, dN);
+	}
+
 	async_close(rd->data[dN].afd);
 
 	if (rd->data[dN].fd != stdin) {
@@ -1085,11 +1271,62 @@ readCloseFile(read_t *rd, int dN)
 	rd->data[dN].afd = NULL;
 }
 
+static void
+readUnmapFile(read_t *rd, int dN)
+{
+	plotDataUnmap(rd->pl, dN);
+
+	file_map_close(&rd->data[dN].fm);
+}
+
+static int
+readMapFile(read_t *rd, int dN, int cN, int lN, const char *file, int fmt)
+{
+	unsigned long long	nrow;
+	int			fp_bSIZE, id_N;
+
+	fp_bSIZE = (fmt == FORMAT_BINARY_FP_32) ? sizeof(float) : sizeof(double);
+
+	if (file_map_open(&rd->data[dN].fm, file) != ENT_OK) {
+
+		return 0;
+	}
+
+	nrow = rd->data[dN].fm.nsize / (cN * fp_bSIZE);
+	nrow = (nrow > 0x7FFFFFF0U) ? 0x7FFFFFF0U : nrow;
+
+	if (nrow < 1) {
+
+		file_map_close(&rd->data[dN].fm);
+
+		return 0;
+	}
+
+	/* Keep the file tail as the ring buffer would do.
+	 * */
+	lN = (lN < 1 || lN > (int) nrow) ? (int) nrow : lN;
+	id_N = (int) nrow - lN;
+
+	plotDataMapped(rd->pl, dN, cN, lN, (const char *) rd->data[dN].fm.raw
+			+ (size_t) id_N * cN * fp_bSIZE, fp_bSIZE);
+
+	if (rd->pl->data[dN].mapped.raw == NULL) {
+
+		file_map_close(&rd->data[dN].fm);
+
+		return 0;
+	}
+
+	rd->pl->data[dN].id_N += id_N;
+
+	return 1;
+}
+
 void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int fmt)
 {
 	fval_t		rbuf[READ_COLUMN_MAX * READ_TEXT_HEAD_MAX];
 
-	int		N, rbuf_N, bom;
+	int		N, rbuf_N, bom, packed = 0;
 
 	FILE			*fd;
 	unsigned long long	bF = 0U;
@@ -1099,6 +1336,11 @@ void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int f
 		readCloseFile(rd, dN);
 	}
 
+	if (rd->data[dN].fm.raw != NULL) {
+
+		readUnmapFile(rd, dN);
+	}
+
 	if (fmt == FORMAT_TEXT_STDIN) {
 
 		fd = stdin;
@@ -1117,8 +1359,51 @@ void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int f
 			file_stat(file, &bF);
 		}
 
+		if (		fmt != FORMAT_TEXT_STDIN
+				&& frameIsPacked(fd) != 0) {
+
+			/* Compressed file is unpacked into temporary file and
+			 * then read as usual.
+			 * */
+			fd = frameUnpack(fd);
+
+			if (fd == NULL) {
+
+				ERROR("Unable to unpack LZ4 file \"%s\"\n", file);
+				return ;
+			}
+
+			fseek(fd, 0UL, SEEK_END);
+			bF = (unsigned long long) ftell(fd);
+			fseek(fd, 0UL, SEEK_SET);
+
+			packed = 1;
+		}
+
 		rd->data[dN].length_N = (rd->length_N < 1) ? lN : rd->length_N;
 
+		if (		(fmt == FORMAT_BINARY_FP_32 || fmt == FORMAT_BINARY_FP_64)
+				&& rd->mmap != 0 && packed == 0
+				&& readMapFile(rd, dN, cN, lN, file, fmt) != 0) {
+
+			/* Dataset is served from the file mapping so we do not
+			 * read anything here. The file must not be truncated
+			 * while mapped, that is why mapping is opt-in.
+			 * */
+			fclose(fd);
+
+			rd->data[dN].format = fmt;
+			rd->data[dN].column_N = cN;
+			rd->data[dN].line_N = 1;
+
+			strcpy(rd->data[dN].file, file);
+
+			rd->keep_N += 1;
+			rd->bind_N = dN;
+
+			return ;
+		}
+
 		if (		fmt == FORMAT_TEXT_STDIN
 				|| fmt == FORMAT_TEXT_CSV) {
 
@@ -1202,6 +1487,18 @@ void readOpenUnified(read_t *rd, int dN, int cN, int lN, const char *file, int f
 		rd->data[dN].fd = fd;
 		rd->data[dN].afd = async_open(fd, rd->preload, rd->chunk, rd->timeout);
 
+		if (		fmt == FORMAT_TEXT_STDIN
+				|| fmt == FORMAT_TEXT_CSV) {
+
+			plotPoolOpen(rd->pl);
+
+			/* Text is parsed by chunks on the worker threads.
+			 * */
+			rd->data[dN].chunk = (chunk_t *) calloc(READ_CHUNK_MAX, sizeof(chunk_t));
+			rd->data[dN].chunk_rp = 0;
+			rd->data[dN].chunk_wp = 0;
+		}
+
 		rd->keep_N += 1;
 		rd->bind_N = dN;
 	}
@@ -1308,6 +1605,225 @@ readCSV(read_t *rd, int dN)
 	return 0;
 }
 
+static void
+readCSVChunkParse(chunk_t *ck)
+{
+	char		*s, *eol, *end;
+	int		cN;
+
+	memcpy(ck->hint, ck->hint_in, sizeof(ck->hint));
+
+	s = ck->text;
+	end = ck->text + ck->length;
+
+	*end = 0;
+
+	ck->line_N = 0;
+	ck->row_N = 0;
+	ck->row_rp = 0;
+
+	while (s < end) {
+
+		if (*s == '\r' || *s == '\n' || *s == 0) {
+
+			s++;
+			continue;
+		}
+
+		eol = readMarkupScan(ck->mk, s, MARKUP_LEND);
+
+		*eol = 0;
+
+		cN = readCSVParseRow(ck->mk, s, ck->rbuf, ck->hint, ck->column_N);
+
+		if (cN == ck->column_N) {
+
+			if (ck->row_N >= ck->row_MAX) {
+
+				ck->row_MAX = (ck->row_MAX < 256) ? 256 : ck->row_MAX * 2;
+				ck->row = (fval_t *) realloc(ck->row, ck->row_MAX
+						* ck->column_N * sizeof(fval_t));
+
+				if (ck->row == NULL) {
+
+					ERROR("No memory allocated for chunk rows\n");
+
+					ck->row_MAX = 0;
+					ck->row_N = 0;
+					break;
+				}
+			}
+
+			memcpy(ck->row + ck->row_N * ck->column_N, ck->rbuf,
+					ck->column_N * sizeof(fval_t));
+
+			ck->row_N++;
+		}
+
+		ck->line_N++;
+
+		s = eol + 1;
+	}
+
+	SDL_AtomicSet(&ck->done, 1);
+}
+
+static int
+readCSVChunkCommit(read_t *rd, int dN, chunk_t *ck, Uint32 tTOP)
+{
+	int		cN = rd->pl->data[dN].column_N;
+	int		ulN = 0;
+
+	if (ck->row_rp == 0) {
+
+		if (memcmp(ck->hint_in, rd->data[dN].hint, sizeof(ck->hint_in)) != 0) {
+
+			/* Column type hint was changed by the previous chunk
+			 * or by user so we parse this chunk again.
+			 * */
+			memcpy(ck->hint_in, rd->data[dN].hint, sizeof(ck->hint_in));
+
+			readCSVChunkParse(ck);
+		}
+
+		memcpy(rd->data[dN].hint, ck->hint, sizeof(ck->hint));
+
+		rd->data[dN].line_N += ck->line_N;
+	}
+
+	while (ck->row_rp < ck->row_N) {
+
+		plotDataInsert(rd->pl, dN, ck->row + ck->row_rp * cN);
+
+		ck->row_rp++;
+		ulN++;
+
+		if (		rd->data[dN].length_N < 1
+				&& plotDataSpaceLeft(rd->pl, dN) < 3) {
+
+			plotDataGrowUp(rd->pl, dN);
+		}
+
+		if ((ulN & 0xFF) == 0 && SDL_GetTicks() >= tTOP)
+			break;
+	}
+
+	return ulN;
+}
+
+static int
+readCSVChunkLoad(read_t *rd, int dN, Uint32 tTOP)
+{
+	chunk_t		*ck;
+	char		*text;
+	int		rc, ulN = 0;
+
+	do {
+		/* Commit the parsed chunks in order.
+		 * */
+		while (rd->data[dN].chunk_rp != rd->data[dN].chunk_wp) {
+
+			ck = rd->data[dN].chunk + rd->data[dN].chunk_rp % READ_CHUNK_MAX;
+
+			if (SDL_AtomicGet(&ck->done) == 0)
+				break;
+
+			ulN += readCSVChunkCommit(rd, dN, ck, tTOP);
+
+			if (ck->row_rp < ck->row_N)
+				return ulN;
+
+			rd->data[dN].chunk_rp++;
+		}
+
+		/* Pass the text chunks to the workers.
+		 * */
+		while (rd->data[dN].chunk_wp - rd->data[dN].chunk_rp < READ_CHUNK_MAX) {
+
+			ck = rd->data[dN].chunk + rd->data[dN].chunk_wp % READ_CHUNK_MAX;
+
+			if (ck->text == NULL) {
+
+				ck->text = (char *) malloc(READ_CHUNK_SIZE + 1);
+
+				if (ck->text == NULL) {
+
+					ERROR("No memory allocated for text chunk\n");
+					break;
+				}
+
+				ck->text_MAX = READ_CHUNK_SIZE;
+			}
+
+			rc = async_gets_chunk(rd->data[dN].afd, ck->text,
+					ck->text_MAX, &ck->length);
+
+			if (rc == ASYNC_NO_FREE_SPACE) {
+
+				/* Line does not fit into the chunk so we grow it
+				 * and fetch the line again.
+				 * */
+				text = (char *) realloc(ck->text, ck->text_MAX * 2 + 1);
+
+				if (text == NULL) {
+
+					ERROR("No memory allocated for text chunk\n");
+					break;
+				}
+
+				ck->text = text;
+				ck->text_MAX *= 2;
+
+				continue;
+			}
+
+			if (rc == ASYNC_OK) {
+
+				ck->mk = &rd->mk_text;
+				ck->column_N = rd->pl->data[dN].column_N;
+
+				memcpy(ck->hint_in, rd->data[dN].hint, sizeof(ck->hint_in));
+
+				SDL_AtomicSet(&ck->done, 0);
+
+				if (		rd->pl->pool == NULL
+						|| async_pool_submit(rd->pl->pool, (void (*) (void *))
+							&readCSVChunkParse, ck) != ASYNC_OK) {
+
+					readCSVChunkParse(ck);
+				}
+
+				rd->data[dN].chunk_wp++;
+			}
+			else {
+				if (		rc == ASYNC_END_OF_FILE
+						&& rd->data[dN].chunk_rp == rd->data[dN].chunk_wp) {
+
+					readCloseFile(rd, dN);
+
+					return ulN;
+				}
+
+				break;
+			}
+		}
+
+		if (		rd->data[dN].chunk_rp == rd->data[dN].chunk_wp
+				|| ulN != 0) {
+
+			/* Do not wait for workers if we have something to
+			 * draw already.
+			 * */
+			break;
+		}
+
+		SDL_Delay(1);
+	}
+	while (SDL_GetTicks() < tTOP);
+
+	return ulN;
+}
+
 static int
 readFP32(read_t *rd, int dN)
 {
@@ -1414,6 +1930,14 @@ int readDataLoad(read_t *rd)
 
 			keep_N += 1;
 
+			if (rd->data[dN].chunk != NULL) {
+
+				ulN += readCSVChunkLoad(rd, dN, tTOP);
+
+				plotDataSubtractResidual(rd->pl, dN);
+				continue;
+			}
+
 			do {
 				if (		rd->data[dN].format == FORMAT_TEXT_STDIN
 						|| rd->data[dN].format == FORMAT_TEXT_CSV) {
@@ -2008,6 +2532,28 @@ configParseFSM(read_t *rd, parse_t *pa)
 				}
 				while (0);
 			}
+			else if (strcmp(tbuf, "threads") == 0) {
+
+				failed = 1;
+
+				do {
+					rc = configToken(rd, pa);
+
+					if (rc == 0 && stoi(&rd->mk_config, &argi[0], tbuf) != NULL) ;
+					else break;
+
+					if (argi[0] >= 0 && argi[0] <= ASYNC_THREAD_MAX) {
+
+						failed = 0;
+
+						rd->pl->threads = argi[0];
+					}
+					else {
+						sprintf(msg_tbuf, "threads number %i is out of range", argi[0]);
+					}
+				}
+				while (0);
+			}
 			else if (strcmp(tbuf, "length") == 0) {
 
 				failed = 1;
@@ -2465,6 +3011,8 @@ configParseFSM(read_t *rd, parse_t *pa)
 
 						strcpy(rd->mk_text.space, tbuf);
 						strcat(rd->mk_text.space, rd->mk_config.space);
+
+						readMarkupMap(&rd->mk_text);
 					}
 				}
 				while (0);
@@ -2491,7 +3039,7 @@ configParseFSM(read_t *rd, parse_t *pa)
 						break;
 					}
 
-					if (argi[0] >= 0 && argi[0] < 2) {
+					if (argi[0] >= 0 && argi[0] <= LZ4_COMPRESS_COLUMNS) {
 
 						failed = 0;
 
@@ -2503,6 +3051,50 @@ configParseFSM(read_t *rd, parse_t *pa)
 				}
 				while (0);
 			}
+			else if (strcmp(tbuf, "cache_budget") == 0) {
+
+				failed = 1;
+
+				do {
+					rc = configToken(rd, pa);
+
+					if (rc == 0 && stoi(&rd->mk_config, &argi[0], tbuf) != NULL) ;
+					else break;
+
+					if (argi[0] >= 16 && argi[0] <= 16384) {
+
+						failed = 0;
+
+						rd->pl->cache_budget = argi[0];
+					}
+					else {
+						sprintf(msg_tbuf, "invalid cache_budget %i", argi[0]);
+					}
+				}
+				while (0);
+			}
+			else if (strcmp(tbuf, "mmap") == 0) {
+
+				failed = 1;
+
+				do {
+					rc = configToken(rd, pa);
+
+					if (rc == 0 && stoi(&rd->mk_config, &argi[0], tbuf) != NULL) ;
+					else break;
+
+					if (argi[0] >= 0 && argi[0] < 2) {
+
+						failed = 0;
+
+						rd->mmap = argi[0];
+					}
+					else {
+						sprintf(msg_tbuf, "invalid mmap %i", argi[0]);
+					}
+				}
+				while (0);
+			}
 			else if (strcmp(tbuf, "load") == 0) {
 
 				failed = 1;
@@ -3397,6 +3989,59 @@ configParseFSM(read_t *rd, parse_t *pa)
 				}
 				while (0);
 			}
+			else if (	   strcmp(tbuf, "xexpression") == 0
+					|| strcmp(tbuf, "yexpression") == 0) {
+
+				failed = 1;
+
+				do {
+					argi[0] = (int) tbuf[0];
+
+					rc = configToken(rd, pa);
+
+					if (rc == 0) ;
+					else break;
+
+					if (rd->figure_N < 0) {
+
+						sprintf(msg_tbuf, "no figure selected");
+						break;
+					}
+
+					if (rd->page[rd->page_N].fig[rd->figure_N].expr[0] != 0) {
+
+						sprintf(msg_tbuf, "only one expression per figure");
+						break;
+					}
+
+					N = configGetSubtract(rd, rd->page_N, rd->figure_N,
+							(argi[0] == 'x') ? 0 : 1);
+
+					if (N < 0) {
+
+						sprintf(msg_tbuf, "no free subtract found");
+					}
+					else {
+						failed = 0;
+
+						sprintf(rd->page[rd->page_N].fig[rd->figure_N].expr,
+								"%.190s", tbuf);
+
+						if (argi[0] == 'x') {
+
+							rd->page[rd->page_N].fig[rd->figure_N].bX[N].busy = SUBTRACT_EXPRESSION;
+							rd->page[rd->page_N].fig[rd->figure_N].bX[N].text =
+								rd->page[rd->page_N].fig[rd->figure_N].expr;
+						}
+						else {
+							rd->page[rd->page_N].fig[rd->figure_N].bY[N].busy = SUBTRACT_EXPRESSION;
+							rd->page[rd->page_N].fig[rd->figure_N].bY[N].text =
+								rd->page[rd->page_N].fig[rd->figure_N].expr;
+						}
+					}
+				}
+				while (0);
+			}
 			else if (	   strcmp(tbuf, "xfilter") == 0
 					|| strcmp(tbuf, "yfilter") == 0) {
 
@@ -3585,6 +4230,8 @@ configParseFSM(read_t *rd, parse_t *pa)
 							argi[0] = FIGURE_DRAWING_DASH;
 						else if (strcmp(tbuf, "dot") == 0)
 							argi[0] = FIGURE_DRAWING_DOT;
+						else if (strcmp(tbuf, "density") == 0)
+							argi[0] = FIGURE_DRAWING_DENSITY;
 						else {
 							sprintf(msg_tbuf, "invalid drawing \"%.80s\"", tbuf);
 							break;
@@ -3927,6 +4574,11 @@ void readDatasetClean(read_t *rd, int dN)
 		readCloseFile(rd, dN);
 	}
 
+	if (rd->data[dN].fm.raw != NULL) {
+
+		readUnmapFile(rd, dN);
+	}
+
 	memset(&rd->data[dN], 0, sizeof(rd->data[0]));
 
 	plotFigureGarbage(rd->pl, dN);
@@ -4333,6 +4985,15 @@ readScaleDataMap(plot_t *pl, int dN, int cNT, int cN, subtract_t *sb)
 			cMAP = plotGetSubtractFilter(pl, dN, sb[N].column_X, cN,
 					sb[N].busy, sb[N].args[0]);
 
+			if (cMAP != -1) {
+
+				cN = cMAP;
+			}
+		}
+		else if (sb[N].busy == SUBTRACT_EXPRESSION) {
+
+			cMAP = plotGetSubtractExpression(pl, dN, cNT, cN, sb[N].text);
+
 			if (cMAP != -1) {
 
 				cN = cMAP;
@@ -4343,6 +5004,27 @@ readScaleDataMap(plot_t *pl, int dN, int cNT, int cN, subtract_t *sb)
 	return cN;
 }
 
+void readSetLabel(read_t *rd, int dN, const char *label)
+{
+	if (dN < 0 || dN >= PLOT_DATASET_MAX) {
+
+		ERROR("Dataset number is out of range\n");
+		return ;
+	}
+
+	if (rd->data[dN].format == FORMAT_NONE) {
+
+		ERROR("Dataset number %i was not allocated\n", dN);
+		return ;
+	}
+
+	/* We parse the label line the same way as CSV header.
+	 * */
+	sprintf(rd->data[dN].buf, "%.*s", (int) sizeof(rd->data[0].buf) - 1, label);
+
+	(void) readCSVGetLabel(rd, dN);
+}
+
 void readSelectPage(read_t *rd, int pN)
 {
 	plot_t		*pl = rd->pl;
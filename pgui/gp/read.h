@@ -25,6 +25,7 @@
 #include <SDL2/SDL.h>
 
 #include "async.h"
+#include "dirent.h"
 #include "draw.h"
 #include "plot.h"
 
@@ -36,6 +37,8 @@
 #define READ_TEXT_HEAD_MAX	3
 #define READ_TEXT_DEVIATE_MAX	2
 #define READ_SUBTRACT_MAX	4
+#define READ_CHUNK_MAX		16
+#define READ_CHUNK_SIZE		524288
 
 #define GP_MIN_SIZE_X		640
 #define GP_MIN_SIZE_Y		480
@@ -44,6 +47,7 @@ enum {
 	FORMAT_NONE			= 0,
 	FORMAT_BLANK_DATA,
 	FORMAT_STUB_DATA,
+	FORMAT_SPECTRUM_DATA,
 	FORMAT_TEXT_STDIN,
 	FORMAT_TEXT_CSV,
 	FORMAT_BINARY_FP_32,
@@ -62,6 +66,12 @@ enum {
 	DATA_HINT_OCT
 };
 
+enum {
+	MARKUP_END			= 1,
+	MARKUP_SPACE			= 2,
+	MARKUP_LEND			= 4
+};
+
 enum {
 	BOM_NONE			= 0,
 	BOM_UTF_8,
@@ -73,9 +83,35 @@ typedef struct {
 	char		delim;
 	char		space[READ_TOKEN_MAX];
 	char		lend[READ_TOKEN_MAX];
+
+	unsigned char	map[256];
 }
 markup_t;
 
+typedef struct {
+
+	const markup_t	*mk;
+	int		column_N;
+
+	char		*text;
+	int		text_MAX;
+	int		length;
+	int		line_N;
+
+	fval_t		*row;
+	int		row_N;
+	int		row_MAX;
+	int		row_rp;
+
+	fval_t		rbuf[READ_COLUMN_MAX];
+
+	int		hint_in[READ_COLUMN_MAX];
+	int		hint[READ_COLUMN_MAX];
+
+	SDL_atomic_t	done;
+}
+chunk_t;
+
 typedef struct {
 
 	int		busy;
@@ -86,6 +122,8 @@ typedef struct {
 	int		column_Y;
 
 	double		args[2];
+
+	const char	*text;
 }
 subtract_t;
 
@@ -111,6 +149,7 @@ typedef struct {
 		subtract_t	bY[READ_SUBTRACT_MAX];
 
 		char		label[PLOT_STRING_MAX];
+		char		expr[PLOT_STRING_MAX];
 	}
 	fig[PLOT_FIGURE_MAX];
 
@@ -175,6 +214,7 @@ typedef struct {
 	int		chunk;
 	int		timeout;
 	int		length_N;
+	int		mmap;
 
 	struct {
 
@@ -188,6 +228,8 @@ typedef struct {
 		FILE		*fd;
 		async_FILE	*afd;
 
+		struct file_map	fm;
+
 		char		buf[READ_TOKEN_MAX * READ_COLUMN_MAX];
 		fval_t		row[READ_COLUMN_MAX];
 
@@ -195,6 +237,11 @@ typedef struct {
 
 		int		hint[READ_COLUMN_MAX];
 		int		bom;
+
+		chunk_t		*chunk;
+
+		int		chunk_rp;
+		int		chunk_wp;
 	}
 	data[PLOT_DATASET_MAX];
 
@@ -241,6 +288,7 @@ void readMakePages(read_t *rd, int dN, int cX, int fromUI);
 void readDatasetClean(read_t *rd, int dN);
 int readGetTimeColumn(read_t *rd, int dN);
 void readSetTimeColumn(read_t *rd, int dN, int cX);
+void readSetLabel(read_t *rd, int dN, const char *label);
 
 void readSelectPage(read_t *rd, int pN);
 void readCombinePage(read_t *rd, int pN, int remap);
@@ -1,11 +1,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <time.h>
 
 #include <SDL2/SDL.h>
 
 #include "gp/dirent.h"
+#include "gp/frame.h"
+#include "gp/gp.h"
 #include "config.h"
 #include "link.h"
 #include "serial.h"
@@ -16,6 +19,15 @@
 
 #define LINK_ALLOC_MAX			92160U
 #define LINK_CACHE_MAX			4096U
+#define LINK_BULK_MAX			76
+#define LINK_WATCH_MAX			40
+#define LINK_QUEUE_MAX			256
+#define LINK_STREAM_MAX			32768
+#define LINK_STREAM_FLUSH		20
+#define LINK_LOG_BUFFER			262144
+#define LINK_LOG_FLUSH			65536
+#define LINK_LOG_TIMEOUT		500
+#define LINK_LOG_SEGMENT		4
 
 enum {
 	LINK_MODE_IDLE			= 0,
@@ -25,20 +37,112 @@ enum {
 	LINK_MODE_EPCAN_MAP,
 	LINK_MODE_FLASH_MAP,
 	LINK_MODE_COMMAND,
+	LINK_MODE_REG_BULK,
+	LINK_MODE_REG_WATCH,
+};
+
+struct link_line {
+
+	char			lbuf[LINK_LINE_MAX];
+
+	int			network;
+
+	int			reg_ID;
+	int			reg_mode;
+	int			reg_text;
+
+	char			sym[LINK_NAME_MAX];
+	char			val[LINK_NAME_MAX];
+	char			um[LINK_NAME_MAX];
 };
 
 struct link_priv {
 
 	struct serial_fd	*fd;
 
+	SDL_Thread		*thread;
+	SDL_mutex		*mutex;
+
+	SDL_atomic_t		terminate;
+	SDL_atomic_t		reset;
+
+	SDL_atomic_t		line_count;
+	SDL_atomic_t		grab_count;
+	SDL_atomic_t		drop_count;
+
+	/* Queue of parsed lines from link thread to UI.
+	 * */
+	struct link_line	queue[LINK_QUEUE_MAX];
+
+	SDL_atomic_t		rp;
+	SDL_atomic_t		wp;
+
 	int			link_mode;
 	int			reg_push_ID;
 
+	int			reg_bulk;
+	int			reg_watch;
+	int			reply_N;
+	int			watch_N;
+
+	char			bulk_get[LINK_BULK_MAX + 1];
+	char			bulk_set[LINK_BULK_MAX + 1];
+
+	int			bulk_min;
+	int			bulk_max;
+
 	char			lbuf[LINK_LINE_MAX];
 
-	FILE			*fd_log;
 	FILE			*fd_grab;
 
+	/* Log is collected into double buffer and written out by separate
+	 * thread so the link thread never waits on disk.
+	 * */
+	struct {
+
+		FILE		*fd;
+		char		file[PHOBIA_PATH_MAX];
+
+		char		*buf[2];
+		int		len;
+		int		front;
+
+		unsigned long long	size;
+		unsigned long long	rotate;
+
+		int		compress;
+
+		SDL_Thread	*thread;
+		SDL_mutex	*mutex;
+		SDL_sem		*event;
+
+		SDL_atomic_t	terminate;
+	}
+	log;
+
+	/* Live telemetry decoded by link thread into gp dataset.
+	 * */
+	struct {
+
+		int		enabled;
+		int		column_N;
+
+		char		label[LINK_LINE_MAX];
+
+		gpcon_t		*gp;
+		int		dN;
+
+		double		batch[LINK_STREAM_MAX];
+		int		batch_N;
+
+		Uint32		clock;
+
+		int		align;
+		Uint32		origin;
+		double		offset;
+	}
+	stream;
+
 	char			mb[LINK_ALLOC_MAX];
 	char			*mbflow;
 
@@ -230,34 +334,81 @@ link_mballoc(struct link_pmc *lp, int len)
 	return mb;
 }
 
+static const struct {
+
+	const char	*command;
+	int		mode;
+}
+link_map[] = {
+
+	{ "ap_version",		LINK_MODE_HWINFO },
+	{ "ap_gettick",		LINK_MODE_GETTICK },
+	{ "ap_log_flush",	LINK_MODE_DATA_GRAB },
+	{ "ap_reboot",		LINK_MODE_COMMAND },
+	{ "ap_bootload",	LINK_MODE_COMMAND },
+	{ "flash_info",		LINK_MODE_FLASH_MAP },
+	{ "flash_prog",		LINK_MODE_COMMAND },
+	{ "flash_wipe",		LINK_MODE_COMMAND },
+	{ "pm_self",		LINK_MODE_COMMAND },
+	{ "pm_probe",		LINK_MODE_COMMAND },
+	{ "pm_adjust",		LINK_MODE_COMMAND },
+	{ "tlm_flush_sync",	LINK_MODE_DATA_GRAB },
+	{ "tlm_stream_sync",	LINK_MODE_DATA_GRAB },
+	{ "pm_scan_impedance",	LINK_MODE_DATA_GRAB },
+	{ "net_survey",		LINK_MODE_EPCAN_MAP },
+	{ "net_assign",		LINK_MODE_COMMAND },
+	{ "net_revoke",		LINK_MODE_COMMAND },
+	{ "reg_bulk",		LINK_MODE_REG_BULK },
+	{ "reg_watch",		LINK_MODE_REG_WATCH },
+
+	{ NULL, 0 }		/* END */
+};
+
 static int
-link_fetch_network(struct link_pmc *lp)
+lk_network(const char *lbuf)
 {
-	struct link_priv	*priv = lp->priv;
-	char			*lbuf = priv->lbuf;
-	int			net_ID;
+	if (strstr(lbuf, "(pmc)") == lbuf)
+		return 1;
 
-	if (strstr(lbuf, "(pmc)") == lbuf) {
+	if (strstr(lbuf, "(net/") == lbuf)
+		return 2;
 
-		sprintf(lp->network, "SERIAL");
+	return 0;
+}
 
-		return 1;
+static int
+lk_mode(const char *lbuf)
+{
+	int		N;
+
+	for (N = 0; link_map[N].command != NULL; ++N) {
+
+		if (strstr(lbuf, link_map[N].command) != NULL)
+			return link_map[N].mode;
 	}
 
-	if (strstr(lbuf, "(net/") == lbuf) {
+	return LINK_MODE_IDLE;
+}
+
+static void
+link_fetch_network(struct link_pmc *lp, const struct link_line *ln)
+{
+	int			net_ID;
 
-		if (lk_stoi(&net_ID, lbuf + 5) != NULL) {
+	if (ln->network == 1) {
+
+		sprintf(lp->network, "SERIAL");
+	}
+	else if (ln->network == 2) {
+
+		if (lk_stoi(&net_ID, ln->lbuf + 5) != NULL) {
 
 			sprintf(lp->network, "REMOTE/%i", net_ID);
 		}
 		else {
 			lp->network[0] = 0;
 		}
-
-		return 2;
 	}
-
-	return 0;
 }
 
 static void
@@ -329,16 +480,15 @@ link_reg_postproc(struct link_pmc *lp, struct link_reg *reg)
 }
 
 static void
-link_fetch_reg_format(struct link_pmc *lp)
+link_parse_reg_format(struct link_line *ln)
 {
-	struct link_priv	*priv = lp->priv;
 	char			ldup[LINK_LINE_MAX], *sp = ldup;
-	const char		*tok, *sym;
-	int			reg_mode, reg_ID, N;
+	const char		*tok;
+	int			N;
 
-	strcpy(ldup, priv->lbuf);
+	strcpy(ldup, ln->lbuf);
 
-	reg_ID = -1;
+	ln->reg_ID = -1;
 
 	tok = lk_token(&sp);
 
@@ -346,7 +496,7 @@ link_fetch_reg_format(struct link_pmc *lp)
 
 		if (lk_stoi(&N, tok) != NULL) {
 
-			reg_mode = N;
+			ln->reg_mode = N;
 
 			tok = lk_token(&sp);
 
@@ -355,68 +505,91 @@ link_fetch_reg_format(struct link_pmc *lp)
 
 				if (lk_stoi(&N, lk_space(tok)) != NULL) {
 
-					reg_ID = N;
+					ln->reg_ID = N;
 				}
 			}
 		}
 	}
 
-	if (reg_ID >= 0 && reg_ID < LINK_REGS_MAX) {
+	if (ln->reg_ID >= 0 && ln->reg_ID < LINK_REGS_MAX) {
 
-		struct link_reg		*reg = lp->reg + reg_ID;
+		sprintf(ln->sym, "%.79s", lk_token(&sp));
 
-		sym = lk_token(&sp);
 		tok = lk_token(&sp);
 
 		if (strcmp(tok, "=") == 0) {
 
 			char			text[80];
-			struct link_reg		local;
 
 			sprintf(text, "%.79s", sp = (char *) lk_space(sp));
 
-			reg->mode = reg_mode;
+			sprintf(ln->val, "%.79s", lk_token(&sp));
+			sprintf(ln->um,  "%.79s", lk_token(&sp));
+
+			tok = lk_space(sp);
+
+			ln->reg_text = (tok[0] != 0) ? 1 : 0;
 
-			if (reg->mode & LINK_REG_HIDDEN) {
+			if (ln->reg_text != 0) {
 
-				local = *reg;
-				reg = &local;
+				strcpy(ln->val, text);
+
+				ln->um[0] = 0;
 			}
+		}
+		else {
+			ln->reg_ID = -1;
+		}
+	}
+	else {
+		ln->reg_ID = -1;
+	}
+}
 
-			sprintf(reg->sym, "%.79s", sym);
-			sprintf(reg->val, "%.79s", lk_token(&sp));
-			sprintf(reg->um,  "%.79s", lk_token(&sp));
+static void
+link_fetch_reg_format(struct link_pmc *lp, const struct link_line *ln)
+{
+	struct link_reg		*reg, local;
+	int			N;
 
-			tok = lk_space(sp);
+	if (ln->reg_ID < 0)
+		return ;
 
-			if (tok[0] == 0) {
+	reg = lp->reg + ln->reg_ID;
 
-				link_reg_postproc(lp, reg);
-			}
-			else {
-				strcpy(reg->val, text);
+	reg->mode = ln->reg_mode;
 
-				reg->um[0] = 0;
-			}
+	if (reg->mode & LINK_REG_HIDDEN) {
 
-			if (reg->mode & LINK_REG_HIDDEN) {
+		local = *reg;
+		reg = &local;
+	}
 
-				reg = lp->reg + reg_ID;
+	strcpy(reg->sym, ln->sym);
+	strcpy(reg->val, ln->val);
+	strcpy(reg->um, ln->um);
 
-				reg->mode = local.mode;
-				reg->lmax_combo = local.lmax_combo;
+	if (ln->reg_text == 0) {
 
-				for (N = 0; N <= reg->lmax_combo; ++N)
-					reg->combo[N] = local.combo[N];
-			}
+		link_reg_postproc(lp, reg);
+	}
 
-			reg->fetched = lp->clock;
-			reg->queued = 0;
+	if (reg->mode & LINK_REG_HIDDEN) {
 
-			lp->reg_MAX_N = (reg_ID + 1 > lp->reg_MAX_N)
-				? reg_ID + 1 : lp->reg_MAX_N;
-		}
+		reg = lp->reg + ln->reg_ID;
+
+		reg->mode = local.mode;
+		reg->lmax_combo = local.lmax_combo;
+
+		for (N = 0; N <= reg->lmax_combo; ++N)
+			reg->combo[N] = local.combo[N];
 	}
+
+	reg->fetched = lp->clock;
+	reg->queued = 0;
+
+	lp->reg_MAX_N = (ln->reg_ID + 1 > lp->reg_MAX_N)
+		? ln->reg_ID + 1 : lp->reg_MAX_N;
 }
 
 static void
@@ -534,6 +707,7 @@ link_fetch_flash_map(struct link_pmc *lp)
 
 		if (		   *sp == 'x'
 				|| *sp == 'a'
+				|| *sp == 'l'
 				|| *sp == '.') {
 
 			lp->flash[N].block[bN++] = *sp;
@@ -548,24 +722,413 @@ link_fetch_flash_map(struct link_pmc *lp)
 	}
 }
 
-static void
-link_fetch_command(struct link_pmc *lp)
-{
-	struct link_priv	*priv = lp->priv;
-	char			*lbuf = priv->lbuf;
-	int			len;
+static void
+link_fetch_command(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	char			*lbuf = priv->lbuf;
+	int			len;
+
+	if (strstr(lbuf, "Unable ") == lbuf) {
+
+		lp->unable_warning = 1;
+	}
+
+	len = strlen(lp->command_grab);
+
+	if (strlen(lbuf) < LINK_DATA_MAX - len) {
+
+		sprintf(lp->command_grab + len, "%s\n", lbuf);
+	}
+}
+
+static void
+link_stream_flush(struct link_priv *priv)
+{
+	const double	*payload = priv->stream.batch;
+	int		N;
+
+	if (priv->stream.gp != NULL) {
+
+		for (N = 0; N < priv->stream.batch_N; ++N) {
+
+			if (gp_DataAdd(priv->stream.gp, priv->stream.dN, payload) == 0)
+				break;
+
+			payload += priv->stream.column_N;
+		}
+
+		if (N < priv->stream.batch_N && N > 0) {
+
+			/* Ring is full so we keep the unsent tail of batch
+			 * and retry on the next flush.
+			 * */
+			memmove(priv->stream.batch, payload, (priv->stream.batch_N - N)
+					* priv->stream.column_N * sizeof(double));
+		}
+
+		priv->stream.batch_N -= N;
+	}
+
+	priv->stream.clock = SDL_GetTicks();
+}
+
+static void
+link_stream_line(struct link_priv *priv, const char *lbuf)
+{
+	double		*row;
+	char		*eol;
+	int		N, cN;
+
+	if (priv->stream.column_N == 0) {
+
+		/* First line of stream is the header with labels.
+		 * */
+		cN = 0;
+
+		for (N = 0; lbuf[N] != 0; ++N) {
+
+			if (lbuf[N] == ';' && (N == 0 || lbuf[N - 1] != ';'))
+				cN++;
+		}
+
+		if (N > 0 && lbuf[N - 1] != ';')
+			cN++;
+
+		sprintf(priv->stream.label, "%.*s", LINK_LINE_MAX - 1, lbuf);
+
+		priv->stream.column_N = cN;
+		priv->stream.clock = SDL_GetTicks();
+
+		return ;
+	}
+
+	cN = priv->stream.column_N;
+
+	if ((priv->stream.batch_N + 1) * cN > LINK_STREAM_MAX) {
+
+		link_stream_flush(priv);
+
+		if ((priv->stream.batch_N + 1) * cN > LINK_STREAM_MAX) {
+
+			/* Nobody takes the data so we drop the line.
+			 * */
+			SDL_AtomicAdd(&priv->drop_count, 1);
+
+			return ;
+		}
+	}
+
+	row = priv->stream.batch + priv->stream.batch_N * cN;
+
+	for (N = 0; N < cN; ++N) {
+
+		row[N] = strtod(lbuf, &eol);
+
+		if (eol == lbuf) {
+
+			row[N] = NAN;
+		}
+
+		lbuf = strchr(eol, ';');
+
+		if (lbuf == NULL)
+			break;
+
+		lbuf++;
+	}
+
+	for (++N; N < cN; ++N)
+		row[N] = NAN;
+
+	if (priv->stream.align == 1 && isfinite(row[0])) {
+
+		/* Board time of the first row is tied to host clock so the
+		 * streams of several boards share the time axis.
+		 * */
+		priv->stream.offset = (double) (SDL_GetTicks()
+				- priv->stream.origin) / 1000. - row[0];
+
+		priv->stream.align = 2;
+	}
+
+	if (priv->stream.align == 2) {
+
+		row[0] += priv->stream.offset;
+	}
+
+	priv->stream.batch_N++;
+
+	if (priv->stream.clock + LINK_STREAM_FLUSH < SDL_GetTicks()) {
+
+		link_stream_flush(priv);
+	}
+}
+
+static void
+link_log_write(struct link_priv *priv, const char *lbuf)
+{
+	int		len;
+
+	len = strlen(lbuf);
+
+	do {
+		SDL_LockMutex(priv->log.mutex);
+
+		if (priv->log.len + len + 1 <= LINK_LOG_BUFFER) {
+
+			char		*buf = priv->log.buf[priv->log.front];
+
+			memcpy(buf + priv->log.len, lbuf, len);
+
+			priv->log.len += len;
+			buf[priv->log.len++] = '\n';
+
+			if (		priv->log.len >= LINK_LOG_FLUSH
+					&& SDL_SemValue(priv->log.event) == 0) {
+
+				SDL_SemPost(priv->log.event);
+			}
+
+			SDL_UnlockMutex(priv->log.mutex);
+			break;
+		}
+
+		SDL_UnlockMutex(priv->log.mutex);
+
+		/* Disk is too slow so we wait for writer thread.
+		 * */
+		SDL_SemPost(priv->log.event);
+		SDL_Delay(1);
+	}
+	while (1);
+}
+
+static void
+link_log_rotate(struct link_priv *priv)
+{
+	char		name[PHOBIA_PATH_MAX + 16];
+	char		newname[PHOBIA_PATH_MAX + 16];
+
+	const char	*ext = (priv->log.compress != 0) ? ".lz4" : "";
+
+	FILE		*fd_in, *fd_out;
+	int		N, rc;
+
+	fclose(priv->log.fd);
+
+	for (N = LINK_LOG_SEGMENT - 1; N >= 1; --N) {
+
+		sprintf(name, "%s.%i%s", priv->log.file, N, ext);
+		sprintf(newname, "%s.%i%s", priv->log.file, N + 1, ext);
+
+		file_rename(name, newname);
+	}
+
+	sprintf(newname, "%s.1%s", priv->log.file, ext);
+
+	rc = -1;
+
+	if (priv->log.compress != 0) {
+
+		fd_in = fopen_from_UTF8(priv->log.file, "rb");
+		fd_out = fopen_from_UTF8(newname, "wb");
+
+		if (fd_in != NULL && fd_out != NULL) {
+
+			rc = framePack(fd_out, fd_in);
+		}
+
+		if (fd_in != NULL)
+			fclose(fd_in);
+
+		if (fd_out != NULL)
+			fclose(fd_out);
+
+		if (rc == 0) {
+
+			file_remove(priv->log.file);
+		}
+		else {
+			file_remove(newname);
+
+			/* Keep the segment uncompressed if we failed.
+			 * */
+			sprintf(newname, "%s.1", priv->log.file);
+		}
+	}
+
+	if (rc != 0) {
+
+		file_rename(priv->log.file, newname);
+	}
+
+	priv->log.fd = fopen_from_UTF8(priv->log.file, "a");
+	priv->log.size = 0;
+}
+
+static int
+link_thread_log(struct link_priv *priv)
+{
+	char		*buf;
+	int		len, terminate;
+
+	do {
+		SDL_SemWaitTimeout(priv->log.event, LINK_LOG_TIMEOUT);
+
+		terminate = SDL_AtomicGet(&priv->log.terminate);
+
+		SDL_LockMutex(priv->log.mutex);
+
+		buf = priv->log.buf[priv->log.front];
+		len = priv->log.len;
+
+		priv->log.front ^= 1;
+		priv->log.len = 0;
+
+		SDL_UnlockMutex(priv->log.mutex);
+
+		if (len > 0 && priv->log.fd != NULL) {
+
+			fwrite(buf, 1, len, priv->log.fd);
+			fflush(priv->log.fd);
+
+			priv->log.size += len;
+
+			if (		priv->log.rotate != 0
+					&& priv->log.size >= priv->log.rotate) {
+
+				link_log_rotate(priv);
+			}
+		}
+
+		if (terminate != 0)
+			break;
+	}
+	while (1);
+
+	return 0;
+}
+
+static int
+link_thread_fetch(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	struct link_line	*ln;
+
+	int			link_mode = LINK_MODE_IDLE;
+	int			wp, wpi, flush = 0, logged;
+
+	/* We take lines from serial port, write the log and grab files, and
+	 * parse register replies. Everything that UI needs goes through the
+	 * queue so UI frame time does not depend on link traffic.
+	 * */
+	do {
+		if (SDL_AtomicGet(&priv->terminate) != 0)
+			break;
+
+		wp = SDL_AtomicGet(&priv->wp);
+		wpi = (wp < LINK_QUEUE_MAX - 1) ? wp + 1 : 0;
+
+		if (wpi == SDL_AtomicGet(&priv->rp)) {
+
+			/* Queue is full so we wait for UI.
+			 * */
+			SDL_Delay(1);
+			continue;
+		}
+
+		ln = priv->queue + wp;
+
+		if (serial_fgets(priv->fd, ln->lbuf, sizeof(ln->lbuf)) != SERIAL_OK) {
+
+			if (flush != 0) {
+
+				SDL_LockMutex(priv->mutex);
+
+				if (priv->fd_grab != NULL)
+					fflush(priv->fd_grab);
+
+				if (priv->stream.batch_N != 0)
+					link_stream_flush(priv);
+
+				SDL_UnlockMutex(priv->mutex);
+
+				flush = 0;
+			}
+
+			serial_fwait(priv->fd, 20);
+			continue;
+		}
+
+		SDL_AtomicAdd(&priv->line_count, 1);
+
+		ln->network = lk_network(ln->lbuf);
+		ln->reg_ID = -1;
+
+		SDL_LockMutex(priv->mutex);
+
+		if (SDL_AtomicSet(&priv->reset, 0) != 0) {
+
+			link_mode = LINK_MODE_IDLE;
+		}
+
+		/* Log is written after we release the mutex as the writer may
+		 * hold us while disk is behind.
+		 * */
+		logged = (priv->log.thread != NULL) ? 1 : 0;
+
+		if (ln->network != 0) {
+
+			if (priv->stream.batch_N != 0)
+				link_stream_flush(priv);
+
+			link_mode = lk_mode(ln->lbuf);
+		}
+		else if (	link_mode == LINK_MODE_DATA_GRAB
+				&& (priv->fd_grab != NULL
+					|| priv->stream.enabled != 0)) {
+
+			if (priv->fd_grab != NULL) {
+
+				fprintf(priv->fd_grab, "%s\n", ln->lbuf);
+			}
+
+			if (priv->stream.enabled != 0) {
+
+				link_stream_line(priv, ln->lbuf);
+			}
+
+			flush = 1;
+
+			SDL_AtomicAdd(&priv->grab_count, 1);
+			SDL_UnlockMutex(priv->mutex);
+
+			if (logged != 0) {
+
+				link_log_write(priv, ln->lbuf);
+			}
+
+			continue;
+		}
 
-	if (strstr(lbuf, "Unable ") == lbuf) {
+		SDL_UnlockMutex(priv->mutex);
 
-		lp->unable_warning = 1;
-	}
+		if (logged != 0) {
 
-	len = strlen(lp->command_grab);
+			link_log_write(priv, ln->lbuf);
+		}
 
-	if (strlen(lbuf) < LINK_DATA_MAX - len) {
+		if (ln->network == 0) {
 
-		sprintf(lp->command_grab + len, "%s\n", lbuf);
+			link_parse_reg_format(ln);
+		}
+
+		SDL_AtomicSet(&priv->wp, wpi);
 	}
+	while (1);
+
+	return 0;
 }
 
 void link_open(struct link_pmc *lp, struct config_phobia *fe,
@@ -598,6 +1161,11 @@ void link_open(struct link_pmc *lp, struct config_phobia *fe,
 
 	priv->link_mode = LINK_MODE_IDLE;
 	priv->mbflow = priv->mb;
+	priv->bulk_max = -1;
+
+	priv->mutex = SDL_CreateMutex();
+	priv->thread = SDL_CreateThread((int (*) (void *)) &link_thread_fetch,
+			"link_thread_fetch", lp);
 
 	lp->locked = lp->clock + 1000;
 	lp->active = lp->clock;
@@ -616,6 +1184,9 @@ void link_open(struct link_pmc *lp, struct config_phobia *fe,
 	sprintf(priv->lbuf, "flash_info" LINK_EOL);
 	serial_fputs(priv->fd, priv->lbuf);
 
+	sprintf(priv->lbuf, "reg_unwatch" LINK_EOL);
+	serial_fputs(priv->fd, priv->lbuf);
+
 	sprintf(priv->lbuf, "reg" LINK_EOL);
 	serial_fputs(priv->fd, priv->lbuf);
 
@@ -631,14 +1202,37 @@ void link_close(struct link_pmc *lp)
 
 	if (priv != NULL) {
 
+		if (priv->thread != NULL) {
+
+			SDL_AtomicSet(&priv->terminate, 1);
+			SDL_WaitThread(priv->thread, NULL);
+		}
+
 		if (priv->fd != NULL) {
 
 			serial_close(priv->fd);
 		}
 
-		if (priv->fd_log != NULL) {
+		if (priv->log.thread != NULL) {
+
+			SDL_AtomicSet(&priv->log.terminate, 1);
+			SDL_SemPost(priv->log.event);
+
+			SDL_WaitThread(priv->log.thread, NULL);
+		}
+
+		if (priv->log.fd != NULL) {
+
+			fclose(priv->log.fd);
+		}
+
+		if (priv->log.mutex != NULL) {
+
+			SDL_DestroyMutex(priv->log.mutex);
+			SDL_DestroySemaphore(priv->log.event);
 
-			fclose(priv->fd_log);
+			free(priv->log.buf[0]);
+			free(priv->log.buf[1]);
 		}
 
 		if (priv->fd_grab != NULL) {
@@ -646,6 +1240,11 @@ void link_close(struct link_pmc *lp)
 			fclose(priv->fd_grab);
 		}
 
+		if (priv->mutex != NULL) {
+
+			SDL_DestroyMutex(priv->mutex);
+		}
+
 		memset(priv, 0, sizeof(struct link_priv));
 	}
 
@@ -663,14 +1262,28 @@ void link_remote(struct link_pmc *lp)
 
 	priv->link_mode = LINK_MODE_IDLE;
 	priv->reg_push_ID = 0;
+	priv->reg_bulk = 0;
+	priv->reg_watch = 0;
+	priv->watch_N = 0;
 	priv->mbflow = priv->mb;
 
+	SDL_LockMutex(priv->mutex);
+
 	if (priv->fd_grab != NULL) {
 
 		fclose(priv->fd_grab);
 		priv->fd_grab = NULL;
 	}
 
+	priv->stream.enabled = 0;
+	priv->stream.gp = NULL;
+	priv->stream.batch_N = 0;
+	priv->stream.align = 0;
+	priv->stream.offset = 0.;
+
+	SDL_AtomicSet(&priv->reset, 1);
+	SDL_UnlockMutex(priv->mutex);
+
 	lp->time = 0;
 
 	lp->locked = lp->clock + 1000;
@@ -678,6 +1291,7 @@ void link_remote(struct link_pmc *lp)
 	lp->keep = lp->clock;
 
 	lp->grab_N = 0;
+	lp->drop_N = 0;
 
 	memset(lp->reg, 0, sizeof(lp->reg));
 
@@ -694,62 +1308,75 @@ void link_remote(struct link_pmc *lp)
 	sprintf(priv->lbuf, "flash_info" LINK_EOL);
 	serial_fputs(priv->fd, priv->lbuf);
 
+	sprintf(priv->lbuf, "reg_unwatch" LINK_EOL);
+	serial_fputs(priv->fd, priv->lbuf);
+
 	sprintf(priv->lbuf, "reg" LINK_EOL);
 	serial_fputs(priv->fd, priv->lbuf);
 }
 
-int link_fetch(struct link_pmc *lp, int clock)
+static void
+link_watch_drop(struct link_pmc *lp)
 {
 	struct link_priv	*priv = lp->priv;
-	int			rc_local, N = 0;
+	int			reg_ID;
 
-	struct {
+	/* Old firmware does not know subscriptions so we go back to
+	 * polling of all registers.
+	 * */
+	for (reg_ID = 0; reg_ID < lp->reg_MAX_N; ++reg_ID) {
+
+		lp->reg[reg_ID].watched = 0;
+	}
+
+	priv->reg_watch = -1;
+	priv->watch_N = 0;
+}
 
-		const char	*command;
-		int		mode;
-	}
-	const	link_map[] = {
-
-		{ "ap_version",		LINK_MODE_HWINFO },
-		{ "ap_gettick",		LINK_MODE_GETTICK },
-		{ "ap_log_flush",	LINK_MODE_DATA_GRAB },
-		{ "ap_reboot",		LINK_MODE_COMMAND },
-		{ "ap_bootload",	LINK_MODE_COMMAND },
-		{ "flash_info",		LINK_MODE_FLASH_MAP },
-		{ "flash_prog",		LINK_MODE_COMMAND },
-		{ "flash_wipe",		LINK_MODE_COMMAND },
-		{ "pm_self",		LINK_MODE_COMMAND },
-		{ "pm_probe",		LINK_MODE_COMMAND },
-		{ "pm_adjust",		LINK_MODE_COMMAND },
-		{ "tlm_flush_sync",	LINK_MODE_DATA_GRAB },
-		{ "tlm_stream_sync",	LINK_MODE_DATA_GRAB },
-		{ "pm_scan_impedance",	LINK_MODE_DATA_GRAB },
-		{ "net_survey",		LINK_MODE_EPCAN_MAP },
-		{ "net_assign",		LINK_MODE_COMMAND },
-		{ "net_revoke",		LINK_MODE_COMMAND },
-
-		{ NULL, 0 }		/* END */
-	},
-	*mp;
+int link_fetch(struct link_pmc *lp, int clock)
+{
+	struct link_priv	*priv = lp->priv;
+	struct link_line	*ln;
+	int			rp, grab_N, drop_N, N;
 
 	lp->clock = clock;
 
 	if (lp->linked == 0)
 		return 0;
 
-	while (serial_fgets(priv->fd, priv->lbuf, sizeof(priv->lbuf)) == SERIAL_OK) {
+	N = SDL_AtomicSet(&priv->line_count, 0);
+
+	if (N != 0) {
 
 		lp->active = lp->clock;
+	}
 
-		if (priv->fd_log != NULL) {
+	grab_N = SDL_AtomicSet(&priv->grab_count, 0);
 
-			fprintf(priv->fd_log, "%s\n", priv->lbuf);
-			fflush(priv->fd_log);
-		}
+	if (grab_N != 0) {
+
+		lp->locked = lp->clock;
+		lp->grab_N += grab_N;
+	}
+
+	drop_N = SDL_AtomicSet(&priv->drop_count, 0);
+
+	if (drop_N != 0) {
+
+		lp->drop_N += drop_N;
+	}
+
+	rp = SDL_AtomicGet(&priv->rp);
 
-		rc_local = link_fetch_network(lp);
+	while (rp != SDL_AtomicGet(&priv->wp)) {
 
-		if (rc_local != 0) {
+		ln = priv->queue + rp;
+
+		strcpy(priv->lbuf, ln->lbuf);
+
+		if (ln->network != 0) {
+
+			link_fetch_network(lp, ln);
 
 			if (		   lp->command_state == LINK_COMMAND_RUNING
 					|| lp->command_state == LINK_COMMAND_WAITING) {
@@ -761,32 +1388,33 @@ int link_fetch(struct link_pmc *lp, int clock)
 
 				link_grab_file_close(lp);
 			}
+			else if (	priv->link_mode == LINK_MODE_REG_BULK
+					&& priv->reply_N == 0) {
+
+				/* Old firmware does not know bulk commands.
+				 * */
+				priv->reg_bulk = -1;
+			}
+			else if (	priv->link_mode == LINK_MODE_REG_WATCH
+					&& priv->reply_N == 0) {
+
+				link_watch_drop(lp);
+			}
 
 			priv->link_mode = LINK_MODE_IDLE;
 		}
 		else {
-			link_fetch_reg_format(lp);
+			link_fetch_reg_format(lp, ln);
 		}
 
 		switch (priv->link_mode) {
 
 			case LINK_MODE_IDLE:
 
-				if (rc_local == 0)
+				if (ln->network == 0)
 					break;
 
-				mp = link_map;
-
-				while (mp->command != NULL) {
-
-					if (strstr(priv->lbuf, mp->command) != NULL) {
-
-						priv->link_mode = mp->mode;
-						break;
-					}
-
-					mp++;
-				}
+				priv->link_mode = lk_mode(priv->lbuf);
 
 				if (priv->link_mode == LINK_MODE_FLASH_MAP) {
 
@@ -796,6 +1424,11 @@ int link_fetch(struct link_pmc *lp, int clock)
 
 					memset(lp->epcan, 0, sizeof(lp->epcan));
 				}
+				else if (	   priv->link_mode == LINK_MODE_REG_BULK
+						|| priv->link_mode == LINK_MODE_REG_WATCH) {
+
+					priv->reply_N = 0;
+				}
 				else if (priv->link_mode == LINK_MODE_COMMAND) {
 
 					lp->command_grab[0] = 0;
@@ -817,14 +1450,8 @@ int link_fetch(struct link_pmc *lp, int clock)
 
 			case LINK_MODE_DATA_GRAB:
 
-				if (priv->fd_grab == NULL)
-					break;
-
-				fprintf(priv->fd_grab, "%s\n", priv->lbuf);
-				fflush(priv->fd_grab);
-
-				lp->locked = lp->clock;
-				lp->grab_N++;
+				/* Grab lines are written by link thread.
+				 * */
 				break;
 
 			case LINK_MODE_EPCAN_MAP:
@@ -838,9 +1465,23 @@ int link_fetch(struct link_pmc *lp, int clock)
 			case LINK_MODE_COMMAND:
 				link_fetch_command(lp);
 				break;
+
+			case LINK_MODE_REG_BULK:
+
+				priv->reg_bulk = 1;
+				priv->reply_N++;
+				break;
+
+			case LINK_MODE_REG_WATCH:
+
+				priv->reg_watch = 1;
+				priv->reply_N++;
+				break;
 		}
 
-		N++;
+		rp = (rp < LINK_QUEUE_MAX - 1) ? rp + 1 : 0;
+
+		SDL_AtomicSet(&priv->rp, rp);
 	}
 
 	if (priv->link_mode == LINK_MODE_DATA_GRAB) {
@@ -904,6 +1545,164 @@ link_reg_all_queued(struct link_pmc *lp)
 	return busy_N;
 }
 
+static int
+link_bulk_flush(struct link_pmc *lp, char *bulk)
+{
+	struct link_priv	*priv = lp->priv;
+	int			sent = 0;
+
+	if (bulk[0] != 0) {
+
+		sprintf(priv->lbuf, "%s" LINK_EOL, bulk);
+
+		if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+
+			lp->locked = lp->clock;
+		}
+
+		bulk[0] = 0;
+		sent = 1;
+	}
+
+	return sent;
+}
+
+static int
+link_bulk_range(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+	char			text[40];
+	int			sent = 0;
+
+	if (priv->bulk_max < 0)
+		return 0;
+
+	if (priv->bulk_min == priv->bulk_max) {
+
+		sprintf(text, " %i", priv->bulk_min);
+	}
+	else {
+		sprintf(text, " %i-%i", priv->bulk_min, priv->bulk_max);
+	}
+
+	if (strlen(priv->bulk_get) + strlen(text) > LINK_BULK_MAX) {
+
+		sent = link_bulk_flush(lp, priv->bulk_get);
+	}
+
+	if (priv->bulk_get[0] == 0) {
+
+		strcpy(priv->bulk_get, "reg_bulk");
+	}
+
+	strcat(priv->bulk_get, text);
+
+	priv->bulk_max = -1;
+
+	return sent;
+}
+
+static int
+link_bulk_get(struct link_pmc *lp, int reg_ID)
+{
+	struct link_priv	*priv = lp->priv;
+	int			sent = 0;
+
+	/* Collect adjacent registers into ranges.
+	 * */
+	if (		priv->bulk_max >= 0
+			&& reg_ID == priv->bulk_max + 1) {
+
+		priv->bulk_max = reg_ID;
+	}
+	else {
+		sent = link_bulk_range(lp);
+
+		priv->bulk_min = reg_ID;
+		priv->bulk_max = reg_ID;
+	}
+
+	return sent;
+}
+
+static int
+link_bulk_set(struct link_pmc *lp, int reg_ID)
+{
+	struct link_priv	*priv = lp->priv;
+	char			text[LINK_NAME_MAX + 20];
+	int			sent = 0;
+
+	sprintf(text, " %i %.79s", reg_ID, lp->reg[reg_ID].val);
+
+	if (strlen(priv->bulk_set) + strlen(text) > LINK_BULK_MAX) {
+
+		sent = link_bulk_flush(lp, priv->bulk_set);
+	}
+
+	if (priv->bulk_set[0] == 0) {
+
+		strcpy(priv->bulk_set, "reg_bulk_set");
+	}
+
+	strcat(priv->bulk_set, text);
+
+	return sent;
+}
+
+static int
+link_watch_update(struct link_pmc *lp, int reg_ID)
+{
+	struct link_priv	*priv = lp->priv;
+	struct link_reg		*reg = lp->reg + reg_ID;
+	int			period, sent = 0;
+
+	period = (reg->update != 0) ? reg->update
+		: (reg->mode & LINK_REG_READ_ONLY) ? 10000 : 0;
+
+	if (period != 0 && reg->shown + 1000 > lp->clock) {
+
+		if (reg->watched != 0 && reg->watch_period == period)
+			return 0;
+
+		if (reg->watched == 0 && priv->watch_N >= LINK_WATCH_MAX)
+			return 0;
+
+		/* Subscribe to changes of the shown register.
+		 * */
+		sprintf(priv->lbuf, "reg_watch %i %i" LINK_EOL, reg_ID, period);
+
+		if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+
+			priv->watch_N += (reg->watched == 0) ? 1 : 0;
+
+			reg->watched = lp->clock;
+			reg->watch_period = period;
+			reg->queued = lp->clock;
+
+			lp->locked = lp->clock;
+
+			sent = 1;
+		}
+	}
+	else if (reg->watched != 0) {
+
+		sprintf(priv->lbuf, "reg_unwatch %i" LINK_EOL, reg_ID);
+
+		if (serial_fputs(priv->fd, priv->lbuf) == SERIAL_OK) {
+
+			priv->watch_N--;
+
+			reg->watched = 0;
+
+			lp->locked = lp->clock;
+
+			sent = 1;
+		}
+	}
+
+	return sent;
+}
+
 void link_push(struct link_pmc *lp)
 {
 	struct link_priv	*priv = lp->priv;
@@ -929,11 +1728,16 @@ void link_push(struct link_pmc *lp)
 	do {
 		reg = lp->reg + reg_ID;
 
+		if (reg->queued == 0 && priv->reg_watch >= 0) {
+
+			busy_N += link_watch_update(lp, reg_ID);
+		}
+
 		if (reg->queued == 0) {
 
 			dofetch = 0;
 
-			if (reg->update != 0) {
+			if (reg->update != 0 && reg->watched == 0) {
 
 				if (reg->fetched + reg->update < reg->shown)
 					dofetch = 1;
@@ -948,13 +1752,25 @@ void link_push(struct link_pmc *lp)
 				}
 			}
 
-			if (reg->mode & LINK_REG_READ_ONLY) {
+			if (		(reg->mode & LINK_REG_READ_ONLY) != 0
+					&& reg->watched == 0) {
 
 				if (reg->fetched + 10000 < reg->shown)
 					dofetch = 1;
 			}
 
-			if (reg->modified > reg->fetched) {
+			if (		reg->modified > reg->fetched
+					&& priv->reg_bulk > 0
+					&& strlen(reg->val) < LINK_BULK_MAX - 24
+					&& strpbrk(reg->val, LINK_SPACE) == NULL) {
+
+				/* Write a batch of registers at once.
+				 * */
+				busy_N += link_bulk_set(lp, reg_ID);
+
+				reg->queued = lp->clock;
+			}
+			else if (reg->modified > reg->fetched) {
 
 				sprintf(priv->lbuf, "reg %i %.79s" LINK_EOL,
 						reg_ID, reg->val);
@@ -967,6 +1783,15 @@ void link_push(struct link_pmc *lp)
 					busy_N++;
 				}
 			}
+			else if (dofetch != 0 && priv->reg_bulk >= 0) {
+
+				/* Fetch all the registers of the page in one
+				 * round-trip.
+				 * */
+				busy_N += link_bulk_get(lp, reg_ID);
+
+				reg->queued = lp->clock;
+			}
 			else if (dofetch != 0) {
 
 				sprintf(priv->lbuf, "reg %i" LINK_EOL, reg_ID);
@@ -1015,6 +1840,11 @@ void link_push(struct link_pmc *lp)
 	}
 	while (1);
 
+	link_bulk_range(lp);
+
+	link_bulk_flush(lp, priv->bulk_set);
+	link_bulk_flush(lp, priv->bulk_get);
+
 	priv->reg_push_ID = reg_ID;
 }
 
@@ -1224,7 +2054,11 @@ int link_log_file_open(struct link_pmc *lp, const char *file)
 	if (lp->linked == 0)
 		return 0;
 
-	if (priv->fd_log == NULL) {
+	if (priv->log.thread == NULL) {
+
+		priv->log.size = 0;
+
+		file_stat(file, &priv->log.size);
 
 		fd = fopen_from_UTF8(file, "a");
 
@@ -1233,8 +2067,35 @@ int link_log_file_open(struct link_pmc *lp, const char *file)
 			time(&tm);
 
 			fprintf(fd, "# log opened %s\n", ctime(&tm));
+			fflush(fd);
+
+			sprintf(priv->log.file, "%.*s", PHOBIA_PATH_MAX - 1, file);
+
+			priv->log.fd = fd;
+
+			if (lp->fe != NULL) {
+
+				priv->log.rotate = (unsigned long long)
+					lp->fe->logrotate * 1048576ULL;
 
-			priv->fd_log = fd;
+				priv->log.compress = lp->fe->logcompress;
+			}
+
+			priv->log.buf[0] = malloc(LINK_LOG_BUFFER);
+			priv->log.buf[1] = malloc(LINK_LOG_BUFFER);
+
+			priv->log.len = 0;
+			priv->log.front = 0;
+
+			priv->log.mutex = SDL_CreateMutex();
+			priv->log.event = SDL_CreateSemaphore(0);
+
+			SDL_LockMutex(priv->mutex);
+
+			priv->log.thread = SDL_CreateThread((int (*) (void *))
+					&link_thread_log, "link_thread_log", priv);
+
+			SDL_UnlockMutex(priv->mutex);
 
 			return 1;
 		}
@@ -1257,8 +2118,13 @@ int link_grab_file_open(struct link_pmc *lp, const char *file)
 
 		if (fd != NULL) {
 
+			SDL_LockMutex(priv->mutex);
+
 			priv->fd_grab = fd;
 
+			SDL_AtomicSet(&priv->grab_count, 0);
+			SDL_UnlockMutex(priv->mutex);
+
 			lp->grab_N = 1;
 
 			return 1;
@@ -1275,17 +2141,117 @@ void link_grab_file_close(struct link_pmc *lp)
 	if (lp->linked == 0)
 		return ;
 
+	SDL_LockMutex(priv->mutex);
+
 	if (priv->fd_grab != NULL) {
 
 		fclose(priv->fd_grab);
 		priv->fd_grab = NULL;
 	}
 
+	SDL_AtomicSet(&priv->grab_count, 0);
+
+	priv->stream.enabled = 0;
+	priv->stream.gp = NULL;
+	priv->stream.batch_N = 0;
+	priv->stream.align = 0;
+	priv->stream.offset = 0.;
+
 	if (priv->link_mode == LINK_MODE_DATA_GRAB) {
 
 		priv->link_mode = LINK_MODE_IDLE;
 
+		SDL_AtomicSet(&priv->reset, 1);
+
 		lp->grab_N = 0;
 	}
+
+	SDL_UnlockMutex(priv->mutex);
+}
+
+int link_stream_open(struct link_pmc *lp)
+{
+	struct link_priv	*priv = lp->priv;
+
+	if (lp->linked == 0)
+		return 0;
+
+	SDL_LockMutex(priv->mutex);
+
+	priv->stream.enabled = 1;
+	priv->stream.column_N = 0;
+	priv->stream.gp = NULL;
+	priv->stream.batch_N = 0;
+	priv->stream.align = 0;
+	priv->stream.offset = 0.;
+
+	SDL_AtomicSet(&priv->grab_count, 0);
+	SDL_AtomicSet(&priv->drop_count, 0);
+	SDL_UnlockMutex(priv->mutex);
+
+	lp->grab_N = 1;
+	lp->drop_N = 0;
+
+	return 1;
+}
+
+int link_stream_label(struct link_pmc *lp, char *label)
+{
+	struct link_priv	*priv = lp->priv;
+	int			column_N = 0;
+
+	if (lp->linked == 0)
+		return 0;
+
+	SDL_LockMutex(priv->mutex);
+
+	if (priv->stream.enabled != 0) {
+
+		column_N = priv->stream.column_N;
+
+		strcpy(label, priv->stream.label);
+	}
+
+	SDL_UnlockMutex(priv->mutex);
+
+	return column_N;
+}
+
+void link_stream_align(struct link_pmc *lp, Uint32 origin)
+{
+	struct link_priv	*priv = lp->priv;
+
+	if (lp->linked == 0)
+		return ;
+
+	SDL_LockMutex(priv->mutex);
+
+	if (priv->stream.enabled != 0 && priv->stream.column_N == 0) {
+
+		priv->stream.align = 1;
+		priv->stream.origin = origin;
+	}
+
+	SDL_UnlockMutex(priv->mutex);
+}
+
+void link_stream_bind(struct link_pmc *lp, gpcon_t *gp, int dN)
+{
+	struct link_priv	*priv = lp->priv;
+
+	if (lp->linked == 0)
+		return ;
+
+	SDL_LockMutex(priv->mutex);
+
+	if (priv->stream.enabled != 0 || gp == NULL) {
+
+		/* Lines collected before binding go to gp on next flush.
+		 * */
+		priv->stream.gp = gp;
+		priv->stream.dN = dN;
+	}
+
+	SDL_UnlockMutex(priv->mutex);
 }
 
@@ -2,6 +2,7 @@
 #define _H_LINK_
 
 #include "config.h"
+#include "gp/gp.h"
 
 #define LINK_REGS_MAX		900
 #define LINK_NAME_MAX		80
@@ -66,6 +67,9 @@ struct link_reg {
 	int		update;
 	int		onefetch;
 
+	int		watched;
+	int		watch_period;
+
 	char		*combo[LINK_COMBO_MAX];
 	int		lmax_combo;
 
@@ -122,6 +126,7 @@ struct link_pmc {
 
 	int			line_N;
 	int			grab_N;
+	int			drop_N;
 
 	struct link_reg		reg[LINK_REGS_MAX];
 
@@ -150,5 +155,10 @@ int link_log_file_open(struct link_pmc *lp, const char *file);
 int link_grab_file_open(struct link_pmc *lp, const char *file);
 void link_grab_file_close(struct link_pmc *lp);
 
+int link_stream_open(struct link_pmc *lp);
+int link_stream_label(struct link_pmc *lp, char *label);
+void link_stream_align(struct link_pmc *lp, Uint32 origin);
+void link_stream_bind(struct link_pmc *lp, gpcon_t *gp, int dN);
+
 #endif /* _H_LINK_ */
 
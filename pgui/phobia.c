@@ -21,6 +21,13 @@
 #define PHOBIA_NODE_MAX				32
 #define PHOBIA_TAB_MAX				40
 
+/* We do not allow more sessions than gp is able to keep datasets in one
+ * combined view.
+ * */
+#define PHOBIA_SESSION_MAX			10
+#define PHOBIA_DASH_MAX				4
+#define PHOBIA_CONFIG_MAX			65536
+
 SDL_RWops *TTF_RW_droid_sans_normal();
 
 enum {
@@ -95,6 +102,25 @@ struct public {
 	}
 	network;
 
+	struct {
+
+		struct link_pmc		*lp[PHOBIA_SESSION_MAX];
+
+		int			active;
+		int			push_N;
+		int			shown;
+
+		int			wait_GP;
+		int			started;
+		Uint32			origin;
+
+		int			column_N[PHOBIA_SESSION_MAX];
+		char			label[PHOBIA_SESSION_MAX][LINK_LINE_MAX];
+
+		struct link_reg		*dash[PHOBIA_SESSION_MAX][PHOBIA_DASH_MAX];
+	}
+	session;
+
 	struct {
 
 		struct dirent_stat	sb;
@@ -132,9 +158,12 @@ struct public {
 	struct {
 
 		int			wait_GP;
+		int			save_CSV;
 
 		char			file_snap[PHOBIA_PATH_MAX];
 		char			file_grab[PHOBIA_NAME_MAX];
+
+		char			stream_label[LINK_LINE_MAX];
 	}
 	telemetry;
 
@@ -1044,11 +1073,246 @@ pub_directory_scan(struct public *pub, const char *sup)
 	pub->scan.selected = - 1;
 }
 
+static void
+pub_session_select(struct public *pub, int sN)
+{
+	if (sN < 0 || sN >= PHOBIA_SESSION_MAX)
+		return ;
+
+	if (pub->session.lp[sN] == NULL) {
+
+		pub->session.lp[sN] = calloc(1, sizeof(struct link_pmc));
+
+		if (pub->session.lp[sN] == NULL)
+			return ;
+	}
+
+	if (pub->session.lp[sN] != pub->lp) {
+
+		pub->session.active = sN;
+		pub->lp = pub->session.lp[sN];
+
+		pub->popup_enum = 0;
+		pub->network.selected = -1;
+	}
+}
+
+static int
+pub_session_new(struct public *pub)
+{
+	int		sN;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (		pub->session.lp[sN] == NULL
+				|| pub->session.lp[sN]->linked == 0) {
+
+			pub_session_select(pub, sN);
+
+			return sN;
+		}
+	}
+
+	return -1;
+}
+
+static int
+pub_session_busy(struct public *pub, const char *portname)
+{
+	struct link_pmc		*lp;
+	int			sN;
+
+	if (portname == NULL)
+		return 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		lp = pub->session.lp[sN];
+
+		if (		lp != NULL && lp->linked != 0
+				&& strcmp(lp->devname, portname) == 0) {
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+pub_session_linked(struct public *pub)
+{
+	int		sN, linked_N = 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (		pub->session.lp[sN] != NULL
+				&& pub->session.lp[sN]->linked != 0) {
+
+			linked_N++;
+		}
+	}
+
+	return linked_N;
+}
+
+static void
+pub_session_log_path(struct public *pub, char *lbuf)
+{
+	char		name[PHOBIA_NAME_MAX];
+
+	if (pub->session.active == 0) {
+
+		config_storage_path(pub->fe, lbuf, FILE_LINK_LOG);
+	}
+	else {
+		/* Each session writes its own log so the rotation does not
+		 * mix up the segments of different boards.
+		 * */
+		sprintf(name, FILE_LINK_LOG_SESSION, pub->session.active + 1);
+
+		config_storage_path(pub->fe, lbuf, name);
+	}
+}
+
+static void
+pub_session_dash_release(struct public *pub, int sN)
+{
+	struct link_pmc		*lp = pub->session.lp[sN];
+	int			N;
+
+	/* Stop polling of registers that dashboard has enabled.
+	 * */
+	for (N = 0; N < PHOBIA_DASH_MAX; ++N) {
+
+		if (pub->session.dash[sN][N] != NULL) {
+
+			if (lp != NULL && lp->linked != 0) {
+
+				pub->session.dash[sN][N]->update = 0;
+			}
+
+			pub->session.dash[sN][N] = NULL;
+		}
+	}
+}
+
+static int
+pub_session_fetch(struct public *pub, int clock)
+{
+	struct link_pmc		*lp;
+	int			sN, N, line_N = 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		lp = pub->session.lp[sN];
+
+		if (lp == NULL)
+			continue;
+
+		if (lp->linked == 0) {
+
+			/* Registers are cleaned on the next link open.
+			 * */
+			pub_session_dash_release(pub, sN);
+		}
+
+		N = link_fetch(lp, clock);
+
+		/* Background sessions wake up UI only if dashboard is shown.
+		 * */
+		if (lp == pub->lp || pub->session.shown + 100 > clock) {
+
+			line_N += N;
+		}
+	}
+
+	return line_N;
+}
+
+static void
+pub_session_push(struct public *pub)
+{
+	struct link_pmc		*lp;
+	int			sN, N;
+
+	link_push(pub->lp);
+
+	/* We push one background session per frame in turn so the cost of
+	 * polling does not grow with the number of boards.
+	 * */
+	for (N = 0; N < PHOBIA_SESSION_MAX; ++N) {
+
+		sN = pub->session.push_N;
+
+		pub->session.push_N = (sN < PHOBIA_SESSION_MAX - 1) ? sN + 1 : 0;
+
+		lp = pub->session.lp[sN];
+
+		if (lp != NULL && lp != pub->lp && lp->linked != 0) {
+
+			link_push(lp);
+			break;
+		}
+	}
+}
+
+static void
+pub_unbind_GP(struct public *pub)
+{
+	int		sN;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (pub->session.lp[sN] != NULL) {
+
+			link_stream_bind(pub->session.lp[sN], NULL, 0);
+		}
+	}
+}
+
+static void
+pub_close_GP(struct public *pub)
+{
+	struct link_pmc		*lp;
+	int			sN;
+
+	if (pub->lp->grab_N != 0) {
+
+		link_grab_file_close(pub->lp);
+	}
+
+	link_command(pub->lp, "\r\n");
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		lp = pub->session.lp[sN];
+
+		if (		lp != NULL && lp != pub->lp
+				&& (pub->session.started & (1U << sN)) != 0) {
+
+			if (lp->grab_N != 0) {
+
+				link_grab_file_close(lp);
+			}
+
+			link_command(lp, "\r\n");
+		}
+	}
+
+	pub->session.started = 0;
+	pub->session.wait_GP = 0;
+
+	pub_unbind_GP(pub);
+}
+
 static void
 pub_open_GP(struct public *pub, const char *file)
 {
 	if (pub->gp != NULL) {
 
+		pub_unbind_GP(pub);
+
 		gp_Clean(pub->gp);
 	}
 
@@ -1068,6 +1332,270 @@ pub_open_GP(struct public *pub, const char *file)
 	pub->gp_ID = gp_OpenWindow(pub->gp);
 }
 
+static void
+pub_open_GP_stream(struct public *pub, int column_N)
+{
+	if (pub->gp != NULL) {
+
+		pub_unbind_GP(pub);
+
+		gp_Clean(pub->gp);
+	}
+
+	pub->gp = gp_Alloc();
+
+	sprintf(pub->lbuf,	"windowsize 800 600\n"
+				"chunk 10\n"
+				"timeout 1000\n"
+				"load 0 0 stub %i\n", column_N);
+
+	gp_TakeConfig(pub->gp, pub->lbuf);
+
+	/* Live dataset takes labels from the stream header.
+	 * */
+	gp_DataLabel(pub->gp, 0, pub->telemetry.stream_label);
+	gp_TakeConfig(pub->gp, "mkpages 0\n");
+
+	(void) gp_GetSurface(pub->gp);
+	gp_PageCombine(pub->gp, 2, GP_PAGE_SELECT);
+
+	pub->gp_ID = gp_OpenWindow(pub->gp);
+
+	link_stream_bind(pub->lp, pub->gp, 0);
+
+	pub->session.started = 1U << pub->session.active;
+}
+
+static void
+pub_label_column(char *tbuf, const char *label, int cN)
+{
+	const char	*eol;
+	int		len;
+
+	while (cN > 0 && label != NULL) {
+
+		label = strchr(label, ';');
+		label = (label != NULL) ? label + 1 : NULL;
+
+		cN--;
+	}
+
+	if (label != NULL) {
+
+		eol = strchr(label, ';');
+		len = (eol != NULL) ? (int) (eol - label) : (int) strlen(label);
+		len = (len < PHOBIA_NAME_MAX - 1) ? len : PHOBIA_NAME_MAX - 1;
+
+		memcpy(tbuf, label, len);
+		tbuf[len] = 0;
+	}
+	else {
+		tbuf[0] = 0;
+	}
+}
+
+static void
+pub_open_GP_combined(struct public *pub)
+{
+	struct link_pmc		*lp;
+
+	char			tbuf[PHOBIA_NAME_MAX];
+	char			*config;
+
+	int			map[PHOBIA_SESSION_MAX];
+	int			sN, dN, cN, N, len, column_N;
+
+	if (pub->gp != NULL) {
+
+		pub_unbind_GP(pub);
+
+		gp_Clean(pub->gp);
+	}
+
+	config = malloc(PHOBIA_CONFIG_MAX);
+
+	if (config == NULL)
+		return ;
+
+	pub->gp = gp_Alloc();
+
+	len = sprintf(config,	"windowsize 800 600\n"
+				"chunk 10\n"
+				"timeout 1000\n");
+
+	dN = 0;
+	column_N = 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (		(pub->session.started & (1U << sN)) != 0
+				&& pub->session.column_N[sN] > 0) {
+
+			len += sprintf(config + len, "load %i 0 stub %i\n",
+					dN, pub->session.column_N[sN]);
+
+			column_N = (pub->session.column_N[sN] > column_N)
+				? pub->session.column_N[sN] : column_N;
+
+			map[dN++] = sN;
+		}
+	}
+
+	/* Each page keeps the same column of all boards over the aligned
+	 * time column.
+	 * */
+	for (cN = 1; cN < column_N; ++cN) {
+
+		for (N = 0; N < dN; ++N) {
+
+			if (pub->session.column_N[map[N]] > cN)
+				break;
+		}
+
+		pub_label_column(tbuf, pub->session.label[map[N]], cN);
+
+		len += sprintf(config + len, "page \"%s\"\n", tbuf);
+
+		for (N = 0; N < dN; ++N) {
+
+			sN = map[N];
+			lp = pub->session.lp[sN];
+
+			if (pub->session.column_N[sN] > cN) {
+
+				pub_label_column(tbuf, pub->session.label[sN], cN);
+
+				len += sprintf(config + len, "bind %i\n"
+						"figure 0 %i \"%.40s: %.60s\"\n",
+						N, cN, lp->devname, tbuf);
+			}
+		}
+
+		if (len > PHOBIA_CONFIG_MAX - 2000)
+			break;
+	}
+
+	gp_TakeConfig(pub->gp, config);
+
+	free(config);
+
+	for (N = 0; N < dN; ++N) {
+
+		gp_DataLabel(pub->gp, N, pub->session.label[map[N]]);
+	}
+
+	(void) gp_GetSurface(pub->gp);
+	gp_PageCombine(pub->gp, 1, GP_PAGE_SELECT);
+
+	pub->gp_ID = gp_OpenWindow(pub->gp);
+
+	for (N = 0; N < dN; ++N) {
+
+		link_stream_bind(pub->session.lp[map[N]], pub->gp, N);
+	}
+}
+
+static void
+pub_session_stream(struct public *pub)
+{
+	struct link_pmc		*lp;
+	struct link_reg		*reg;
+	int			sN;
+
+	pub->session.origin = pub->nk->clock;
+	pub->session.started = 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		lp = pub->session.lp[sN];
+
+		if (lp == NULL || lp->linked == 0)
+			continue;
+
+		reg = link_reg_lookup(lp, "tlm.mode");
+
+		if (reg == NULL || reg->lval != 0)
+			continue;
+
+		if (link_stream_open(lp) != 0) {
+
+			link_stream_align(lp, pub->session.origin);
+
+			if (link_command(lp, "tlm_stream_sync") != 0) {
+
+				reg->lval = 3;
+				reg->onefetch = 1;
+
+				pub->session.started |= 1U << sN;
+			}
+			else {
+				link_grab_file_close(lp);
+			}
+		}
+	}
+
+	pub->session.wait_GP = (pub->session.started != 0) ? 1 : 0;
+}
+
+static void
+pub_session_wait_GP(struct public *pub)
+{
+	struct link_pmc		*lp;
+	int			sN, ready_N, wait_N;
+
+	if (pub->session.wait_GP == 0)
+		return ;
+
+	ready_N = 0;
+	wait_N = 0;
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if ((pub->session.started & (1U << sN)) == 0)
+			continue;
+
+		lp = pub->session.lp[sN];
+
+		pub->session.column_N[sN] = link_stream_label(lp,
+				pub->session.label[sN]);
+
+		if (pub->session.column_N[sN] > 0) {
+
+			ready_N++;
+		}
+		else {
+			wait_N++;
+		}
+	}
+
+	if (		wait_N != 0
+			&& pub->session.origin + 2000 > pub->nk->clock)
+		return ;
+
+	/* Boards that did not start in time are dropped from the view.
+	 * */
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (		(pub->session.started & (1U << sN)) != 0
+				&& pub->session.column_N[sN] == 0) {
+
+			lp = pub->session.lp[sN];
+
+			link_grab_file_close(lp);
+			link_command(lp, "\r\n");
+
+			pub->session.started &= ~(1U << sN);
+		}
+	}
+
+	pub->session.wait_GP = 0;
+
+	if (ready_N != 0) {
+
+		pub_open_GP_combined(pub);
+	}
+}
+
 static void
 reg_float_prog_um(struct public *pub, const char *sym, const char *name,
 		float fmin, float fmax, int defsel);
@@ -1157,11 +1685,16 @@ pub_popup_telemetry_plot(struct public *pub, int popup)
 
 				strcpy(pub->telemetry.file_snap, pub->lbuf);
 
-				if (link_grab_file_open(lp, pub->telemetry.file_snap) != 0) {
+				if (pub->telemetry.save_CSV != 0) {
+
+					link_grab_file_open(lp, pub->telemetry.file_snap);
+				}
+
+				if (link_stream_open(lp) != 0) {
 
 					if (link_command(lp, "tlm_stream_sync") != 0) {
 
-						pub->telemetry.wait_GP = 1;
+						pub->telemetry.wait_GP = 2;
 					}
 
 					reg = link_reg_lookup(lp, "tlm.mode");
@@ -1242,17 +1775,26 @@ pub_popup_telemetry_plot(struct public *pub, int popup)
 		nk_layout_row_template_push_static(ctx, pub->fe_base);
 		nk_layout_row_template_push_static(ctx, pub->fe_base * 8);
 		nk_layout_row_template_push_static(ctx, pub->fe_base);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 5);
 		nk_layout_row_template_push_variable(ctx, 1);
 		nk_layout_row_template_push_static(ctx, pub->fe_base);
 		nk_layout_row_template_end(ctx);
 
 		nk_spacer(ctx);
 
-		sprintf(pub->lbuf, "Grab # %i", lp->grab_N);
+		if (lp->drop_N != 0) {
+
+			sprintf(pub->lbuf, "Grab # %i lost %i", lp->grab_N, lp->drop_N);
+		}
+		else {
+			sprintf(pub->lbuf, "Grab # %i", lp->grab_N);
+		}
 		nk_label(ctx, pub->lbuf, NK_TEXT_LEFT);
 
 		nk_spacer(ctx);
 
+		nk_checkbox_label(ctx, "Save", &pub->telemetry.save_CSV);
+
 		nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD,
 				pub->telemetry.file_grab,
 				sizeof(pub->telemetry.file_grab),
@@ -1387,13 +1929,24 @@ pub_popup_telemetry_plot(struct public *pub, int popup)
 
 		nk_spacer(ctx);
 
-		if (		pub->telemetry.wait_GP != 0
+		if (		pub->telemetry.wait_GP == 1
 				&& lp->grab_N >= 5) {
 
 			pub->telemetry.wait_GP = 0;
 
 			pub_open_GP(pub, pub->telemetry.file_snap);
 		}
+		else if (pub->telemetry.wait_GP == 2) {
+
+			N = link_stream_label(lp, pub->telemetry.stream_label);
+
+			if (N > 0) {
+
+				pub->telemetry.wait_GP = 0;
+
+				pub_open_GP_stream(pub, N);
+			}
+		}
 
 		nk_popup_end(ctx);
 	}
@@ -1772,6 +2325,10 @@ pub_drawing_flash_colored(struct nk_sdl *nk, const int sym)
 
 		colored = nk->table[NK_COLOR_ENABLED];
 	}
+	else if (sym == 'l') {
+
+		colored = nk->table[NK_COLOR_CONFIG];
+	}
 	else if (sym == 'x') {
 
 		colored = nk->table[NK_COLOR_FLICKER_LIGHT];
@@ -2684,7 +3241,7 @@ page_serial(struct public *pub)
 		"900x600", "1200x900", "1600x1200"
 	};
 
-	int				rc, select;
+	int				rc, select, busy;
 
 	orange = ctx->style.button;
 	orange.normal = nk_style_item_color(nk->table[NK_COLOR_ORANGE_BUTTON]);
@@ -2755,7 +3312,23 @@ page_serial(struct public *pub)
 
 		nk_spacer(ctx);
 
-		if (nk_button_label_styled(ctx, &orange, "Connect")) {
+		busy = pub_session_busy(pub, pub->serial.list.name[pub->serial.selected]);
+
+		disabled = orange;
+
+		if (busy != 0) {
+
+			/* The port is already linked in another session.
+			 * */
+			disabled = ctx->style.button;
+
+			disabled.normal = disabled.active;
+			disabled.hover = disabled.active;
+			disabled.text_normal = disabled.text_active;
+			disabled.text_hover = disabled.text_active;
+		}
+
+		if (nk_button_label_styled(ctx, &disabled, "Connect") && busy == 0) {
 
 			const char		*portname, *mode;
 			int			baudrate = 0;
@@ -2770,7 +3343,7 @@ page_serial(struct public *pub)
 
 			if (lp->linked != 0) {
 
-				config_storage_path(pub->fe, pub->lbuf, FILE_LINK_LOG);
+				pub_session_log_path(pub, pub->lbuf);
 
 				link_log_file_open(lp, pub->lbuf);
 
@@ -2995,6 +3568,160 @@ page_serial(struct public *pub)
 	nk_spacer(ctx);
 }
 
+static void
+page_dashboard(struct public *pub)
+{
+	struct nk_sdl			*nk = pub->nk;
+	struct link_pmc			*lp;
+	struct nk_context		*ctx = &nk->ctx;
+	struct link_reg			*reg;
+
+	struct nk_style_button		orange, disabled;
+
+	const char			*ls_field[PHOBIA_DASH_MAX] = {
+
+		"pm.lu_MODE", "pm.lu_wS", "pm.const_fb_U", "pm.fsm_errno"
+	};
+
+	int				sN, N, height, sel, newsel;
+
+	orange = ctx->style.button;
+	orange.normal = nk_style_item_color(nk->table[NK_COLOR_ORANGE_BUTTON]);
+	orange.hover = nk_style_item_color(nk->table[NK_COLOR_ORANGE_HOVER]);
+
+	pub->session.shown = nk->clock;
+
+	nk_layout_row_dynamic(ctx, 0, 1);
+	nk_spacer(ctx);
+
+	nk_layout_row_template_begin(ctx, 0);
+	nk_layout_row_template_push_static(ctx, pub->fe_base);
+	nk_layout_row_template_push_static(ctx, pub->fe_base * 7);
+	nk_layout_row_template_push_static(ctx, pub->fe_base);
+	nk_layout_row_template_push_static(ctx, pub->fe_base * 7);
+	nk_layout_row_template_push_static(ctx, pub->fe_base);
+	nk_layout_row_template_end(ctx);
+
+	nk_spacer(ctx);
+
+	if (nk_button_label(ctx, "New")) {
+
+		if (pub_session_new(pub) >= 0) {
+
+			pub->serial.started = 0;
+			pub->menu.page_pushed = 0;
+		}
+	}
+
+	nk_spacer(ctx);
+
+	if (		pub->session.wait_GP == 0
+			&& pub_session_linked(pub) != 0) {
+
+		if (nk_button_label_styled(ctx, &orange, "Combined GP")) {
+
+			pub_session_stream(pub);
+		}
+	}
+	else {
+		disabled = ctx->style.button;
+
+		disabled.normal = disabled.active;
+		disabled.hover = disabled.active;
+		disabled.text_normal = disabled.text_active;
+		disabled.text_hover = disabled.text_active;
+
+		nk_button_label_styled(ctx, &disabled, "Combined GP");
+	}
+
+	nk_spacer(ctx);
+
+	nk_layout_row_dynamic(ctx, 0, 1);
+	nk_spacer(ctx);
+
+	height = ctx->current->layout->row.height * (PHOBIA_SESSION_MAX + 1);
+
+	nk_layout_row_template_begin(ctx, height);
+	nk_layout_row_template_push_static(ctx, pub->fe_base);
+	nk_layout_row_template_push_variable(ctx, 1);
+	nk_layout_row_template_push_static(ctx, pub->fe_base);
+	nk_layout_row_template_end(ctx);
+
+	nk_spacer(ctx);
+
+	if (nk_group_begin(ctx, "SESSIONS", NK_WINDOW_BORDER)) {
+
+		nk_layout_row_template_begin(ctx, 0);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 2);
+		nk_layout_row_template_push_variable(ctx, 1);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 9);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 6);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 6);
+		nk_layout_row_template_push_static(ctx, pub->fe_base * 9);
+		nk_layout_row_template_end(ctx);
+
+		for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+			lp = pub->session.lp[sN];
+
+			if (lp == NULL || (lp->linked == 0 && lp != pub->lp))
+				continue;
+
+			sel = (lp == pub->lp) ? 1 : 0;
+
+			sprintf(pub->lbuf, "%i", sN + 1);
+
+			newsel = nk_select_label(ctx, pub->lbuf, NK_TEXT_LEFT, sel);
+
+			newsel |= nk_select_label(ctx, (lp->linked != 0) ? lp->devname
+					: "Not linked", NK_TEXT_LEFT, sel);
+
+			for (N = 0; N < PHOBIA_DASH_MAX; ++N) {
+
+				reg = link_reg_lookup(lp, ls_field[N]);
+
+				if (reg != NULL) {
+
+					if (reg->mode & LINK_REG_TYPE_ENUMERATE) {
+
+						sprintf(pub->lbuf, "%.79s", reg->um);
+					}
+					else {
+						sprintf(pub->lbuf, "%.40s %.16s", reg->val, reg->um);
+					}
+
+					/* Background sessions are polled for the
+					 * shown registers too.
+					 * */
+					if (reg->update == 0) {
+
+						reg->update = 1000;
+
+						pub->session.dash[sN][N] = reg;
+					}
+
+					reg->shown = lp->clock;
+				}
+				else {
+					pub->lbuf[0] = 0;
+				}
+
+				newsel |= nk_select_label(ctx, pub->lbuf, NK_TEXT_LEFT, sel);
+			}
+
+			if (newsel != sel && newsel != 0) {
+
+				pub_session_select(pub, sN);
+			}
+		}
+
+		nk_group_end(ctx);
+	}
+
+	nk_layout_row_dynamic(ctx, 0, 1);
+	nk_spacer(ctx);
+}
+
 static void
 page_diagnose(struct public *pub)
 {
@@ -6287,6 +7014,11 @@ page_flash(struct public *pub)
 		nk_spacer(ctx);
 		nk_label(ctx, "Data block (with correct CRC)", NK_TEXT_LEFT);
 
+		nk_spacer(ctx);
+		pub_drawing_flash_colored(nk, 'l');
+		nk_spacer(ctx);
+		nk_label(ctx, "Log block (incremental changes)", NK_TEXT_LEFT);
+
 		nk_spacer(ctx);
 		pub_drawing_flash_colored(nk, 'x');
 		nk_spacer(ctx);
@@ -6370,6 +7102,8 @@ menu_select_button(struct public *pub, const char *title, void (* pfunc) (struct
 
 	struct nk_style_button		button;
 
+	int				sN;
+
 	button = ctx->style.button;
 	button.text_alignment = NK_TEXT_LEFT;
 
@@ -6387,6 +7121,12 @@ menu_select_button(struct public *pub, const char *title, void (* pfunc) (struct
 
 			nk_group_set_scroll(ctx, "PAGE", 0, 0);
 
+			if (pub->menu.pagetab[pub->menu.page_selected] == &page_dashboard) {
+
+				for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN)
+					pub_session_dash_release(pub, sN);
+			}
+
 			link_reg_fetch_all_shown(lp);
 
 			pub->menu.page_pushed = pub->menu.page_current;
@@ -6424,6 +7164,7 @@ menu_group_layout(struct public *pub)
 		nk_layout_row_dynamic(ctx, 0, 1);
 
 		menu_select_button(pub, "Serial", &page_serial);
+		menu_select_button(pub, "Dashboard", &page_dashboard);
 		menu_select_button(pub, "Diagnose", &page_diagnose);
 		menu_select_button(pub, "Probe", &page_probe);
 		menu_select_button(pub, "HAL", &page_hal);
@@ -6498,6 +7239,8 @@ int main(int argc, char **argv)
 	struct link_pmc		*lp;
 	struct public		*pub;
 
+	int			sN;
+
 	setlocale(LC_NUMERIC, "C");
 
 	fe = calloc(1, sizeof(struct config_phobia));
@@ -6509,6 +7252,8 @@ int main(int argc, char **argv)
 	pub->nk = nk;
 	pub->lp = lp;
 
+	pub->session.lp[0] = lp;
+
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
 
 		/* TODO */
@@ -6586,7 +7331,9 @@ int main(int argc, char **argv)
 
 		nk_input_end(&nk->ctx);
 
-		if (link_fetch(lp, nk->clock) != 0) {
+		lp = pub->lp;
+
+		if (pub_session_fetch(pub, nk->clock) != 0) {
 
 			nk->active = 1;
 		}
@@ -6625,6 +7372,12 @@ int main(int argc, char **argv)
 
 				sprintf(pub->lbuf, " %.80s", lp->hwinfo);
 
+				if (pub_session_linked(pub) > 1) {
+
+					sprintf(pub->lbuf, " #%i %.80s",
+							pub->session.active + 1, lp->hwinfo);
+				}
+
 				if (lp->network[0] != 0) {
 
 					sprintf(pub->lbuf + strlen(pub->lbuf),
@@ -6679,7 +7432,8 @@ int main(int argc, char **argv)
 			nk->active = 0;
 		}
 
-		link_push(lp);
+		pub_session_push(pub);
+		pub_session_wait_GP(pub);
 
 		if (		pub->gp != NULL
 				&& gp_IsQuit(pub->gp) == 0) {
@@ -6692,12 +7446,7 @@ int main(int argc, char **argv)
 		else {
 			if (pub->gp != NULL) {
 
-				if (lp->grab_N != 0) {
-
-					link_grab_file_close(lp);
-				}
-
-				link_command(lp, "\r\n");
+				pub_close_GP(pub);
 
 				gp_Clean(pub->gp);
 
@@ -6710,14 +7459,23 @@ int main(int argc, char **argv)
 
 	if (pub->gp != NULL) {
 
+		pub_unbind_GP(pub);
+
 		gp_Clean(pub->gp);
 	}
 
 	config_write(pub->fe);
-	link_close(lp);
+
+	for (sN = 0; sN < PHOBIA_SESSION_MAX; ++sN) {
+
+		if (pub->session.lp[sN] != NULL) {
+
+			link_close(pub->session.lp[sN]);
+			free(pub->session.lp[sN]);
+		}
+	}
 
 	free(nk);
-	free(lp);
 	free(pub);
 
 	SDL_Quit();
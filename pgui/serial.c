@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #endif /* _WINDOWS */
@@ -24,11 +25,18 @@ struct serial_fd {
 	HANDLE		hFile;
 #else
 	int		port;
+
+	/* Pipe to wake up the receive thread blocked in poll().
+	 * */
+	int		event_rxq[2];
 #endif /* _WINDOWS */
 
 	struct async_priv	*rxq;
 	struct async_priv	*txq;
 
+	SDL_sem		*event_txq;
+	SDL_sem		*event_fgets;
+
 	SDL_Thread	*thread_rxq;
 	SDL_Thread	*thread_txq;
 };
@@ -42,9 +50,6 @@ struct async_priv {
 	SDL_atomic_t	rp;
 	SDL_atomic_t	wp;
 
-	char		*ophunk;
-	int		chunk;
-
 	SDL_atomic_t	terminate;
 };
 
@@ -58,9 +63,6 @@ async_open(int length)
 	ap->length = length;
 	ap->stream = (char *) malloc(ap->length);
 
-	ap->chunk = 80;
-	ap->ophunk = (char *) malloc(ap->chunk);
-
 	return ap;
 }
 
@@ -68,55 +70,94 @@ static void
 async_close(struct async_priv *ap)
 {
 	free(ap->stream);
-	free(ap->ophunk);
 	free(ap);
 }
 
+/* The function returns the contiguous span of stored data that begins at
+ * the read pointer. The span does not wrap around the end of stream.
+ * */
 static int
-async_getc(struct async_priv *ap)
+async_read_span(struct async_priv *ap, char **sbuf)
 {
-	int		rp, wp, cq;
+	int		rp, wp;
 
 	rp = SDL_AtomicGet(&ap->rp);
 	wp = SDL_AtomicGet(&ap->wp);
 
-	if (rp != wp) {
+	*sbuf = ap->stream + rp;
 
-		cq = (int) ap->stream[rp];
-		rp = (rp < ap->length - 1) ? rp + 1 : 0;
+	return (wp >= rp) ? wp - rp : ap->length - rp;
+}
 
-		SDL_AtomicSet(&ap->rp, rp);
+static void
+async_read_commit(struct async_priv *ap, int n)
+{
+	int		rp;
 
-		return cq;
-	}
-	else {
-		return SERIAL_ASYNC_WAIT;
-	}
+	rp = SDL_AtomicGet(&ap->rp) + n;
+	rp = (rp < ap->length) ? rp : rp - ap->length;
+
+	SDL_AtomicSet(&ap->rp, rp);
 }
 
+/* The function returns the contiguous span of free space that begins at
+ * the write pointer. We always keep one byte free to distinguish the full
+ * stream from the empty one.
+ * */
 static int
-async_putc(struct async_priv *ap, int cq)
+async_write_span(struct async_priv *ap, char **sbuf)
 {
-	int		rp, wp, wpi;
+	int		rp, wp;
 
 	rp = SDL_AtomicGet(&ap->rp);
 	wp = SDL_AtomicGet(&ap->wp);
 
-	wpi = (wp < ap->length - 1) ? wp + 1 : 0;
+	*sbuf = ap->stream + wp;
 
-	if (wpi != rp) {
+	if (rp > wp) {
 
-		ap->stream[wp] = (char) cq;
-
-		SDL_AtomicSet(&ap->wp, wpi);
-
-		return SERIAL_OK;
+		return rp - wp - 1;
 	}
 	else {
-		return SERIAL_ASYNC_WAIT;
+		return (rp != 0) ? ap->length - wp : ap->length - wp - 1;
 	}
 }
 
+static void
+async_write_commit(struct async_priv *ap, int n)
+{
+	int		wp;
+
+	wp = SDL_AtomicGet(&ap->wp) + n;
+	wp = (wp < ap->length) ? wp : wp - ap->length;
+
+	SDL_AtomicSet(&ap->wp, wp);
+}
+
+static int
+async_write(struct async_priv *ap, const char *s, int n)
+{
+	char		*sbuf;
+	int		ns;
+
+	do {
+		ns = async_write_span(ap, &sbuf);
+		ns = (ns < n) ? ns : n;
+
+		if (ns < 1)
+			break;
+
+		memcpy(sbuf, s, ns);
+		async_write_commit(ap, ns);
+
+		s += ns;
+		n -= ns;
+	}
+	while (n > 0);
+
+	return (n == 0) ? SERIAL_OK : SERIAL_ASYNC_WAIT;
+}
+
 static int
 async_fgets(struct async_priv *ap, char *sbuf, int n)
 {
@@ -407,6 +448,28 @@ serial_port_read(struct serial_fd *fd, char *s, int n)
 	return (int) nBytes;
 }
 
+static int
+serial_port_wait(struct serial_fd *fd)
+{
+	/* ReadFile() itself blocks until the first byte arrives or total
+	 * timeout expires so we have nothing to wait here.
+	 * */
+	return SERIAL_OK;
+}
+
+static void
+serial_port_wakeup(struct serial_fd *fd)
+{
+	/* Receive thread wakes up by ReadFile() total timeout.
+	 * */
+}
+
+static void
+serial_port_close(struct serial_fd *fd)
+{
+	CloseHandle(fd->hFile);
+}
+
 static int
 serial_port_write(struct serial_fd *fd, const char *s, int n)
 {
@@ -594,9 +657,67 @@ serial_port_open(const char *devname, int baudrate, const char *mode)
 
 	fd->port = port;
 
+	if (pipe(fd->event_rxq) != 0) {
+
+		close(port);
+		free(fd);
+
+		return NULL;
+	}
+
 	return fd;
 }
 
+static int
+serial_port_wait(struct serial_fd *fd)
+{
+	struct pollfd		pfd[2];
+
+	pfd[0].fd = fd->port;
+	pfd[0].events = POLLIN;
+	pfd[0].revents = 0;
+
+	pfd[1].fd = fd->event_rxq[0];
+	pfd[1].events = POLLIN;
+	pfd[1].revents = 0;
+
+	if (poll(pfd, 2, -1) < 0)
+		return SERIAL_ERROR_UNKNOWN;
+
+	if (pfd[0].revents & POLLIN)
+		return SERIAL_OK;
+
+	if (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+
+		/* Device is gone so we throttle down until close.
+		 * */
+		SDL_Delay(10);
+	}
+
+	return SERIAL_ERROR_UNKNOWN;
+}
+
+static void
+serial_port_wakeup(struct serial_fd *fd)
+{
+	char		cq = 0;
+
+	if (write(fd->event_rxq[1], &cq, 1) != 1) {
+
+		/* Pipe is full so receive thread is awake anyway.
+		 * */
+	}
+}
+
+static void
+serial_port_close(struct serial_fd *fd)
+{
+	close(fd->event_rxq[0]);
+	close(fd->event_rxq[1]);
+
+	close(fd->port);
+}
+
 static int
 serial_port_read(struct serial_fd *fd, char *s, int n)
 {
@@ -619,6 +740,15 @@ serial_port_write(struct serial_fd *fd, const char *s, int n)
 
 		rc = write(fd->port, s + total, n - total);
 
+		if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+			struct pollfd		pfd = { fd->port, POLLOUT, 0 };
+
+			if (poll(&pfd, 1, 100) > 0
+				&& (pfd.revents & POLLOUT))
+				continue;
+		}
+
 		if (rc < 1) {
 
 			return SERIAL_ERROR_UNKNOWN;
@@ -635,27 +765,37 @@ static int
 async_thread_rx(struct serial_fd *fd)
 {
 	struct async_priv	*ap = fd->rxq;
-	int			cq, rc, n, i;
+
+	char			*sbuf;
+	int			n;
 
 	do {
-		n = serial_port_read(fd, ap->ophunk, ap->chunk);
+		n = async_write_span(ap, &sbuf);
 
-		for (i = 0; i < n; ++i) {
+		if (n > 0) {
 
-			cq = (int) ap->ophunk[i];
+			if (serial_port_wait(fd) == SERIAL_OK) {
 
-			do {
-				rc = async_putc(ap, cq);
+				/* We read directly into the free span of stream.
+				 * */
+				n = serial_port_read(fd, sbuf, n);
 
-				if (rc == SERIAL_OK)
-					break;
+				if (n > 0) {
 
-				SDL_Delay(10);
+					async_write_commit(ap, n);
+
+					if (SDL_SemValue(fd->event_fgets) == 0) {
+
+						SDL_SemPost(fd->event_fgets);
+					}
+				}
 			}
-			while (1);
 		}
-
-		SDL_Delay(1);
+		else {
+			/* Stream is full so we wait for reader.
+			 * */
+			SDL_Delay(1);
+		}
 
 		if (SDL_AtomicGet(&ap->terminate) != 0)
 			break;
@@ -671,43 +811,32 @@ static int
 async_thread_tx(struct serial_fd *fd)
 {
 	struct async_priv	*ap = fd->txq;
-	int			cq, rc, n, terminate = 0;
 
-	do {
-		n = 0;
+	char			*sbuf;
+	int			n, terminate = 0;
 
+	do {
 		if (SDL_AtomicGet(&ap->terminate) != 0) {
 
 			terminate = 1;
 		}
 
-		do {
-			cq = async_getc(ap);
-
-			if (cq == SERIAL_ASYNC_WAIT)
-				break;
-
-			ap->ophunk[n++] = (char) cq;
-
-			if (n >= ap->chunk)
-				break;
-		}
-		while (1);
+		n = async_read_span(ap, &sbuf);
 
 		if (n > 0) {
 
-			rc = serial_port_write(fd, ap->ophunk, n);
-
-			if (rc != n) {
+			if (serial_port_write(fd, sbuf, n) != n) {
 
 				/* TODO */
 			}
+
+			async_read_commit(ap, n);
 		}
 		else {
-			SDL_Delay(10);
-
 			if (terminate != 0)
 				break;
+
+			SDL_SemWaitTimeout(fd->event_txq, 100);
 		}
 	}
 	while (1);
@@ -725,8 +854,11 @@ struct serial_fd *serial_open(const char *devname, int baudrate, const char *mod
 
 	if (fd != NULL) {
 
-		fd->rxq = async_open(4000);
-		fd->txq = async_open(200);
+		fd->rxq = async_open(SERIAL_RXQ_SIZE);
+		fd->txq = async_open(SERIAL_TXQ_SIZE);
+
+		fd->event_txq = SDL_CreateSemaphore(0);
+		fd->event_fgets = SDL_CreateSemaphore(0);
 
 		fd->thread_rxq = SDL_CreateThread((int (*) (void *)) &async_thread_rx,
 				"async_thread_rx", fd);
@@ -742,14 +874,12 @@ static int
 serial_thread_garbage(struct serial_fd *fd)
 {
 	SDL_WaitThread(fd->thread_txq, NULL);
+	SDL_WaitThread(fd->thread_rxq, NULL);
 
-#ifdef _WINDOWS
-	CloseHandle(fd->hFile);
-#else
-	close(fd->port);
-#endif /* _WINDOWS */
+	serial_port_close(fd);
 
-	SDL_WaitThread(fd->thread_rxq, NULL);
+	SDL_DestroySemaphore(fd->event_txq);
+	SDL_DestroySemaphore(fd->event_fgets);
 
 	free(fd);
 
@@ -763,6 +893,9 @@ void serial_close(struct serial_fd *fd)
 	SDL_AtomicSet(&fd->rxq->terminate, 1);
 	SDL_AtomicSet(&fd->txq->terminate, 1);
 
+	serial_port_wakeup(fd);
+	SDL_SemPost(fd->event_txq);
+
 	thread = SDL_CreateThread((int (*) (void *)) &serial_thread_garbage,
 			"serial_thread_garbage", fd);
 
@@ -771,22 +904,22 @@ void serial_close(struct serial_fd *fd)
 
 int serial_fputs(struct serial_fd *fd, const char *s)
 {
-	int		av, rc;
+	int		av, len, rc;
 
 	av = async_space(fd->txq);
+	len = strlen(s);
 
-	if (strlen(s) < av) {
+	if (len < av) {
 
-		while (*s != 0) {
+		rc = async_write(fd->txq, s, len);
 
-			rc = async_putc(fd->txq, *s++);
+		if (rc != SERIAL_OK) {
 
-			if (rc != SERIAL_OK) {
-
-				return SERIAL_ERROR_UNKNOWN;
-			}
+			return SERIAL_ERROR_UNKNOWN;
 		}
 
+		SDL_SemPost(fd->event_txq);
+
 		return SERIAL_OK;
 	}
 	else {
@@ -799,3 +932,8 @@ int serial_fgets(struct serial_fd *fd, char *s, int n)
 	return async_fgets(fd->rxq, s, n);
 }
 
+void serial_fwait(struct serial_fd *fd, int timeout)
+{
+	SDL_SemWaitTimeout(fd->event_fgets, timeout);
+}
+
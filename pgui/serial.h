@@ -4,6 +4,9 @@
 #define SERIAL_DEVICE_MAX		100
 #define SERIAL_MEMORY_SIZE		8192
 
+#define SERIAL_RXQ_SIZE			65536
+#define SERIAL_TXQ_SIZE			1024
+
 #define SERIAL_DEFAULT			"8E1"
 
 enum {
@@ -29,6 +32,7 @@ void serial_close(struct serial_fd *fd);
 
 int serial_fputs(struct serial_fd *fd, const char *s);
 int serial_fgets(struct serial_fd *fd, char *s, int n);
+void serial_fwait(struct serial_fd *fd, int timeout);
 
 #endif /* _H_SERIAL_ */
 
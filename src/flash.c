@@ -10,6 +10,14 @@
 
 #define REGS_SYM_MAX				79
 
+#define FLASH_SCHEMA_MAGIC			0x5CE3A9B7U
+#define FLASH_SCHEMA_HEAD			3
+
+#define FLASH_LOG_MAGIC				0x4C0A6E5DU
+#define FLASH_LOG_GROUP				0x6C470000U
+#define FLASH_LOG_HEAD				2
+#define FLASH_LOG_FULL				-1
+
 typedef struct {
 
 	uint32_t		number;
@@ -97,6 +105,48 @@ flash_strncpy(char *d, const char *s, int len)
 	return s;
 }
 
+static uint32_t
+flash_schema_hash(int *total)
+{
+	const reg_t		*reg;
+	const char		*lsym;
+
+	uint32_t		hash = 2166136261U;
+	int			N = 0;
+
+	/* We hash the symbolic names of all registers in ID order and the
+	 * types of configuration registers. Linked registers keep the ID of
+	 * any register so dense values are valid only if no register ID was
+	 * shifted.
+	 * */
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		lsym = reg->sym;
+
+		do {
+			hash = (hash ^ (uint8_t) *lsym) * 16777619U;
+
+			if (*lsym == 0)
+				break;
+
+			++lsym;
+		}
+		while (1);
+
+		if (reg->mode & REG_CONFIG) {
+
+			hash = (hash ^ (uint8_t) reg->fmt[2]) * 16777619U;
+			hash = (hash ^ (uint8_t) reg->mode) * 16777619U;
+
+			N++;
+		}
+	}
+
+	*total = N;
+
+	return hash;
+}
+
 static uint32_t
 flash_block_crc32(const flash_block_t *block)
 {
@@ -134,25 +184,47 @@ flash_block_scan()
 	return last;
 }
 
-int flash_block_regs_load()
+static int
+flash_block_dense_load(const flash_block_t *block)
 {
-	const flash_block_t	*block;
-	const reg_t		*reg, *linked;
-	const char		*lsym;
+	const reg_t		*reg;
+	const uint32_t		*lval;
 
-	char			symbuf[REGS_SYM_MAX + 1];
-	int			rc = 0;
+	uint32_t		schema;
+	int			total;
 
-	block = flash_block_scan();
+	schema = flash_schema_hash(&total);
 
-	if (block == NULL) {
+	if (		block->content[1] != schema
+			|| block->content[2] != total) {
 
-		/* No valid configuration block found.
-		 * */
-		return rc;
+		return 0;
+	}
+
+	lval = block->content + FLASH_SCHEMA_HEAD;
+
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		if (reg->mode & REG_CONFIG) {
+
+			if (		(reg->mode & REG_LINKED) == 0
+					|| *lval < ID_MAX) {
+
+				reg->link->i = (int) *lval;
+			}
+
+			lval++;
+		}
 	}
 
-	lsym = (const char *) block->content;
+	return 1;
+}
+
+static const char *
+flash_records_load(const char *lsym, uint32_t *lval)
+{
+	const reg_t		*reg, *linked;
+	char			symbuf[REGS_SYM_MAX + 1];
 
 	while (*lsym != 0xFF) {
 
@@ -162,26 +234,35 @@ int flash_block_regs_load()
 		 * */
 		reg = reg_search(symbuf);
 
+		if (reg != NULL && (reg->mode & REG_CONFIG) == 0)
+			reg = NULL;
+
 		if (*lsym == 0xBF) {
 
 			lsym = flash_strncpy(symbuf, lsym + 1, REGS_SYM_MAX);
 
-			if (reg != NULL && reg->mode & REG_CONFIG
-					&& reg->mode & REG_LINKED) {
+			if (reg != NULL && reg->mode & REG_LINKED) {
 
 				linked = reg_search(symbuf);
 
 				if (linked != NULL) {
 
-					reg->link->i = (int) (linked - regfile);
+					if (lval != NULL) {
+
+						lval[reg - regfile] = (uint32_t) (linked - regfile);
+					}
+					else {
+						reg->link->i = (int) (linked - regfile);
+					}
 				}
 			}
 		}
 		else if (*lsym == 0xFF) {
 
-			if (reg != NULL && reg->mode & REG_CONFIG) {
+			if (reg != NULL) {
 
-				memcpy((void *) reg->link, lsym + 1, sizeof(uint32_t));
+				memcpy((lval != NULL) ? (void *) &lval[reg - regfile]
+						: (void *) reg->link, lsym + 1, sizeof(uint32_t));
 			}
 
 			lsym += 5;
@@ -189,13 +270,136 @@ int flash_block_regs_load()
 
 		if (*lsym != 0xFF) {
 
-			rc = 1;
-			break;
+			/* Broken record.
+			 * */
+			return NULL;
 		}
 
 		lsym++;
 	}
 
+	return lsym;
+}
+
+static flash_block_t *
+flash_block_next(flash_block_t *block)
+{
+	block += 1;
+
+	if ((uint32_t) block >= FLASH_config.map[FLASH_config.total])
+		block = (flash_block_t *) FLASH_config.map[0];
+
+	return block;
+}
+
+static flash_block_t *
+flash_log_scan(flash_block_t *block)
+{
+	flash_block_t		*log;
+
+	/* The log block is placed right after the configuration block it
+	 * belongs to. It is never closed by CRC so the block scan does not
+	 * take it for a configuration block.
+	 * */
+	log = flash_block_next(block);
+
+	if (		log != block
+			&& log->number == block->number
+			&& log->content[0] == FLASH_LOG_MAGIC
+			&& log->content[1] == block->crc32) {
+
+		return log;
+	}
+
+	return NULL;
+}
+
+static uint32_t *
+flash_log_replay(flash_block_t *log, uint32_t *lval)
+{
+	uint32_t		*lhead, *lend, len;
+
+	lhead = log->content + FLASH_LOG_HEAD;
+	lend = log->content + sizeof(log->content) / sizeof(uint32_t);
+
+	while (lhead < lend) {
+
+		if (*lhead == 0xFFFFFFFFU) {
+
+			/* Free space to append the next group.
+			 * */
+			return lhead;
+		}
+
+		len = *lhead & 0xFFFFU;
+
+		if (		(*lhead & 0xFFFF0000U) != FLASH_LOG_GROUP
+				|| len + 2U > (uint32_t) (lend - lhead)) {
+
+			break;
+		}
+
+		/* Group that was interrupted by power loss is skipped.
+		 * */
+		if (crc32u(lhead + 1, len * sizeof(uint32_t)) == lhead[len + 1]) {
+
+			flash_records_load((const char *) (lhead + 1), lval);
+		}
+
+		lhead += len + 2;
+	}
+
+	/* No free space left.
+	 * */
+	return NULL;
+}
+
+int flash_block_regs_load()
+{
+	flash_block_t		*block, *log;
+	const char		*lsym;
+
+	int			rc = 0;
+
+	block = flash_block_scan();
+
+	if (block == NULL) {
+
+		/* No valid configuration block found.
+		 * */
+		return rc;
+	}
+
+	if (block->content[0] == FLASH_SCHEMA_MAGIC) {
+
+		if (		block->content[2] >= sizeof(block->content)
+					/ sizeof(uint32_t) - FLASH_SCHEMA_HEAD
+				|| flash_block_dense_load(block) == 0) {
+
+			/* Register schema was changed by firmware upgrade so
+			 * we are unable to decode dense values. Configuration
+			 * is to be moved over the text export in pgui.
+			 * */
+			return 1;
+		}
+	}
+	else {
+		/* Block written by older firmware keeps symbolic names.
+		 * */
+		lsym = (const char *) block->content;
+
+		rc = (flash_records_load(lsym, NULL) == NULL) ? 1 : 0;
+	}
+
+	log = flash_log_scan(block);
+
+	if (log != NULL) {
+
+		/* Apply incremental changes on top of configuration block.
+		 * */
+		flash_log_replay(log, NULL);
+	}
+
 	return rc;
 }
 
@@ -221,56 +425,86 @@ flash_is_block_dirty(const flash_block_t *block)
 }
 
 static int
-flash_prog_config_regs(flash_block_t *block)
+flash_record_size(const reg_t *reg)
 {
-	const reg_t		*reg;
-	const char		*lsym;
+	int			len;
 
-	flash_prog_t		pg;
-	int			rc = 0;
+	len = strlen(reg->sym) + 1;
 
-	pg.flash = block->content;
-	pg.index = 0;
-	pg.total = sizeof(block->content);
+	if (reg->mode & REG_LINKED) {
 
-	for (reg = regfile; reg->sym != NULL; ++reg) {
+		len += strlen(regfile[reg->link->i].sym);
+	}
+	else {
+		len += sizeof(uint32_t);
+	}
 
-		if (reg->mode & REG_CONFIG) {
+	return len + 1;
+}
 
-			lsym = reg->sym;
+static int
+flash_prog_record(flash_prog_t *pg, const reg_t *reg)
+{
+	const char		*lsym;
 
-			/* Store symbolic name of the register.
-			 * */
-			while (*lsym != 0) { flash_prog_u8(&pg, *lsym++); }
+	lsym = reg->sym;
 
-			if (reg->mode & REG_LINKED) {
+	/* Store symbolic name of the register.
+	 * */
+	while (*lsym != 0) { flash_prog_u8(pg, *lsym++); }
 
-				lsym = regfile[reg->link->i].sym;
+	if (reg->mode & REG_LINKED) {
 
-				flash_prog_u8(&pg, 0xBF);
+		lsym = regfile[reg->link->i].sym;
 
-				while (*lsym != 0) { flash_prog_u8(&pg, *lsym++); }
-			}
-			else {
-				flash_prog_u8(&pg, 0xFF);
-				flash_prog_u32(&pg, reg->link->i);
-			}
+		flash_prog_u8(pg, 0xBF);
 
-			if ((rc = flash_prog_u8(&pg, 0xFF)) == 0)
-				break;
-		}
+		while (*lsym != 0) { flash_prog_u8(pg, *lsym++); }
+	}
+	else {
+		flash_prog_u8(pg, 0xFF);
+		flash_prog_u32(pg, reg->link->i);
 	}
 
-	if (rc != 0) {
+	return flash_prog_u8(pg, 0xFF);
+}
+
+static int
+flash_prog_config_regs(flash_block_t *block)
+{
+	const reg_t		*reg;
 
-		while (pg.index != 0) {
+	flash_prog_t		pg;
+	uint32_t		schema;
+	int			total, rc = 0;
 
-			/* Flush the tail contents.
-			 * */
-			flash_prog_u8(&pg, 0xFF);
+	pg.flash = block->content;
+	pg.index = 0;
+	pg.total = sizeof(block->content);
+
+	schema = flash_schema_hash(&total);
+
+	if (total + FLASH_SCHEMA_HEAD > pg.total / (int) sizeof(uint32_t))
+		return rc;
+
+	/* Store the schema header and dense values in ID order. Symbolic
+	 * names are not stored, the block is loaded only by firmware with
+	 * the same register schema.
+	 * */
+	flash_prog_u32(&pg, FLASH_SCHEMA_MAGIC);
+	flash_prog_u32(&pg, schema);
+	flash_prog_u32(&pg, total);
+
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		if (reg->mode & REG_CONFIG) {
+
+			flash_prog_u32(&pg, reg->link->i);
 		}
 	}
 
+	rc = 1;
+
 	return rc;
 }
 
@@ -286,10 +520,7 @@ flash_block_prog()
 	if (block != NULL) {
 
 		number = block->number + 1;
-		block += 1;
-
-		if ((uint32_t) block >= FLASH_config.map[FLASH_config.total])
-			block = (flash_block_t *) FLASH_config.map[0];
+		block = flash_block_next(block);
 	}
 	else {
 		number = 1;
@@ -300,10 +531,7 @@ flash_block_prog()
 
 	while (flash_is_block_dirty(block) != 0) {
 
-		block += 1;
-
-		if ((uint32_t) block >= FLASH_config.map[FLASH_config.total])
-			block = (flash_block_t *) FLASH_config.map[0];
+		block = flash_block_next(block);
 
 		if (block == origin) {
 
@@ -328,6 +556,142 @@ flash_block_prog()
 	return rc;
 }
 
+static int
+flash_log_prog(flash_block_t *block, flash_block_t *log,
+		uint32_t *lhead, const uint32_t *lval)
+{
+	const reg_t		*reg;
+	uint32_t		*lend;
+
+	flash_prog_t		pg;
+	int			len = 0;
+
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		if (		reg->mode & REG_CONFIG
+				&& (uint32_t) reg->link->i != lval[reg - regfile]) {
+
+			len += flash_record_size(reg);
+		}
+	}
+
+	if (len == 0) {
+
+		/* Nothing was changed since the last write.
+		 * */
+		return 1;
+	}
+
+	if (log == NULL) {
+
+		log = flash_block_next(block);
+
+		if (log == block || flash_is_block_dirty(log) != 0)
+			return FLASH_LOG_FULL;
+
+		/* Open the new log block.
+		 * */
+		FLASH_prog_u32(&log->number, block->number);
+		FLASH_prog_u32(&log->content[0], FLASH_LOG_MAGIC);
+		FLASH_prog_u32(&log->content[1], block->crc32);
+
+		lhead = log->content + FLASH_LOG_HEAD;
+	}
+	else if (lhead == NULL) {
+
+		return FLASH_LOG_FULL;
+	}
+
+	len = (len + 1 + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+	lend = log->content + sizeof(log->content) / sizeof(uint32_t);
+
+	if (len + 2 > lend - lhead)
+		return FLASH_LOG_FULL;
+
+	/* Group header goes first so that interrupted group can be
+	 * skipped over by its length.
+	 * */
+	FLASH_prog_u32(lhead, FLASH_LOG_GROUP | len);
+
+	pg.flash = lhead + 1;
+	pg.index = 0;
+	pg.total = len * sizeof(uint32_t);
+
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		if (		reg->mode & REG_CONFIG
+				&& (uint32_t) reg->link->i != lval[reg - regfile]) {
+
+			flash_prog_record(&pg, reg);
+		}
+	}
+
+	while (pg.total != 0) {
+
+		/* Terminate the group with padding.
+		 * */
+		flash_prog_u8(&pg, 0xFF);
+	}
+
+	FLASH_prog_u32(lhead + len + 1, crc32u(lhead + 1, len * sizeof(uint32_t)));
+
+	return (crc32u(lhead + 1, len * sizeof(uint32_t)) == lhead[len + 1]) ? 1 : 0;
+}
+
+/* Committed values to be compared against when we extend the log. This
+ * is only used from shell so we keep it off the task stack and heap.
+ * */
+static uint32_t			flash_lval[ID_MAX];
+
+static int
+flash_block_log()
+{
+	flash_block_t		*block, *log;
+	const reg_t		*reg;
+	const uint32_t		*ldense;
+	uint32_t		*lval, *lhead;
+
+	int			total, rc = FLASH_LOG_FULL;
+
+	block = flash_block_scan();
+
+	if (		block == NULL
+			|| block->content[0] != FLASH_SCHEMA_MAGIC
+			|| block->content[1] != flash_schema_hash(&total)
+			|| block->content[2] != total) {
+
+		/* Only configuration block with the actual register
+		 * schema can be extended with the log.
+		 * */
+		return rc;
+	}
+
+	lval = flash_lval;
+	ldense = block->content + FLASH_SCHEMA_HEAD;
+
+	/* Restore the committed values from dense block and log.
+	 * */
+	for (reg = regfile; reg->sym != NULL; ++reg) {
+
+		if (reg->mode & REG_CONFIG) {
+
+			lval[reg - regfile] = *ldense++;
+		}
+	}
+
+	lhead = NULL;
+	log = flash_log_scan(block);
+
+	if (log != NULL) {
+
+		lhead = flash_log_replay(log, lval);
+	}
+
+	rc = flash_log_prog(block, log, lhead, lval);
+
+	return rc;
+}
+
 SH_DEF(flash_prog)
 {
 	int			rc;
@@ -340,7 +704,15 @@ SH_DEF(flash_prog)
 
 	printf("Flash ... ");
 
-	rc = flash_block_prog();
+	/* Try to append only changed registers into the log and do the
+	 * full configuration block write if there is no space left.
+	 * */
+	rc = flash_block_log();
+
+	if (rc == FLASH_LOG_FULL) {
+
+		rc = flash_block_prog();
+	}
 
 	printf("%s" EOL, (rc != 0) ? "Done" : "Fail");
 }
@@ -362,6 +734,10 @@ SH_DEF(flash_info)
 
 				info_sym = 'a';
 			}
+			else if (block->content[0] == FLASH_LOG_MAGIC) {
+
+				info_sym = 'l';
+			}
 		}
 		else {
 			info_sym = '.';
@@ -73,10 +73,10 @@ void *memcpy(void *restrict d, const void *restrict s, size_t len)
 
 int strcmp(const char *s, const char *p)
 {
-	char		c;
+	int		c;
 
 	do {
-		c = *s - *p;
+		c = (int) (uint8_t) *s - (int) (uint8_t) *p;
 
 		if (c || *s == 0)
 			break;
@@ -91,13 +91,13 @@ int strcmp(const char *s, const char *p)
 
 int strcmps(const char *s, const char *p)
 {
-	char		c;
+	int		c;
 
 	do {
 		if (*s == 0)
 			return 0;
 
-		c = *s - *p;
+		c = (int) (uint8_t) *s - (int) (uint8_t) *p;
 
 		if (c != 0)
 			break;
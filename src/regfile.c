@@ -17,6 +17,8 @@
 						(void * const) p, (void * const) t }
 
 #define REG_MAX				(sizeof(regfile) / sizeof(reg_t) - 1U)
+#define REG_BULK_MAX			20
+#define REG_WATCH_MAX			40
 
 static int		null;
 
@@ -2305,6 +2307,13 @@ const reg_t		regfile[] = {
 	{ NULL, "", 0, NULL, NULL, NULL }
 };
 
+static const uint16_t		regsort[] = {
+
+#include "regsort.h"
+};
+
+#define REG_SORT_MAX			(sizeof(regsort) / sizeof(uint16_t))
+
 static void
 reg_getval(const reg_t *reg, rval_t *lval)
 {
@@ -2388,16 +2397,46 @@ void reg_format(const reg_t *reg)
 	}
 }
 
+static int
+reg_search_lower(const char *sym)
+{
+	int			N0, N1, N;
+
+	N0 = 0;
+	N1 = REG_SORT_MAX;
+
+	/* Binary search over the symbols sorted by mkconfig.
+	 * */
+	while (N0 < N1) {
+
+		N = (N0 + N1) / 2;
+
+		if (strcmp(regfile[regsort[N]].sym, sym) < 0) {
+
+			N0 = N + 1;
+		}
+		else {
+			N1 = N;
+		}
+	}
+
+	return N0;
+}
+
 const reg_t *reg_search(const char *sym)
 {
 	const reg_t		*reg, *found = NULL;
+	int			N;
 
-	for (reg = regfile; reg->sym != NULL; ++reg) {
+	N = reg_search_lower(sym);
+
+	if (N < REG_SORT_MAX) {
+
+		reg = regfile + regsort[N];
 
 		if (strcmp(reg->sym, sym) == 0) {
 
 			found = reg;
-			break;
 		}
 	}
 
@@ -2415,14 +2454,7 @@ const reg_t *reg_search_fuzzy(const char *sym)
 			found = regfile + n;
 	}
 	else {
-		for (reg = regfile; reg->sym != NULL; ++reg) {
-
-			if (strcmp(reg->sym, sym) == 0) {
-
-				found = reg;
-				break;
-			}
-		}
+		found = reg_search(sym);
 
 		if (found == NULL) {
 
@@ -2507,10 +2539,50 @@ void reg_TOUCH_I(int reg_ID)
 	reg_SET_I(reg_ID, reg_GET_I(reg_ID));
 }
 
+static int
+reg_parse_rval(const reg_t *reg, const char *s, rval_t *rval)
+{
+	const reg_t		*lnk;
+	int			rc = 0;
+
+	if (reg->fmt[2] == 'i') {
+
+		if (reg->mode & REG_LINKED) {
+
+			lnk = reg_search_fuzzy(s);
+
+			if (lnk != NULL) {
+
+				rval->i = (int) (lnk - regfile);
+				rc = 1;
+			}
+		}
+		else if (stoi(&rval->i, s) != NULL) {
+
+			rc = 1;
+		}
+	}
+	else if (reg->fmt[2] == 'x') {
+
+		if (htoi(&rval->i, s) != NULL) {
+
+			rc = 1;
+		}
+	}
+	else {
+		if (stof(&rval->f, s) != NULL) {
+
+			rc = 1;
+		}
+	}
+
+	return rc;
+}
+
 SH_DEF(reg)
 {
 	rval_t			rval;
-	const reg_t		*reg, *lnk;
+	const reg_t		*reg;
 
 	reg = reg_search_fuzzy(s);
 
@@ -2518,48 +2590,340 @@ SH_DEF(reg)
 
 		s = sh_next_arg(s);
 
-		if (reg->fmt[2] == 'i') {
+		if (reg_parse_rval(reg, s, &rval) != 0) {
 
-			if (reg->mode & REG_LINKED) {
+			reg_setval(reg, &rval);
+		}
 
-				lnk = reg_search_fuzzy(s);
+		reg_format(reg);
+	}
+	else {
+		for (reg = regfile; reg->sym != NULL; ++reg) {
 
-				if (lnk != NULL) {
+			if (		strstr(reg->sym, s) != NULL
+					&& (reg->mode & REG_HIDDEN) == 0) {
 
-					rval.i = (int) (lnk - regfile);
-					reg_setval(reg, &rval);
-				}
+				reg_format(reg);
 			}
-			else if (stoi(&rval.i, s) != NULL) {
+		}
+	}
+}
 
-				reg_setval(reg, &rval);
-			}
+static const char *
+reg_bulk_range(const char *s, int *min, int *max)
+{
+	char			sbuf[24];
+	char			*sp;
+	int			len;
+
+	/* Parse the register ID or range of IDs like "10-25". We take the
+	 * current argument only so the next range is not mixed in.
+	 * */
+	for (len = 0; len < (int) sizeof(sbuf) - 1; ++len) {
+
+		if (s[len] == 0 || s[len] == ' ')
+			break;
+
+		sbuf[len] = s[len];
+	}
+
+	sbuf[len] = 0;
+
+	sp = (char *) strchr(sbuf, '-');
+
+	if (sp != NULL) {
+
+		*sp++ = 0;
+
+		if (		stoi(min, sbuf) == NULL
+				|| stoi(max, sp) == NULL) {
+
+			return NULL;
 		}
-		else if (reg->fmt[2] == 'x') {
+	}
+	else {
+		if (stoi(min, sbuf) == NULL)
+			return NULL;
 
-			if (htoi(&rval.i, s) != NULL) {
+		*max = *min;
+	}
 
-				reg_setval(reg, &rval);
-			}
+	return sh_next_arg(s);
+}
+
+SH_DEF(reg_bulk)
+{
+	int			min, max, reg_ID;
+
+	/* Print a batch of registers in one reply, the GUI uses this to
+	 * refresh the whole page at once.
+	 * */
+	while (*s != 0) {
+
+		s = reg_bulk_range(s, &min, &max);
+
+		if (s == NULL)
+			break;
+
+		min = (min < 0) ? 0 : min;
+		max = (max > (int) REG_MAX - 1) ? (int) REG_MAX - 1 : max;
+
+		for (reg_ID = min; reg_ID <= max; ++reg_ID) {
+
+			reg_format(regfile + reg_ID);
 		}
-		else {
-			if (stof(&rval.f, s) != NULL) {
+	}
+}
 
-				reg_setval(reg, &rval);
-			}
+SH_DEF(reg_bulk_set)
+{
+	const reg_t		*reg;
+
+	struct {
+
+		const reg_t	*reg;
+		rval_t		rval;
+	}
+	batch[REG_BULK_MAX];
+
+	int			reg_ID, N, total = 0, rc = 1;
+
+	/* Parse all the values first so that the batch is applied entirely
+	 * or not at all.
+	 * */
+	while (*s != 0 && total < REG_BULK_MAX) {
+
+		if (		stoi(&reg_ID, s) == NULL
+				|| reg_ID < 0 || reg_ID >= (int) REG_MAX) {
+
+			rc = 0;
+			break;
 		}
 
-		reg_format(reg);
+		reg = regfile + reg_ID;
+		s = sh_next_arg(s);
+
+		batch[total++].reg = reg;
+
+		if (reg_parse_rval(reg, s, &batch[total - 1].rval) == 0) {
+
+			rc = 0;
+			break;
+		}
+
+		s = sh_next_arg(s);
+	}
+
+	if (rc != 0 && *s == 0) {
+
+		for (N = 0; N < total; ++N) {
+
+			reg_setval(batch[N].reg, &batch[N].rval);
+		}
+	}
+
+	/* Reply with actual values even if batch was rejected.
+	 * */
+	for (N = 0; N < total; ++N) {
+
+		reg_format(batch[N].reg);
+	}
+}
+
+typedef struct {
+
+	const reg_t		*reg;
+
+	int			period;
+	float			threshold;
+
+	rval_t			last;
+	TickType_t		notified;
+}
+reg_watch_t;
+
+typedef struct {
+
+	/* Registers watched by the host.
+	 * */
+	reg_watch_t		list[REG_WATCH_MAX];
+	int			total;
+
+	TaskHandle_t		xHandle;
+}
+reg_local_t;
+
+static reg_local_t		local;
+
+static int
+reg_watch_changed(const reg_watch_t *w, const rval_t *rval)
+{
+	float			delta;
+
+	if (rval->i == w->last.i)
+		return 0;
+
+	if (w->reg->fmt[2] == 'i' || w->reg->fmt[2] == 'x') {
+
+		delta = (float) (rval->i - w->last.i);
 	}
 	else {
-		for (reg = regfile; reg->sym != NULL; ++reg) {
+		delta = rval->f - w->last.f;
+	}
 
-			if (		strstr(reg->sym, s) != NULL
-					&& (reg->mode & REG_HIDDEN) == 0) {
+	/* Note that NaN is always treated as change.
+	 * */
+	return (m_fabsf(delta) <= w->threshold) ? 0 : 1;
+}
 
-				reg_format(reg);
+LD_TASK void task_REGWATCH(void *pData)
+{
+	reg_watch_t		*w;
+	rval_t			rval;
+	TickType_t		xTick;
+
+	int			N, printed;
+
+	do {
+		vTaskDelay((TickType_t) 10);
+
+		/* Skip the cycle if shell is busy with the command line.
+		 * */
+		if (sh_async_lock() == 0)
+			continue;
+
+		xTick = xTaskGetTickCount();
+		printed = 0;
+
+		for (N = 0; N < local.total; ++N) {
+
+			w = local.list + N;
+
+			if ((TickType_t) (xTick - w->notified) < (TickType_t) w->period)
+				continue;
+
+			reg_getval(w->reg, &rval);
+
+			if (reg_watch_changed(w, &rval) != 0) {
+
+				if (printed == 0) {
+
+					/* Break the prompt line.
+					 * */
+					puts(EOL);
+
+					printed = 1;
+				}
+
+				reg_format(w->reg);
+
+				w->last = rval;
+				w->notified = xTick;
 			}
 		}
+
+		sh_async_unlock(printed);
+	}
+	while (1);
+}
+
+SH_DEF(reg_watch)
+{
+	reg_watch_t		*w;
+	const reg_t		*reg;
+
+	int			N, period = 100;
+	float			threshold = 0.f;
+
+	if (*s == 0) {
+
+		for (N = 0; N < local.total; ++N) {
+
+			reg_format(local.list[N].reg);
+		}
+
+		return ;
+	}
+
+	reg = reg_search_fuzzy(s);
+
+	if (reg == NULL)
+		return ;
+
+	s = sh_next_arg(s);
+
+	if (stoi(&period, s) != NULL) {
+
+		s = sh_next_arg(s);
+		stof(&threshold, s);
+	}
+
+	if (local.xHandle == NULL) {
+
+		/* Start the task on the first subscription.
+		 * */
+		if (xTaskCreate(task_REGWATCH, "REGWATCH", configHUGE_STACK_SIZE,
+					NULL, 1, &local.xHandle) != pdPASS) {
+
+			printf("Unable to start REGWATCH task" EOL);
+
+			local.xHandle = NULL;
+			return ;
+		}
+	}
+
+	w = NULL;
+
+	for (N = 0; N < local.total; ++N) {
+
+		if (local.list[N].reg == reg) {
+
+			w = local.list + N;
+			break;
+		}
+	}
+
+	if (w == NULL) {
+
+		if (local.total >= REG_WATCH_MAX) {
+
+			printf("Watch list is full" EOL);
+			return ;
+		}
+
+		w = local.list + local.total++;
+	}
+
+	w->reg = reg;
+	w->period = (period < 10) ? 10 : period;
+	w->threshold = threshold;
+
+	reg_getval(reg, &w->last);
+	w->notified = xTaskGetTickCount();
+
+	reg_format(reg);
+}
+
+SH_DEF(reg_unwatch)
+{
+	const reg_t		*reg;
+	int			N;
+
+	if (*s == 0) {
+
+		local.total = 0;
+		return ;
+	}
+
+	reg = reg_search_fuzzy(s);
+
+	for (N = 0; N < local.total; ++N) {
+
+		if (local.list[N].reg == reg) {
+
+			local.list[N] = local.list[--local.total];
+			break;
+		}
 	}
 }
 
@@ -1,5 +1,6 @@
 #include <stddef.h>
 
+#include "freertos/FreeRTOS.h"
 #include "hal/hal.h"
 
 #include "shell.h"
@@ -40,6 +41,11 @@ typedef struct {
 	 * */
 	char		cprev[SH_HISTORY_MAX];
 	int		mprev, head, tail, pnum;
+
+	/* Console lock for asynchronous output.
+	 * */
+	SemaphoreHandle_t	mutex_sem;
+	int			xLOCK;
 }
 priv_sh_t;
 
@@ -56,7 +62,7 @@ const sh_cmd_t		cmLIST[] = {
 	{NULL, NULL}
 };
 
-#define cmLIST_END	(cmLIST + sizeof(cmLIST) / sizeof(sh_cmd_t) - 2)
+#define cmLIST_MAX	((int) (sizeof(cmLIST) / sizeof(sh_cmd_t) - 1))
 
 static int
 sh_byte_is_letter(int c)
@@ -81,102 +87,127 @@ sh_puts_erase(int n)
 	}
 }
 
+static int
+sh_lower_match(const char *sym)
+{
+	int			N0, N1, N;
+
+	N0 = 0;
+	N1 = cmLIST_MAX;
+
+	/* Binary search over the commands sorted by mkconfig.
+	 * */
+	while (N0 < N1) {
+
+		N = (N0 + N1) / 2;
+
+		if (strcmp(cmLIST[N].sym, sym) < 0) {
+
+			N0 = N + 1;
+		}
+		else {
+			N1 = N;
+		}
+	}
+
+	return N0;
+}
+
+static int
+sh_range_match(const char *sym, int *min)
+{
+	int			N0, N1, N;
+
+	N0 = sh_lower_match(sym);
+	N1 = cmLIST_MAX;
+
+	*min = N0;
+
+	/* Find the end of range of commands that begins with prefix.
+	 * */
+	while (N0 < N1) {
+
+		N = (N0 + N1) / 2;
+
+		if (strcmps(sym, cmLIST[N].sym) == 0) {
+
+			N0 = N + 1;
+		}
+		else {
+			N1 = N;
+		}
+	}
+
+	return N0;
+}
+
 static void
 sh_exact_match_call(priv_sh_t *sh)
 {
 	const sh_cmd_t		*cmd;
-	const char		*id;
+	int			N;
 
-	cmd = cmLIST;
+	N = sh_lower_match(sh->cline);
 
-	do {
-		id = cmd->sym;
+	if (N < cmLIST_MAX) {
 
-		if (id == NULL)
-			break;
+		cmd = cmLIST + N;
 
-		if (strcmp(sh->cline, id) == 0) {
+		if (strcmp(sh->cline, cmd->sym) == 0) {
 
 			/* Call the function.
 			 * */
 			cmd->proc(sh->cargs);
-
-			break;
 		}
-
-		++cmd;
 	}
-	while (1);
 }
 
 static void
 sh_cyclic_match(priv_sh_t *sh, int xd)
 {
-	const sh_cmd_t		*cmd;
-	const char		*id;
-	int			N = 0;
+	int			N, N0, N1;
 
-	cmd = cmLIST + sh->cnum;
 	sh->cline[sh->ceon] = 0;
 
-	do {
-		cmd += (xd == DIR_UP) ? 1 : - 1;
+	N1 = sh_range_match(sh->cline, &N0);
 
-		cmd = (cmd < cmLIST) ? cmLIST_END
-			: (cmd > cmLIST_END) ? cmLIST : cmd;
+	if (N0 < N1) {
 
-		id = cmd->sym;
+		N = sh->cnum;
 
-		if (strcmps(sh->cline, id) == 0) {
+		if (xd == DIR_UP) {
 
-			/* Copy the command name.
-			 * */
-			strncpy(sh->cline, id, SH_CLINE_MAX - 2);
-
-			break;
+			N = (N < N0 || N >= N1 - 1) ? N0 : N + 1;
+		}
+		else {
+			N = (N <= N0 || N >= N1) ? N1 - 1 : N - 1;
 		}
 
-		++N;
+		/* Copy the command name.
+		 * */
+		strncpy(sh->cline, cmLIST[N].sym, SH_CLINE_MAX - 2);
 
-		if (N > (int) (cmLIST_END - cmLIST))
-			break;
+		sh->cnum = N;
 	}
-	while (1);
-
-	sh->cnum = cmd - cmLIST;
 }
 
 static void
 sh_common_match(priv_sh_t *sh)
 {
-	const sh_cmd_t		*cmd;
-	const char		*id, *com;
-	int			len;
-
-	com = NULL;
-	cmd = cmLIST;
+	const char		*com;
+	int			len, N0, N1;
 
-	sh->cnum = 0;
+	N1 = sh_range_match(sh->cline, &N0);
 
-	do {
-		id = cmd->sym;
-
-		if (id == NULL)
-			break;
+	sh->cnum = N1 - N0;
 
-		if (strcmps(sh->cline, id) == 0) {
-
-			len = (com != NULL) ? strclen(com, id, len) : strlen(id);
-			com = id;
-
-			sh->cnum++;
-		}
-
-		++cmd;
-	}
-	while (1);
+	if (N0 < N1) {
 
-	if (com != NULL) {
+		/* Common substring of the sorted range is the common
+		 * substring of its first and last commands.
+		 * */
+		com = cmLIST[N0].sym;
+		len = strclen(com, cmLIST[N1 - 1].sym, strlen(com));
 
 		len = (len > SH_CLINE_MAX - 2) ? SH_CLINE_MAX - 2 : len;
 
@@ -506,10 +537,8 @@ sh_line_bs(priv_sh_t *sh)
 }
 
 static void
-sh_line_null(priv_sh_t *sh)
+sh_prompt()
 {
-	sh->cline[sh->ceol = 0] = 0;
-
 #ifdef HW_HAVE_NETWORK_EPCAN
 	if (iodef == &io_CAN) {
 
@@ -525,6 +554,14 @@ sh_line_null(priv_sh_t *sh)
 		 * */
 		puts(SH_PROMPT);
 	}
+}
+
+static void
+sh_line_null(priv_sh_t *sh)
+{
+	sh->cline[sh->ceol = 0] = 0;
+
+	sh_prompt();
 
 	sh->mcomp = 0;
 	sh->mprev = 0;
@@ -542,14 +579,53 @@ const char *sh_next_arg(const char *s)
 
 static priv_sh_t		privsh;
 
+int sh_async_lock()
+{
+	priv_sh_t	*sh = &privsh;
+	int		rc = 0;
+
+	if (		sh->mutex_sem != NULL
+			&& xSemaphoreTake(sh->mutex_sem, (TickType_t) 0) == pdTRUE) {
+
+		rc = 1;
+	}
+
+	return rc;
+}
+
+void sh_async_unlock(int prompt)
+{
+	priv_sh_t	*sh = &privsh;
+
+	if (prompt != 0) {
+
+		/* Restore the prompt after asynchronous output.
+		 * */
+		sh_prompt();
+	}
+
+	xSemaphoreGive(sh->mutex_sem);
+}
+
 LD_TASK void task_CMDSH(void *pData)
 {
 	priv_sh_t	*sh = &privsh;
 	int		c;
 
+	sh->mutex_sem = xSemaphoreCreateMutex();
+
 	do {
 		c = getc();
 
+		if (sh->xLOCK == 0) {
+
+			/* Hold the console until the line is evaluated.
+			 * */
+			xSemaphoreTake(sh->mutex_sem, portMAX_DELAY);
+
+			sh->xLOCK = 1;
+		}
+
 		if (sh->xESC == 0) {
 
 			if (sh_byte_is_letter(c) || sh_byte_is_digit(c)
@@ -663,6 +739,13 @@ LD_TASK void task_CMDSH(void *pData)
 					sh->xESC = 0;
 			}
 		}
+
+		if (sh->ceol == 0 && sh->xESC == 0) {
+
+			xSemaphoreGive(sh->mutex_sem);
+
+			sh->xLOCK = 0;
+		}
 	}
 	while (1);
 }
@@ -24,6 +24,9 @@ sh_cmd_t;
 
 const char *sh_next_arg(const char *s);
 
+int sh_async_lock();
+void sh_async_unlock(int prompt);
+
 void task_CMDSH(void *);
 
 #endif /* _H_SHELL_ */